@@ -0,0 +1,116 @@
+// Walking every instance: the old std::map<std::string, Mesh3D> against SceneStore
+//
+// g++ -O2 benchmarks/storeTraversal.cpp src/sceneStore.cpp src/cpuMemory.cpp -I./glad/ -o storeTraversal
+// ./storeTraversal
+//
+// Each pass reads what a per instance loop reads [transform, bounds, flags] and sums the
+// world box centers, so nothing gets optimized away. Instances are made in a shuffled
+// order like the scene's "<asset> <n>" names, the map nodes end up wherever the heap put them
+
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "../src/mesh.hpp"
+#include "../src/sceneStore.hpp"
+#include "../src/sceneFile.hpp"
+
+
+static const char* gAssetNames[] = {"Bench", "Board", "Ceiling", "Light", "Tile", "Wall Back", "Window Panel 1", "Table"};
+static const int gAssetCount = sizeof(gAssetNames) / sizeof(gAssetNames[0]);
+
+
+static Mesh3D makeAsset(int i)
+{
+  Mesh3D mesh;
+  mesh.name = gAssetNames[i];
+  mesh.mScale = glm::vec3(0.07f + 0.01f * i);
+  mesh.mBoundsMin = glm::vec3(-1.0f, 0.0f, -1.0f);
+  mesh.mBoundsMax = glm::vec3(1.0f, 2.0f + i, 1.0f);
+  mesh.mIsOccluder = (i % 3) == 0;
+  return mesh;
+}
+
+
+template <typename Pass>
+static double bestOf(int runs, Pass pass, double* sum)
+{
+  double best = 1e30;
+  for (int run = 0; run < runs; run++)
+  {
+    auto start = std::chrono::steady_clock::now();
+    *sum += pass();
+    best = std::min(best, std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+  }
+  return best;
+}
+
+
+static void measure(size_t count)
+{
+  std::vector<Mesh3D> assets;
+  for (int i = 0; i < gAssetCount; i++) assets.push_back(makeAsset(i));
+
+  std::vector<size_t> order(count);
+  for (size_t i = 0; i < count; i++) order[i] = i;
+  std::shuffle(order.begin(), order.end(), std::mt19937(7));
+
+  std::vector<std::string> names(count);
+  for (size_t i = 0; i < count; i++) names[i] = std::string(gAssetNames[i % gAssetCount]) + " " + std::to_string(i / gAssetCount);
+
+  std::map<std::string, Mesh3D> meshes;
+  SceneStore store;
+  store.mAssets = assets;
+  for (size_t i : order)
+  {
+    glm::vec3 offset(-(float)(i % 100), (float)(i / 10000), -(float)((i / 100) % 100));
+    Mesh3D mesh = assets[i % gAssetCount];
+    mesh.mOffset = offset;
+    mesh.mRotate = (float)(i % 4) * 90.0f;
+    meshes.emplace(names[i], mesh);
+    store.mCreate(names[i].c_str(), i % gAssetCount, offset, mesh.mRotate);
+  }
+
+  int runs = count > 100000 ? 10 : 50;
+  double sum = 0.0;
+
+  double mapUs = bestOf(runs, [&]()
+  {
+    float total = 0.0f;
+    for (const auto& pair : meshes)
+    {
+      const Mesh3D& mesh = pair.second;
+      if (mesh.mIsOccluder) total += 1.0f;
+      glm::vec3 center = mesh.mOffset + (mesh.mBoundsMin + mesh.mBoundsMax) * 0.5f * mesh.mScale;
+      total += center.x + center.y + center.z;
+    }
+    return (double)total;
+  }, &sum);
+
+  double storeUs = bestOf(runs, [&]()
+  {
+    float total = 0.0f;
+    for (size_t i = 0; i < store.mCount(); i++)
+    {
+      if (store.mFlags[i] & SceneAssetOccluder) total += 1.0f;
+      glm::vec3 center = store.mOffset[i] + (store.mBoundsMin[i] + store.mBoundsMax[i]) * 0.5f * store.mScale[i];
+      total += center.x + center.y + center.z;
+    }
+    return (double)total;
+  }, &sum);
+
+  std::cout << count << " instances: map " << mapUs << " us, store " << storeUs << " us ["
+            << mapUs / storeUs << "x], " << mapUs * 1000.0 / count << " / " << storeUs * 1000.0 / count
+            << " ns per instance  (" << sum << ")" << std::endl;
+}
+
+
+int main()
+{
+  for (size_t count : {500, 50000, 500000}) measure(count);
+  return 0;
+}
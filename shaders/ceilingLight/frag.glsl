@@ -1,12 +1,41 @@
 #version 430 core
+#extension GL_ARB_bindless_texture : enable
 
 layout(location=0) in vec3 i_fragPos;
 layout(location=2) in vec2 i_uv;
 layout(location=3) in vec3 i_gouraudShadingResult;
+layout(location=13) flat in uint i_instanceId;
 
 out vec4 o_fragColor;
 
-layout(binding=9) uniform sampler2D u_texture;
+struct InstanceData
+{
+  mat4 model;
+  mat3 normalMatrix;   // inverse transpose of the model's 3x3 [std430: 3 vec4 columns]
+  vec4 color;
+  uint lightMask;      // bit i = light i reaches this instance
+  uint textureLayer;   // layer in the bucket's texture array
+  uvec2 textureHandle; // bindless handle, zero when arrays are used
+};
+layout(std430, binding=0) readonly buffer Instances { InstanceData instances[]; };
+
+layout(binding=9) uniform sampler2DArray u_textures; // the bucket's array [unused with bindless]
+uniform int u_bindlessTextures;
+
+
+// Texture of the instance, from its resident handle or its layer of the bound array
+vec4 InstanceTexture(uint instanceId, vec2 uv)
+{
+#ifdef GL_ARB_bindless_texture
+  if (u_bindlessTextures == 1)
+  {
+    uvec2 handle = instances[instanceId].textureHandle;
+    if (handle == uvec2(0u)) return vec4(0.0, 0.0, 0.0, 1.0); // untextured, same as an empty unit
+    return texture(sampler2D(handle), uv);
+  }
+#endif
+  return texture(u_textures, vec3(uv, float(instances[instanceId].textureLayer)));
+}
 
 uniform int u_isPhong;
 uniform vec3 u_lightColor;
@@ -26,7 +55,7 @@ vec3 PhongShading()
 
 void main() 
 {
-  o_fragColor = texture(u_texture, i_uv);
+  o_fragColor = InstanceTexture(i_instanceId, i_uv);
   vec3 result = vec3(0.0, 0.0, 0.0); 
 
 
@@ -2,12 +2,24 @@
 
 layout(location=0) in vec3 i_position;
 layout(location=1) in vec2 i_texCoordinates;
+layout(location=5) in uint i_instanceId; // slot in the instance SSBO
 
 layout(location=0) out vec3 o_fragPos;
 layout(location=2) out vec2 o_uv;
 layout(location=3) out vec3 o_gouraudShadingResult;
+layout(location=13) flat out uint o_instanceId;
+
+struct InstanceData
+{
+  mat4 model;
+  mat3 normalMatrix;   // inverse transpose of the model's 3x3 [std430: 3 vec4 columns]
+  vec4 color;
+  uint lightMask;      // bit i = light i reaches this instance
+  uint textureLayer;   // layer in the bucket's texture array
+  uvec2 textureHandle; // bindless handle, zero when arrays are used
+};
+layout(std430, binding=0) readonly buffer Instances { InstanceData instances[]; };
 
-uniform mat4 u_model; // Local to world
 uniform mat4 u_view;
 uniform mat4 u_projection;
 
@@ -31,8 +43,10 @@ vec3 GouraudShading()
 void main() {
   // Just to get coord of world space, as the light position 
   // is defined in world space
-  o_fragPos = vec3(u_model * vec4(i_position, 1.0));
+  mat4 model = instances[i_instanceId].model;
+  o_fragPos = vec3(model * vec4(i_position, 1.0));
   o_uv = i_texCoordinates;
+  o_instanceId = i_instanceId;
   
   o_gouraudShadingResult = vec3(0.0, 0.0, 0.0);
   if (u_isPhong == 0)
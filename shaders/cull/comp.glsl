@@ -0,0 +1,192 @@
+#version 430 core
+
+// One thread per [instance, cluster] pair
+// Visible pairs bump the instanceCount of their draw command and write the instance
+// into the command's slice of the visible list [read back as vertex attribute 5]
+//
+// Phase 1: frustum, cone, CPU occlusion and the Hi-Z pyramid of the last frame
+// Phase 2: after this frame's pyramid is built, only the pairs phase 1 dropped because of
+//          Hi-Z are tested again, the ones showing up now go into the second command list
+
+layout(local_size_x = 64) in;
+
+struct InstanceData
+{
+  mat4 model;
+  mat3 normalMatrix;   // inverse transpose of the model's 3x3 [std430: 3 vec4 columns]
+  vec4 color;
+  uint lightMask;      // bit i = light i reaches this instance
+  uint textureLayer;   // layer in the bucket's texture array
+  uvec2 textureHandle; // bindless handle, zero when arrays are used
+};
+
+struct ClusterData
+{
+  vec4 sphere; // object space center + radius
+  vec4 cone;   // axis + cutoff, cutoff 1.0 = never culled
+};
+
+struct CullItem
+{
+  uint instance;
+  uint command;
+};
+
+struct DrawCommand
+{
+  uint count;
+  uint instanceCount;
+  uint firstIndex;
+  int baseVertex;
+  uint baseInstance;
+};
+
+layout(std430, binding=0) readonly buffer Instances { InstanceData instances[]; };
+layout(std430, binding=1) readonly buffer Clusters { ClusterData clusters[]; };
+layout(std430, binding=2) readonly buffer CullItems { CullItem items[]; };
+layout(std430, binding=3) buffer Commands { DrawCommand commands[]; };
+layout(std430, binding=4) writeonly buffer VisibleInstances { uint visibleInstances[]; };
+layout(std430, binding=5) buffer Stats
+{
+  uint visibleTriangles;
+  uint culledTriangles;
+  uint visibleClusters;
+  uint culledClusters;
+  uint occludedClusters;  // dropped by Hi-Z [after phase 2 gave some back]
+  uint recoveredClusters; // phase 2 found them visible after all
+};
+layout(std430, binding=6) readonly buffer Visibility { uint instanceVisible[]; }; // CPU occlusion
+layout(std430, binding=7) buffer HiZRejected { uint hiZRejected[]; };             // per item, phase 1 -> 2
+
+uniform vec4 u_frustumPlanes[6];
+uniform vec3 u_viewPos;
+uniform int u_coneCulling;
+uniform int u_occlusionCulling;
+uniform uint u_itemCount;
+uniform int u_phase;
+
+uniform int u_hiZCulling;
+uniform mat4 u_projectionView;
+uniform sampler2D u_hiZ;
+uniform ivec2 u_hiZScreenSize; // the drawn size its depth came from [dynamic resolution]
+uniform int u_hiZLevels;
+
+
+// Box around the sphere on screen, against the farthest depth of the 2x2 pyramid texels covering it
+bool occludedByHiZ(vec3 center, float radius)
+{
+  vec2 uvMin = vec2(1.0);
+  vec2 uvMax = vec2(0.0);
+  float nearest = 1.0;
+
+  for (int i = 0; i < 8; i++)
+  {
+    vec3 corner = center + radius * vec3((i & 1) != 0 ? 1.0 : -1.0,
+                                         (i & 2) != 0 ? 1.0 : -1.0,
+                                         (i & 4) != 0 ? 1.0 : -1.0);
+    vec4 clip = u_projectionView * vec4(corner, 1.0);
+    if (clip.w <= 0.0 || clip.z < -clip.w) return false; // crosses the near plane
+
+    vec3 ndc = clip.xyz / clip.w;
+    uvMin = min(uvMin, ndc.xy * 0.5 + 0.5);
+    uvMax = max(uvMax, ndc.xy * 0.5 + 0.5);
+    nearest = min(nearest, ndc.z * 0.5 + 0.5);
+  }
+
+  ivec2 pixelMin = ivec2(clamp(uvMin, 0.0, 1.0) * vec2(u_hiZScreenSize));
+  ivec2 pixelMax = ivec2(clamp(uvMax, 0.0, 1.0) * vec2(u_hiZScreenSize));
+  pixelMin = min(pixelMin, u_hiZScreenSize - 1);
+  pixelMax = min(pixelMax, u_hiZScreenSize - 1);
+
+  // smallest level where the rectangle fits in 2x2 texels [pixel p is texel p >> (level + 1)]
+  int level = 0;
+  while (level < u_hiZLevels - 1 &&
+         any(greaterThan((pixelMax >> (level + 1)) - (pixelMin >> (level + 1)), ivec2(1))))
+    level++;
+
+  ivec2 last = textureSize(u_hiZ, level) - 1;
+  ivec2 texelMin = min(pixelMin >> (level + 1), last);
+  ivec2 texelMax = min(pixelMax >> (level + 1), last);
+
+  float farthest = max(max(texelFetch(u_hiZ, texelMin, level).r,
+                           texelFetch(u_hiZ, ivec2(texelMax.x, texelMin.y), level).r),
+                       max(texelFetch(u_hiZ, ivec2(texelMin.x, texelMax.y), level).r,
+                           texelFetch(u_hiZ, texelMax, level).r));
+
+  return nearest > farthest;
+}
+
+
+void append(CullItem item, uint triangles)
+{
+  uint slot = atomicAdd(commands[item.command].instanceCount, 1u);
+  visibleInstances[commands[item.command].baseInstance + slot] = item.instance;
+
+  atomicAdd(visibleTriangles, triangles);
+  atomicAdd(visibleClusters, 1u);
+}
+
+
+void main()
+{
+  uint id = gl_GlobalInvocationID.x;
+  if (id >= u_itemCount) return;
+
+  CullItem item = items[id];
+  mat4 model = instances[item.instance].model;
+  ClusterData cluster = clusters[item.command];
+
+  // 1. frustum, sphere grows with the largest scale axis
+  vec3 center = vec3(model * vec4(cluster.sphere.xyz, 1.0));
+  float scale = max(length(model[0].xyz), max(length(model[1].xyz), length(model[2].xyz)));
+  float radius = cluster.sphere.w * scale;
+  uint triangles = commands[item.command].count / 3u;
+
+  if (u_phase == 2)
+  {
+    if (hiZRejected[id] == 0u || occludedByHiZ(center, radius)) return;
+
+    // phase 1 counted it as culled
+    atomicAdd(culledTriangles, uint(-int(triangles)));
+    atomicAdd(culledClusters, uint(-1));
+    atomicAdd(occludedClusters, uint(-1));
+    atomicAdd(recoveredClusters, 1u);
+    append(item, triangles);
+    return;
+  }
+
+  // 0. hidden behind an occluder [decided on the CPU for the whole instance]
+  bool visible = u_occlusionCulling == 0 || instanceVisible[item.instance] != 0u;
+  for (int i = 0; i < 6; i++)
+  {
+    if (dot(u_frustumPlanes[i].xyz, center) + u_frustumPlanes[i].w < -radius) visible = false;
+  }
+
+  // 2. back facing cone, done in object space [same as the CPU version]
+  if (visible && u_coneCulling == 1 && cluster.cone.w < 1.0)
+  {
+    // inverse(model) without the inverse: the 3x3 part's inverse is the transposed normal matrix
+    vec3 localViewPos = transpose(instances[item.instance].normalMatrix) * (u_viewPos - model[3].xyz);
+    vec3 toCenter = cluster.sphere.xyz - localViewPos;
+    if (dot(toCenter, cluster.cone.xyz) >= cluster.cone.w * length(toCenter) + cluster.sphere.w)
+      visible = false;
+  }
+
+  // 3. behind last frame's depth
+  bool rejected = visible && u_hiZCulling == 1 && occludedByHiZ(center, radius);
+  hiZRejected[id] = rejected ? 1u : 0u;
+  if (rejected)
+  {
+    visible = false;
+    atomicAdd(occludedClusters, 1u);
+  }
+
+  if (!visible)
+  {
+    atomicAdd(culledTriangles, triangles);
+    atomicAdd(culledClusters, 1u);
+    return;
+  }
+
+  append(item, triangles);
+}
@@ -0,0 +1,11 @@
+#version 430 core
+
+layout(location=0) in vec4 i_color;
+
+out vec4 o_fragColor;
+
+void main()
+{
+  // unlit, the color is all there is
+  o_fragColor = i_color;
+}
@@ -0,0 +1,14 @@
+#version 430 core
+
+layout(location=0) in vec3 i_position;
+layout(location=1) in vec4 i_color;
+
+layout(location=0) out vec4 o_color;
+
+uniform mat4 u_projectionView;
+
+void main()
+{
+  o_color = i_color;
+  gl_Position = u_projectionView * vec4(i_position, 1.0);
+}
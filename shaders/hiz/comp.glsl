@@ -0,0 +1,29 @@
+#version 430 core
+
+// One level of the depth pyramid: every texel is the farthest of the 2x2 texels under it
+// Odd sizes clamp to the last row/column, that only repeats a value so nothing is lost
+
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(r32f, binding=0) writeonly uniform image2D u_destination;
+
+uniform sampler2D u_source;   // depth texture for level 0, the pyramid itself after that
+uniform int u_sourceLevel;
+uniform ivec2 u_sourceSize;
+
+
+void main()
+{
+  ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+  if (any(greaterThanEqual(texel, imageSize(u_destination)))) return;
+
+  ivec2 source = texel * 2;
+  ivec2 last = u_sourceSize - 1;
+
+  float d0 = texelFetch(u_source, min(source, last), u_sourceLevel).r;
+  float d1 = texelFetch(u_source, min(source + ivec2(1, 0), last), u_sourceLevel).r;
+  float d2 = texelFetch(u_source, min(source + ivec2(0, 1), last), u_sourceLevel).r;
+  float d3 = texelFetch(u_source, min(source + ivec2(1, 1), last), u_sourceLevel).r;
+
+  imageStore(u_destination, texel, vec4(max(max(d0, d1), max(d2, d3))));
+}
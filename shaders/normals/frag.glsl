@@ -1,4 +1,5 @@
 #version 430 core
+#extension GL_ARB_bindless_texture : enable
 
 layout(location=0) in vec3 i_fragPos;
 layout(location=1) in vec3 i_normals;
@@ -7,17 +8,17 @@ layout(location=3) in vec3 i_tangents;
 layout(location=4) in vec3 i_bitangents;
 layout(location=5) in vec3 i_gouraudShadingResult;
 layout(location=6) in vec4 i_fragPosLightSpace[9];
+layout(location=15) flat in vec4 i_color; // w is the instance id
 
 out vec4 o_fragColor;
 
 layout(binding=0) uniform sampler2D u_ShadowMaps[9];
-layout(binding=9) uniform sampler2D u_texture;
 
 uniform vec3 u_viewPos;
 uniform int u_isPhong;
-uniform vec3 u_color;
 
-uniform vec3 u_lightPos;
+uniform vec3 u_lightPositions[9]; // from the scene file, the index is the shadow map too
+uniform uint u_activeLights;       // lights in a cell the camera can see [portals]
 uniform vec3 u_lightColor;
 uniform float u_lightAttenLinear;
 uniform float u_lightAttenQuad;
@@ -31,8 +32,35 @@ uniform vec3 u_dirLightPosition;
 uniform vec2 u_poissionSamplingPoints[32];
 
 const int numLights = 9;
-const float distBwLightRow = 4.01f;
-const float distBwLightCol = 4.1f;
+
+struct InstanceData
+{
+  mat4 model;
+  mat3 normalMatrix;   // inverse transpose of the model's 3x3 [std430: 3 vec4 columns]
+  vec4 color;
+  uint lightMask;      // bit i = light i reaches this instance
+  uint textureLayer;   // layer in the bucket's texture array
+  uvec2 textureHandle; // bindless handle, zero when arrays are used
+};
+layout(std430, binding=0) readonly buffer Instances { InstanceData instances[]; };
+
+layout(binding=9) uniform sampler2DArray u_textures; // the bucket's array [unused with bindless]
+uniform int u_bindlessTextures;
+
+
+// Texture of the instance, from its resident handle or its layer of the bound array
+vec4 InstanceTexture(uint instanceId, vec2 uv)
+{
+#ifdef GL_ARB_bindless_texture
+  if (u_bindlessTextures == 1)
+  {
+    uvec2 handle = instances[instanceId].textureHandle;
+    if (handle == uvec2(0u)) return vec4(0.0, 0.0, 0.0, 1.0); // untextured, same as an empty unit
+    return texture(sampler2D(handle), uv);
+  }
+#endif
+  return texture(u_textures, vec3(uv, float(instances[instanceId].textureLayer)));
+}
 
 float innerCutOff = cos(radians(u_lightInnerCutOffAngle));
 float outerCutOff = cos(radians(u_lightOuterCutOffAngle));
@@ -81,18 +109,19 @@ vec3 PhongShading(vec3 normals)
   vec3 specular = vec3(0.0f);
 
   vec3 new_lightPos = vec3(0.0f);
-  float refX = u_lightPos.x;
-  float refY = u_lightPos.y;
-  float refZ = u_lightPos.z;
 
   // Ambient
   ambient = u_lightAmbientStrength * u_lightColor;
 
+  uint lightMask = instances[uint(i_color.w)].lightMask & u_activeLights;
+
+  // the loop index stays the sampler index [has to be dynamically uniform], lights
+  // that can't reach this instance are just skipped
   for (int i = 0; i < numLights; i++)
   {
-    new_lightPos.x = refX -  (distBwLightCol * (i / 3));
-    new_lightPos.y = refY;
-    new_lightPos.z = refZ - (distBwLightRow * (i % 3)); 
+    if ((lightMask & (1u << i)) == 0u) continue;
+
+    new_lightPos = u_lightPositions[i];
 
     vec3 lightDir = normalize(new_lightPos - i_fragPos); // both in world space
                                                          // goes from frag to light source
@@ -161,9 +190,9 @@ vec3 PhongShading(vec3 normals)
 
 void main() 
 {
-  float r = u_color.r / 255.0;
-  float g = u_color.g / 255.0;
-  float b = u_color.b / 255.0;
+  float r = i_color.r / 255.0;
+  float g = i_color.g / 255.0;
+  float b = i_color.b / 255.0;
   o_fragColor = vec4(r, g, b, 1.0);
   vec3 result = vec3(0.0, 0.0, 0.0); 
 
@@ -175,7 +204,7 @@ void main()
       B = B * -1.0;
   }
 
-  vec3 bumpMapNormal = texture(u_texture, i_uv).xyz;
+  vec3 bumpMapNormal = InstanceTexture(uint(i_color.w), i_uv).xyz;
   bumpMapNormal = 2.0 * bumpMapNormal - vec3(1.0); // going from color space to normal space
 
   mat3 TBN = mat3(T, B, N);
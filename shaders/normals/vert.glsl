@@ -5,6 +5,7 @@ layout(location=1) in vec2 i_uv;
 layout(location=2) in vec3 i_normals;
 layout(location=3) in vec3 i_tangents;
 layout(location=4) in vec3 i_bitangents;
+layout(location=5) in uint i_instanceId; // slot in the instance SSBO
 
 layout(location=0) out vec3 o_fragPos;
 layout(location=1) out vec3 o_normals;
@@ -13,12 +14,24 @@ layout(location=3) out vec3 o_tangents;
 layout(location=4) out vec3 o_bitangents;
 layout(location=5) out vec3 o_gouraudShadingResult;
 layout(location=6) out vec4 o_fragPosLightSpace[9];
+layout(location=15) flat out vec4 o_color; // w is the instance id [no location left for a uint]
+
+struct InstanceData
+{
+  mat4 model;
+  mat3 normalMatrix;   // inverse transpose of the model's 3x3 [std430: 3 vec4 columns]
+  vec4 color;
+  uint lightMask;      // bit i = light i reaches this instance
+  uint textureLayer;   // layer in the bucket's texture array
+  uvec2 textureHandle; // bindless handle, zero when arrays are used
+};
+layout(std430, binding=0) readonly buffer Instances { InstanceData instances[]; };
 
-uniform mat4 u_model;
 uniform mat4 u_view;
 uniform mat4 u_projection;
 
-uniform vec3 u_lightPos;
+uniform vec3 u_lightPositions[9]; // from the scene file, the index is the shadow map too
+uniform uint u_activeLights;       // lights in a cell the camera can see [portals]
 uniform vec3 u_lightColor;
 uniform mat4 u_lightProjectionViewMatrix[9];
 uniform float u_lightAttenLinear;
@@ -35,31 +48,27 @@ uniform vec3 u_viewPos; // for specular
 uniform int u_isPhong;
 
 const int numLights = 9;
-const float distBwLightRow = 4.01f;
-const float distBwLightCol = 4.1f;
 
 float innerCutOff = cos(radians(u_lightInnerCutOffAngle));
 float outerCutOff = cos(radians(u_lightOuterCutOffAngle));
 
-vec3 GouraudShading(vec3 o_fragPos, vec3 o_normals) 
+vec3 GouraudShading(vec3 o_fragPos, vec3 o_normals, uint lightMask) 
 {
   vec3 ambient = vec3(0.0f);
   vec3 diffuse = vec3(0.0f);
   vec3 specular = vec3(0.0f);
 
   vec3 new_lightPos = vec3(0.0f);
-  float refX = u_lightPos.x;
-  float refY = u_lightPos.y;
-  float refZ = u_lightPos.z;
 
   // Ambient
   ambient = u_lightAmbientStrength * u_lightColor;
 
+  // lights that can't reach this instance are skipped [masks are made on the CPU]
   for (int i = 0; i < numLights; i++)
   {
-    new_lightPos.x = refX -  (distBwLightCol * (i / 3));
-    new_lightPos.y = refY;
-    new_lightPos.z = refZ - (distBwLightRow * (i % 3)); 
+    if ((lightMask & (1u << i)) == 0u) continue;
+
+    new_lightPos = u_lightPositions[i];
 
 
     vec3 lightDir = normalize(new_lightPos - o_fragPos); // both in world space
@@ -92,16 +101,19 @@ vec3 GouraudShading(vec3 o_fragPos, vec3 o_normals)
 
 void main()
 {
-  o_fragPos = vec3(u_model * vec4(i_position, 1.0));
+  mat4 model = instances[i_instanceId].model;
+  o_fragPos = vec3(model * vec4(i_position, 1.0));
   o_uv = i_uv;
-  o_normals = normalize(mat3(transpose(inverse(u_model))) * i_normals);
-  o_tangents = normalize(mat3(u_model) * i_tangents);
-  o_bitangents = normalize(mat3(u_model) * i_bitangents);
+  o_normals = normalize(instances[i_instanceId].normalMatrix * i_normals);
+  o_tangents = normalize(mat3(model) * i_tangents);
+  o_bitangents = normalize(mat3(model) * i_bitangents);
+  uint lightMask = instances[i_instanceId].lightMask & u_activeLights;
+  o_color = vec4(instances[i_instanceId].color.rgb, float(i_instanceId)); // exact below 2^24
   o_gouraudShadingResult = vec3(0.0, 0.0, 0.0);
 
   if (u_isPhong == 0)
   {
-    o_gouraudShadingResult = GouraudShading(o_fragPos, o_normals);
+    o_gouraudShadingResult = GouraudShading(o_fragPos, o_normals, lightMask);
   }
 
   for (int i = 0; i < 9; i++)
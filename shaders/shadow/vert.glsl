@@ -1,12 +1,23 @@
-#version 410 core
+#version 430 core
 
 layout(location=0) in vec3 i_position;
+layout(location=5) in uint i_instanceId; // slot in the instance SSBO
+
+struct InstanceData
+{
+  mat4 model;
+  mat3 normalMatrix;   // inverse transpose of the model's 3x3 [std430: 3 vec4 columns]
+  vec4 color;
+  uint lightMask;      // bit i = light i reaches this instance
+  uint textureLayer;   // layer in the bucket's texture array
+  uvec2 textureHandle; // bindless handle, zero when arrays are used
+};
+layout(std430, binding=0) readonly buffer Instances { InstanceData instances[]; };
 
-uniform mat4 u_model;
 uniform mat4 u_view;
 uniform mat4 u_projection;
 
 void main()
 {
-  gl_Position = u_projection * u_view * u_model * vec4(i_position, 1.0); 
+  gl_Position = u_projection * u_view * instances[i_instanceId].model * vec4(i_position, 1.0); 
 }
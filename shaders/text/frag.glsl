@@ -0,0 +1,14 @@
+#version 430 core
+
+layout(location=0) in vec2 i_uv;
+layout(location=1) in vec4 i_color;
+
+out vec4 o_fragColor;
+
+uniform sampler2D u_font; // R8 atlas, 0 or 1
+
+void main()
+{
+  if (texture(u_font, i_uv).r < 0.5) discard;
+  o_fragColor = i_color;
+}
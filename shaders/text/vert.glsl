@@ -0,0 +1,18 @@
+#version 430 core
+
+layout(location=0) in vec2 i_position; // pixels, y down
+layout(location=1) in vec2 i_uv;
+layout(location=2) in vec4 i_color;
+
+layout(location=0) out vec2 o_uv;
+layout(location=1) out vec4 o_color;
+
+uniform vec2 u_screenSize;
+
+void main()
+{
+  o_uv = i_uv;
+  o_color = i_color;
+  vec2 ndc = i_position / u_screenSize * 2.0 - 1.0;
+  gl_Position = vec4(ndc.x, -ndc.y, 0.0, 1.0);
+}
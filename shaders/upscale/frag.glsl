@@ -0,0 +1,46 @@
+#version 430 core
+
+// The scene drawn at u_renderSize [bottom left of u_source] stretched over the window
+// Bilinear, then an unsharp mask on the cross around the texel, clamped to the min / max of
+// that cross so edges don't ring [contrast adaptive sharpening, roughly]
+
+layout(location=0) in vec2 i_uv;
+
+out vec4 o_fragColor;
+
+uniform sampler2D u_source;  // RenderTarget::mColorTexture, full size
+uniform vec2 u_renderSize;   // pixels of it that were drawn
+uniform float u_sharpness;   // 0 = bilinear only, 1 = strong
+
+
+void main()
+{
+  vec2 texel = 1.0 / vec2(textureSize(u_source, 0));
+
+  // stay half a texel inside the drawn corner, what's past it is an older frame
+  vec2 uv = i_uv * u_renderSize * texel;
+  vec2 lo = 0.5 * texel, hi = (u_renderSize - 0.5) * texel;
+  uv = clamp(uv, lo, hi);
+
+  vec3 center = texture(u_source, uv).rgb;
+  if (u_sharpness <= 0.0)
+  {
+    o_fragColor = vec4(center, 1.0);
+    return;
+  }
+
+  vec3 north = texture(u_source, clamp(uv + vec2(0.0, texel.y), lo, hi)).rgb;
+  vec3 south = texture(u_source, clamp(uv - vec2(0.0, texel.y), lo, hi)).rgb;
+  vec3 east  = texture(u_source, clamp(uv + vec2(texel.x, 0.0), lo, hi)).rgb;
+  vec3 west  = texture(u_source, clamp(uv - vec2(texel.x, 0.0), lo, hi)).rgb;
+
+  vec3 low = min(center, min(min(north, south), min(east, west)));
+  vec3 high = max(center, max(max(north, south), max(east, west)));
+
+  // less where the cross already has contrast, that's where it would overshoot
+  vec3 headroom = clamp(min(low, 1.0 - high) / max(high, 1e-4), 0.0, 1.0);
+  vec3 amount = u_sharpness * sqrt(headroom);
+
+  vec3 sharpened = center + amount * (4.0 * center - north - south - east - west) * 0.25;
+  o_fragColor = vec4(clamp(sharpened, low, high), 1.0);
+}
@@ -0,0 +1,11 @@
+#version 430 core
+
+layout(location=0) out vec2 o_uv; // 0 - 1 over the window
+
+// One triangle over the whole window, no vertex buffer
+void main()
+{
+  vec2 corner = vec2((gl_VertexID << 1) & 2, gl_VertexID & 2);
+  o_uv = corner;
+  gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);
+}
@@ -3,18 +3,32 @@
 layout(location=0) in vec3 i_position;
 layout(location=1) in vec2 i_texCoordinates;
 layout(location=2) in vec3 i_normals;
+layout(location=5) in uint i_instanceId; // slot in the instance SSBO
 
 layout(location=0) out vec3 o_fragPos;
 layout(location=1) out vec3 o_normals;
 layout(location=2) out vec2 o_uv;
 layout(location=3) out vec3 o_gouraudShadingResult;
 layout(location=4) out vec4 o_fragPosLightSpace[9];
+layout(location=13) flat out uint o_lightMask;
+layout(location=14) flat out uint o_instanceId; // the fragment shader looks up its texture
+
+struct InstanceData
+{
+  mat4 model;
+  mat3 normalMatrix;   // inverse transpose of the model's 3x3 [std430: 3 vec4 columns]
+  vec4 color;
+  uint lightMask;      // bit i = light i reaches this instance
+  uint textureLayer;   // layer in the bucket's texture array
+  uvec2 textureHandle; // bindless handle, zero when arrays are used
+};
+layout(std430, binding=0) readonly buffer Instances { InstanceData instances[]; };
 
-uniform mat4 u_model; // Local to world
 uniform mat4 u_view;
 uniform mat4 u_projection;
 
-uniform vec3 u_lightPos;
+uniform vec3 u_lightPositions[9]; // from the scene file, the index is the shadow map too
+uniform uint u_activeLights;       // lights in a cell the camera can see [portals]
 uniform vec3 u_lightColor;
 uniform mat4 u_lightProjectionViewMatrix[9];
 uniform float u_lightAttenLinear;
@@ -30,32 +44,28 @@ uniform vec3 u_viewPos;
 uniform int u_isPhong;
 
 const int numLights = 9;
-const float distBwLightRow = 4.01f;
-const float distBwLightCol = 4.1f;
 
 float innerCutOff = cos(radians(u_lightInnerCutOffAngle));
 float outerCutOff = cos(radians(u_lightOuterCutOffAngle));
 
 
-vec3 GouraudShading(vec3 o_fragPos, vec3 o_normals) 
+vec3 GouraudShading(vec3 o_fragPos, vec3 o_normals, uint lightMask) 
 {
   vec3 ambient = vec3(0.0f);
   vec3 diffuse = vec3(0.0f);
   vec3 specular = vec3(0.0f);
 
   vec3 new_lightPos = vec3(0.0f);
-  float refX = u_lightPos.x;
-  float refY = u_lightPos.y;
-  float refZ = u_lightPos.z;
 
   // Ambient
   ambient = u_lightAmbientStrength * u_lightColor;
 
+  // lights that can't reach this instance are skipped [masks are made on the CPU]
   for (int i = 0; i < numLights; i++)
   {
-    new_lightPos.x = refX -  (distBwLightCol * (i / 3));
-    new_lightPos.y = refY;
-    new_lightPos.z = refZ - (distBwLightRow * (i % 3)); 
+    if ((lightMask & (1u << i)) == 0u) continue;
+
+    new_lightPos = u_lightPositions[i];
 
 
     vec3 lightDir = normalize(new_lightPos - o_fragPos); // both in world space
@@ -89,19 +99,23 @@ vec3 GouraudShading(vec3 o_fragPos, vec3 o_normals)
 void main() {
   // Just to get coord of world space, as the light position 
   // is defined in world space
-  o_fragPos = vec3(u_model * vec4(i_position, 1.0));
+  mat4 model = instances[i_instanceId].model;
+  o_fragPos = vec3(model * vec4(i_position, 1.0));
 
   // Similarly to get coord of world space for normals, but
   // the problem with normal scaling, when scaling in model
-  // matrix is not uniform, the normals are no longer normals
-  o_normals = normalize(mat3(transpose(inverse(u_model))) * i_normals);
+  // matrix is not uniform, the normals are no longer normals [inverse transpose, made
+  // once per instance on the CPU, TransformArray]
+  o_normals = normalize(instances[i_instanceId].normalMatrix * i_normals);
 
   o_uv = i_texCoordinates;
+  o_lightMask = instances[i_instanceId].lightMask & u_activeLights;
+  o_instanceId = i_instanceId;
   
   o_gouraudShadingResult = vec3(0.0, 0.0, 0.0);
   if (u_isPhong == 0)
   {
-    o_gouraudShadingResult = GouraudShading(o_fragPos, o_normals);
+    o_gouraudShadingResult = GouraudShading(o_fragPos, o_normals, o_lightMask);
   }
   else
   {
@@ -0,0 +1,130 @@
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <cstdlib>
+#include <cstring>
+
+#include "allocTracker.hpp"
+
+thread_local int Allocations::mCurrent = 0;
+std::atomic<uint64_t> Allocations::mCounts[Allocations::mMaxScopes] = {};
+std::atomic<uint64_t> Allocations::mByteCounts[Allocations::mMaxScopes] = {};
+
+// fixed size, registering a scope can't allocate [it may happen inside operator new's caller]
+static const char* gScopeNames[Allocations::mMaxScopes] = {"other"};
+static std::atomic<int> gScopeCount{1};
+static std::mutex gScopeMutex;
+
+
+bool Allocations::mEnabled()
+{
+#ifdef TRACK_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+
+int Allocations::mScope(const char* name)
+{
+  // same literal almost always, the strcmp is for the same name from two places
+  int count = gScopeCount.load(std::memory_order_acquire);
+  for (int i = 0; i < count; i++)
+  {
+    if (gScopeNames[i] == name || strcmp(gScopeNames[i], name) == 0) return i;
+  }
+
+  std::lock_guard<std::mutex> lock(gScopeMutex);
+  count = gScopeCount.load(std::memory_order_relaxed);
+  for (int i = 0; i < count; i++)
+  {
+    if (strcmp(gScopeNames[i], name) == 0) return i;
+  }
+  if (count == mMaxScopes) return 0;
+
+  gScopeNames[count] = name;
+  gScopeCount.store(count + 1, std::memory_order_release);
+  return count;
+}
+
+
+void Allocations::mPrintReport(const char* title)
+{
+  if (!mEnabled()) return;
+
+  // counts first, printing allocates too
+  int count = gScopeCount.load(std::memory_order_acquire);
+  uint64_t counts[mMaxScopes], bytes[mMaxScopes];
+  for (int i = 0; i < count; i++)
+  {
+    counts[i] = mCount(i);
+    bytes[i] = mBytes(i);
+  }
+
+  std::cout << "Allocations " << title << ":" << std::endl;
+  for (int i = 0; i < count; i++)
+  {
+    if (counts[i] == 0) continue;
+    std::cout << "  " << gScopeNames[i] << ": " << counts[i] << " [" << bytes[i] / 1024 << " KB]" << std::endl;
+  }
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ OPERATOR NEW / DELETE ~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+#ifdef TRACK_ALLOCATIONS
+
+static void* trackedAllocate(size_t bytes, size_t alignment = 0)
+{
+  Allocations::mOnAllocate(bytes);
+  if (bytes == 0) bytes = 1;
+  if (alignment <= alignof(std::max_align_t)) return malloc(bytes);
+
+  void* pointer = nullptr;
+  return posix_memalign(&pointer, alignment, bytes) == 0 ? pointer : nullptr;
+}
+
+void* operator new(size_t bytes)
+{
+  void* pointer = trackedAllocate(bytes);
+  if (!pointer) throw std::bad_alloc();
+  return pointer;
+}
+
+void* operator new[](size_t bytes)
+{
+  void* pointer = trackedAllocate(bytes);
+  if (!pointer) throw std::bad_alloc();
+  return pointer;
+}
+
+void* operator new(size_t bytes, std::align_val_t alignment)
+{
+  void* pointer = trackedAllocate(bytes, (size_t)alignment);
+  if (!pointer) throw std::bad_alloc();
+  return pointer;
+}
+
+void* operator new[](size_t bytes, std::align_val_t alignment)
+{
+  void* pointer = trackedAllocate(bytes, (size_t)alignment);
+  if (!pointer) throw std::bad_alloc();
+  return pointer;
+}
+
+void* operator new(size_t bytes, const std::nothrow_t&) noexcept { return trackedAllocate(bytes); }
+void* operator new[](size_t bytes, const std::nothrow_t&) noexcept { return trackedAllocate(bytes); }
+
+void operator delete(void* pointer) noexcept { free(pointer); }
+void operator delete[](void* pointer) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t) noexcept { free(pointer); }
+void operator delete(void* pointer, std::align_val_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, std::align_val_t) noexcept { free(pointer); }
+void operator delete(void* pointer, size_t, std::align_val_t) noexcept { free(pointer); }
+void operator delete[](void* pointer, size_t, std::align_val_t) noexcept { free(pointer); }
+void operator delete(void* pointer, const std::nothrow_t&) noexcept { free(pointer); }
+void operator delete[](void* pointer, const std::nothrow_t&) noexcept { free(pointer); }
+
+#endif
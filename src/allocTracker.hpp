@@ -0,0 +1,57 @@
+#ifndef ALLOC_TRACKER_HEADER
+#define ALLOC_TRACKER_HEADER
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// Heap allocations per scope. Built with -DTRACK_ALLOCATIONS the global operator new /
+// delete are replaced [allocTracker.cpp] and every new is counted under the scope its
+// thread is in; without it nothing is replaced and every count stays 0
+//
+// A scope is a name, its AllocScope sets it for the thread until it goes out of scope
+// [they nest, the innermost counts]. Threads start in "other". Only operator new is seen,
+// what GL / GLFW / stb get from malloc isn't
+class Allocations
+{
+  public:
+    static const int mMaxScopes = 32;
+
+    static bool mEnabled();
+
+    static int mScope(const char* name); // id, registered on first use [name must stay alive]
+    static uint64_t mCount(int scope) { return mCounts[scope].load(std::memory_order_relaxed); }
+    static uint64_t mBytes(int scope) { return mByteCounts[scope].load(std::memory_order_relaxed); }
+    static uint64_t mCount(const char* name) { return mCount(mScope(name)); }
+
+    static void mPrintReport(const char* title);
+
+    // operator new
+    static void mOnAllocate(size_t bytes)
+    {
+      int scope = mCurrent;
+      mCounts[scope].fetch_add(1, std::memory_order_relaxed);
+      mByteCounts[scope].fetch_add(bytes, std::memory_order_relaxed);
+    }
+
+  private:
+    friend class AllocScope;
+
+    static thread_local int mCurrent;
+    static std::atomic<uint64_t> mCounts[mMaxScopes];
+    static std::atomic<uint64_t> mByteCounts[mMaxScopes];
+};
+
+class AllocScope
+{
+  public:
+    explicit AllocScope(const char* name) : mPrevious(Allocations::mCurrent) { Allocations::mCurrent = Allocations::mScope(name); }
+    ~AllocScope() { Allocations::mCurrent = mPrevious; }
+
+    AllocScope(const AllocScope&) = delete;
+    AllocScope& operator=(const AllocScope&) = delete;
+
+  private:
+    int mPrevious;
+};
+#endif
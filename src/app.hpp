@@ -7,10 +7,54 @@
 
 #include <vector>
 #include <map>
+#include <mutex>
 
 #include "camera.hpp"
 #include "light.hpp"
 #include "mesh.hpp"
+#include "meshlet.hpp"
+#include "frustum.hpp"
+#include "gpuScene.hpp"
+#include "occlusionCuller.hpp"
+#include "portalVisibility.hpp"
+#include "renderTarget.hpp"
+#include "depthPyramid.hpp"
+#include "gpuTimer.hpp"
+#include "textureCache.hpp"
+#include "textureStreamer.hpp"
+#include "textureBudget.hpp"
+#include "sceneFile.hpp"
+#include "sceneStore.hpp"
+#include "benchmark.hpp"
+#include "jobSystem.hpp"
+#include "renderPacket.hpp"
+#include "streamBuffer.hpp"
+#include "debugDraw.hpp"
+#include "counters.hpp"
+#include "pipelineStats.hpp"
+#include "textOverlay.hpp"
+#include "idleMonitor.hpp"
+#include "dynamicResolution.hpp"
+
+// Counters for the last frame, printed in the window title [the GPU ones come from the
+// render thread, App::mRenderStats]
+struct FrameStats
+{
+  long mSubmittedTriangles = 0;
+  long mCulledTriangles = 0;
+  float mOcclusionRatio = 0.0f; // hidden / tested instances
+  long mHiZOccludedClusters = 0;
+  long mHiZRecoveredClusters = 0;
+  int mVisibleCells = 0;        // portal visibility, 0 when the scene has no cells
+  float mCullMs = 0.0f;         // GPU time of the first cull
+  float mHiZMs = 0.0f;          // depth resolve + pyramid + second cull
+  float mCpuCullMs = 0.0f;      // portals + CPU occlusion, wall clock over every thread
+  float mInputLatencyMs = 0.0f; // input read -> swap of the frame it went into
+  float mGpuFrameMs = 0.0f;     // GPU start -> end of the whole frame, a few frames old
+  float mRenderScale = 1.0f;    // dynamic resolution, per axis
+  float mLightsPerInstance = 0.0f; // of the last light masks [GpuScene::mSetLightMasks]
+  int64_t mCounters[CounterIdCount] = {}; // Counters::mCollect of the last rendered frame
+};
 
 struct App
 {
@@ -30,18 +74,61 @@ struct App
   GLuint mCeilingLightGraphicsPipelineShaderProgram = 0;
 
   Light mLights[9];
-  int mLightsNumber = 9;
+  int mLightsNumber = 9; // what the scene file has
+  bool mLightsDirty = true; // light masks have to be redone
 
-  glm::vec3 mRefLightPos = glm::vec3(-3.5f, 4.93f, -1.5f);
   glm::vec3 mLightColor = glm::vec3(1.0f, 1.0f, 1.0f);
   glm::mat4 mLightProjectionViewMatrixCombined[9];
   glm::vec3 mExtraLightPosition = glm::vec3(-0.5f, 4.3f, -5.0f);
 
-  float mDistBwLightRow = 4.01f;
-  float mDistBwLightCol = 4.1f;
-
   Camera mCamera;
-  std::map<std::string, Mesh3D> meshes;
+  SceneSnapshot mSceneFile;
+  SceneStore mStore; // assets + every instance
+  TextureCache mTextureCache;
+  TextureStreamer mTextureStreamer;
+  TextureBudget mTextureBudget;
+  GpuScene mScene;
+
+  bool mMeshletConeCulling = true;
+  bool mOcclusionCulling = true;
+  OcclusionCuller mOcclusionCuller;
+
+  bool mPortalCulling = true;
+  PortalVisibility mPortals;
+
+  bool mHiZCulling = true;
+  RenderTarget mSceneTarget;
+  DepthPyramid mDepthPyramid;
+  GpuTimer mCullTimer;
+  GpuTimer mHiZTimer;
+  GpuFrameTimer mFrameTimer;
+  DynamicResolution mDynamicRes; // render thread, --dynamic-res 1
+  FrameStats mStats;
+  float mStatsLastPrint = 0.0f;
+  Benchmark mBenchmark;
+  JobSystem mJobs;
+  int mThreads = 0; // --threads, 0 = every hardware thread
+
+  // simulation [main thread] -> render thread, the GL context lives on the latter
+  bool mRenderThread = true; // --render-thread 0 draws on the main thread
+  RenderPacketQueue mPackets;
+  StreamBuffer mStream; // render thread
+  DebugDraw mDebugDraw; // B, filled on the simulation thread
+  DebugRenderer mDebugRenderer;
+  bool mOverlay = false; // I, counters over the scene
+  bool mDumpCounters = false; // J, counters.json on the next frame
+  bool mPrintMemory = false;  // M, memory report on the next frame
+  std::vector<TextureSwap> mTextureSwaps; // render thread, reused every frame
+  IdleMonitor mIdle;          // redraw on demand [--idle 0 turns it off]
+  FrameInputs mLastInputs;
+  bool mNeedsPresent = false; // the window asked for its contents again while idle
+  TextOverlay mTextOverlay;
+  PipelineStats mScenePipelineStats;    // the main pass
+  PipelineStats mRecoveryPipelineStats; // the Hi-Z disoccluded pass
+  const char* mCountersJson = nullptr;  // --counters-json, the benchmark's averages go there
+  uint64_t mFrame = 0;
+  FrameStats mRenderStats; // written by the render thread
+  std::mutex mStatsMutex;
   std::vector<glm::vec2> mPoissionSamplingPoints;
 };
 
@@ -52,10 +139,6 @@ struct Grid
   float mTileSizeX = 1.0f;
   float mTileSizeY = 1.0f;
 
-  GLuint mVertexArrayObject = 0; 
-  GLuint mVertexBufferObjectH = 0;
-  GLuint mVertexBufferObjectV = 0;
-
   std::vector<glm::vec3> mVertexDataH; // data for horizontal points
   std::vector<glm::vec3> mVertexDataV;
 };
@@ -0,0 +1,398 @@
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "assetArchive.hpp"
+
+AssetArchive gAssets;
+
+static const char gMagic[4] = {'P', 'A', 'C', 'K'};
+static const uint32_t gVersion = 1;
+static const uint32_t gCompressed = 1; // Entry::mFlags
+static const size_t gAlignment = 64;
+
+struct ArchiveHeader
+{
+  char mMagic[4];
+  uint32_t mVersion;
+  uint32_t mEntryCount;
+  uint32_t mReserved;
+  uint64_t mTocOffset;
+};
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ LZ4 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// token [literal length | match length - 4], longer lengths spill into 255 runs,
+// literals, 2 byte offset back into the output. The last 5 bytes are always literals
+// and no match starts in the last 12 [the reference decoder relies on both]
+static const size_t gMinMatch = 4;
+static const size_t gLastLiterals = 5;
+static const size_t gMatchStartLimit = 12;
+static const int gHashBits = 14;
+
+static uint32_t read32(const unsigned char* p)
+{
+  uint32_t value;
+  memcpy(&value, p, 4);
+  return value;
+}
+
+
+static void writeLength(size_t length, std::vector<unsigned char>& out)
+{
+  for (; length >= 255; length -= 255) out.push_back(255);
+  out.push_back((unsigned char)length);
+}
+
+
+static void writeSequence(const unsigned char* literals, size_t literalCount, size_t offset, size_t matchLength,
+                          std::vector<unsigned char>& out)
+{
+  size_t tokenAt = out.size();
+  out.push_back((unsigned char)(std::min<size_t>(literalCount, 15) << 4));
+  if (literalCount >= 15) writeLength(literalCount - 15, out);
+  out.insert(out.end(), literals, literals + literalCount);
+
+  if (matchLength == 0) return; // the closing literals only sequence
+
+  out.push_back((unsigned char)(offset & 0xFF));
+  out.push_back((unsigned char)(offset >> 8));
+  size_t extra = matchLength - gMinMatch;
+  out[tokenAt] |= (unsigned char)std::min<size_t>(extra, 15);
+  if (extra >= 15) writeLength(extra - 15, out);
+}
+
+
+void lz4Compress(const unsigned char* source, size_t size, std::vector<unsigned char>& out)
+{
+  out.clear();
+  out.reserve(size + size / 255 + 16);
+
+  // last position every 4 byte sequence was seen at [greedy, one candidate per hash]
+  std::vector<int64_t> table(1 << gHashBits, -1);
+  auto hash = [](uint32_t sequence) { return (sequence * 2654435761u) >> (32 - gHashBits); };
+
+  size_t anchor = 0, position = 0;
+  while (size >= gMatchStartLimit && position + gMatchStartLimit <= size)
+  {
+    uint32_t sequence = read32(source + position);
+    uint32_t slot = hash(sequence);
+    int64_t candidate = table[slot];
+    table[slot] = (int64_t)position;
+
+    if (candidate < 0 || position - candidate > 65535 || read32(source + candidate) != sequence)
+    {
+      position++;
+      continue;
+    }
+
+    size_t length = gMinMatch;
+    while (position + length < size - gLastLiterals && source[candidate + length] == source[position + length]) length++;
+
+    writeSequence(source + anchor, position - anchor, position - candidate, length, out);
+    position += length;
+    anchor = position;
+
+    // the match skipped over these, give the next one something to find
+    if (position + gMatchStartLimit <= size) table[hash(read32(source + position - 2))] = (int64_t)(position - 2);
+  }
+
+  writeSequence(source + anchor, size - anchor, 0, 0, out);
+}
+
+
+bool lz4Decompress(const unsigned char* source, size_t storedSize, unsigned char* destination, size_t size)
+{
+  size_t in = 0, out = 0;
+  while (in < storedSize)
+  {
+    unsigned char token = source[in++];
+
+    size_t literals = token >> 4;
+    if (literals == 15)
+    {
+      unsigned char byte;
+      do
+      {
+        if (in >= storedSize) return false;
+        byte = source[in++];
+        literals += byte;
+      } while (byte == 255);
+    }
+    if (literals > storedSize - in || literals > size - out) return false;
+    memcpy(destination + out, source + in, literals);
+    in += literals;
+    out += literals;
+
+    if (in == storedSize) break; // closing sequence has no match
+
+    if (storedSize - in < 2) return false;
+    size_t offset = source[in] | (source[in + 1] << 8);
+    in += 2;
+    if (offset == 0 || offset > out) return false;
+
+    size_t length = (token & 15) + gMinMatch;
+    if ((token & 15) == 15)
+    {
+      unsigned char byte;
+      do
+      {
+        if (in >= storedSize) return false;
+        byte = source[in++];
+        length += byte;
+      } while (byte == 255);
+    }
+    if (length > size - out) return false;
+
+    // overlapping copies repeat the last offset bytes, has to go one at a time
+    unsigned char* from = destination + out - offset;
+    if (offset >= length) memcpy(destination + out, from, length);
+    else for (size_t i = 0; i < length; i++) destination[out + i] = from[i];
+    out += length;
+  }
+  return out == size;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ READER ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// FNV-1a, same as the texture cache, "./" in front doesn't make it a different file
+uint64_t AssetArchive::mHashName(const char* path)
+{
+  while (path[0] == '.' && path[1] == '/') path += 2;
+
+  uint64_t hash = 14695981039346656037ull;
+  for (; *path; path++)
+  {
+    hash ^= (unsigned char)(*path == '\\' ? '/' : *path);
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+
+bool AssetArchive::mOpen(const char* path)
+{
+  mClose();
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0)
+  {
+    std::cout << "No " << path << ", loading loose asset files" << std::endl;
+    return false;
+  }
+
+  struct stat info;
+  void* mapping = MAP_FAILED;
+  if (fstat(fd, &info) == 0 && info.st_size >= (off_t)sizeof(ArchiveHeader))
+    mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd); // the mapping keeps the file
+
+  if (mapping == MAP_FAILED)
+  {
+    std::cout << "Failed to map asset archive: " << path << std::endl;
+    return false;
+  }
+
+  const unsigned char* bytes = (const unsigned char*)mapping;
+  size_t size = info.st_size;
+  ArchiveHeader header;
+  memcpy(&header, bytes, sizeof(header));
+
+  bool valid = memcmp(header.mMagic, gMagic, 4) == 0 && header.mVersion == gVersion &&
+               header.mTocOffset % gAlignment == 0 && header.mTocOffset <= size &&
+               (size - header.mTocOffset) / sizeof(Entry) >= header.mEntryCount;
+
+  const Entry* entries = (const Entry*)(bytes + header.mTocOffset);
+  for (uint32_t i = 0; i < header.mEntryCount && valid; i++)
+  {
+    valid = entries[i].mOffset <= header.mTocOffset && entries[i].mStoredSize <= header.mTocOffset - entries[i].mOffset;
+    // raw ones are handed out as mSize bytes of the mapping, that has to be what is stored
+    if (!(entries[i].mFlags & gCompressed)) valid = valid && entries[i].mSize == entries[i].mStoredSize;
+    if (i > 0) valid = valid && entries[i - 1].mNameHash < entries[i].mNameHash;
+  }
+
+  if (!valid)
+  {
+    std::cout << "Broken asset archive: " << path << std::endl;
+    munmap(mapping, size);
+    return false;
+  }
+
+  mMapping = bytes;
+  mMappingSize = size;
+  mEntries = entries;
+  mEntryCount = header.mEntryCount;
+
+  std::cout << "Assets: " << path << ", " << mEntryCount << " files, " << size / (1024.0 * 1024.0) << " MB mapped" << std::endl;
+  return true;
+}
+
+
+void AssetArchive::mClose()
+{
+  if (mMapping) munmap((void*)mMapping, mMappingSize);
+  mMapping = nullptr;
+  mMappingSize = 0;
+  mEntries = nullptr;
+  mEntryCount = 0;
+}
+
+
+const AssetArchive::Entry* AssetArchive::mFind(const char* path) const
+{
+  if (!mMapping) return nullptr;
+
+  uint64_t hash = mHashName(path);
+  const Entry* end = mEntries + mEntryCount;
+  const Entry* found = std::lower_bound(mEntries, end, hash,
+                                        [](const Entry& entry, uint64_t value) { return entry.mNameHash < value; });
+  return found != end && found->mNameHash == hash ? found : nullptr;
+}
+
+
+bool AssetArchive::mReadLoose(const char* path, std::vector<unsigned char>& bytes)
+{
+  FILE* fp = fopen(path, "rb");
+  if (!fp) return false;
+
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+
+  bytes.resize(size > 0 ? size : 0);
+  size_t read = size > 0 ? fread(bytes.data(), 1, bytes.size(), fp) : 0;
+  fclose(fp);
+
+  return size > 0 && read == bytes.size();
+}
+
+
+const unsigned char* AssetArchive::mLoad(const char* path, size_t* size, std::vector<unsigned char>& scratch)
+{
+  const Entry* entry = mFind(path);
+  if (entry && !(entry->mFlags & gCompressed))
+  {
+    mMappedLoads++;
+    *size = entry->mSize;
+    return mMapping + entry->mOffset;
+  }
+
+  if (entry)
+  {
+    auto start = std::chrono::steady_clock::now();
+    scratch.resize(entry->mSize);
+    bool ok = lz4Decompress(mMapping + entry->mOffset, entry->mStoredSize, scratch.data(), entry->mSize);
+    mDecompressMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    if (ok)
+    {
+      mDecompressedLoads++;
+      *size = scratch.size();
+      return scratch.data();
+    }
+    std::cout << "Broken archive entry, trying the loose file: " << path << std::endl;
+  }
+
+  if (!mReadLoose(path, scratch)) return nullptr;
+  mLooseLoads++;
+  *size = scratch.size();
+  return scratch.data();
+}
+
+
+void AssetArchive::mPrintReport() const
+{
+  std::cout << "Assets: " << mMappedLoads << " mapped, "
+            << mDecompressedLoads << " decompressed in " << mDecompressMs << " ms, "
+            << mLooseLoads << " loose files" << std::endl;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ WRITER ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+bool AssetArchiveWriter::mPad()
+{
+  static const unsigned char zeros[gAlignment] = {};
+  size_t padding = (gAlignment - mOffset % gAlignment) % gAlignment;
+  mOffset += padding;
+  return fwrite(zeros, 1, padding, mFile) == padding;
+}
+
+
+bool AssetArchiveWriter::mBegin(const char* path)
+{
+  mFile = fopen(path, "wb");
+  if (!mFile) return false;
+
+  // header gets its real values in mFinish
+  ArchiveHeader header = {};
+  mOffset = fwrite(&header, 1, sizeof(header), mFile);
+  mEntries.clear();
+  return mOffset == sizeof(header) && mPad();
+}
+
+
+bool AssetArchiveWriter::mAdd(const std::string& name, const std::vector<unsigned char>& bytes)
+{
+  if (!mFile || bytes.size() > UINT32_MAX) return false;
+
+  AssetArchive::Entry entry = {};
+  entry.mNameHash = AssetArchive::mHashName(name.c_str());
+  entry.mOffset = mOffset;
+  entry.mSize = (uint32_t)bytes.size();
+
+  for (const AssetArchive::Entry& other : mEntries)
+  {
+    if (other.mNameHash == entry.mNameHash)
+    {
+      std::cout << "Asset name hash collision: " << name << std::endl;
+      return false;
+    }
+  }
+
+  // images and .ctex barely shrink, those stay raw and load without a copy
+  std::vector<unsigned char> compressed;
+  lz4Compress(bytes.data(), bytes.size(), compressed);
+  bool useCompressed = compressed.size() < bytes.size() * 9 / 10;
+  const std::vector<unsigned char>& stored = useCompressed ? compressed : bytes;
+
+  entry.mStoredSize = (uint32_t)stored.size();
+  entry.mFlags = useCompressed ? gCompressed : 0;
+  if (fwrite(stored.data(), 1, stored.size(), mFile) != stored.size()) return false;
+  mOffset += stored.size();
+
+  mEntries.push_back(entry);
+  mRawBytes += bytes.size();
+  mStoredBytes += stored.size();
+  mCompressedCount += useCompressed;
+  return mPad();
+}
+
+
+bool AssetArchiveWriter::mFinish()
+{
+  if (!mFile) return false;
+
+  std::sort(mEntries.begin(), mEntries.end(),
+            [](const AssetArchive::Entry& a, const AssetArchive::Entry& b) { return a.mNameHash < b.mNameHash; });
+
+  ArchiveHeader header = {};
+  memcpy(header.mMagic, gMagic, 4);
+  header.mVersion = gVersion;
+  header.mEntryCount = (uint32_t)mEntries.size();
+  header.mTocOffset = mOffset;
+
+  bool ok = fwrite(mEntries.data(), sizeof(AssetArchive::Entry), mEntries.size(), mFile) == mEntries.size();
+  ok = ok && fseek(mFile, 0, SEEK_SET) == 0 && fwrite(&header, 1, sizeof(header), mFile) == sizeof(header);
+  ok = fclose(mFile) == 0 && ok;
+  mFile = nullptr;
+  return ok;
+}
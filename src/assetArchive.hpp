@@ -0,0 +1,90 @@
+#ifndef ASSET_ARCHIVE_HEADER
+#define ASSET_ARCHIVE_HEADER
+
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cstddef>
+
+// Every startup file [models, images, .ctex, shaders, data.txt] in one mmap'd file
+//
+//   header   "PACK", version, entry count, TOC offset            [first 64 bytes]
+//   blobs    each 64 byte aligned, LZ4 block compressed or raw
+//   TOC      entries sorted by FNV-1a hash of the path, no names stored
+//
+// Raw blobs are handed out straight from the mapping [no copy, no read], compressed ones
+// are decompressed into the caller's scratch. Anything not in the archive [or no archive
+// at all] comes from the loose file, so the plain Models/ + shaders/ tree keeps working
+//
+// Built by textureCooker/cook.cpp -pack
+
+class AssetArchive
+{
+  public:
+    bool mOpen(const char* path); // false when it isn't there, everything stays loose
+    void mClose();
+    bool mIsOpen() const { return mMapping != nullptr; }
+
+    // nullptr when neither the archive nor the disk has it
+    const unsigned char* mLoad(const char* path, size_t* size, std::vector<unsigned char>& scratch);
+    void mPrintReport() const;
+
+    static uint64_t mHashName(const char* path);
+
+    // report
+    int mMappedLoads = 0;
+    int mDecompressedLoads = 0;
+    int mLooseLoads = 0;
+    double mDecompressMs = 0.0;
+
+  private:
+    struct Entry
+    {
+      uint64_t mNameHash;
+      uint64_t mOffset;
+      uint32_t mStoredSize;
+      uint32_t mSize;
+      uint32_t mFlags;
+      uint32_t mReserved;
+    };
+
+    const unsigned char* mMapping = nullptr;
+    size_t mMappingSize = 0;
+    const Entry* mEntries = nullptr;
+    uint32_t mEntryCount = 0;
+
+    const Entry* mFind(const char* path) const;
+    static bool mReadLoose(const char* path, std::vector<unsigned char>& bytes);
+
+    friend class AssetArchiveWriter;
+};
+
+
+// Cooker side: blobs are streamed to the file as they are added, the TOC goes last
+class AssetArchiveWriter
+{
+  public:
+    bool mBegin(const char* path);
+    bool mAdd(const std::string& name, const std::vector<unsigned char>& bytes); // compressed when it pays
+    bool mFinish();
+
+    size_t mRawBytes = 0;
+    size_t mStoredBytes = 0;
+    int mCompressedCount = 0;
+
+  private:
+    FILE* mFile = nullptr;
+    uint64_t mOffset = 0;
+    std::vector<AssetArchive::Entry> mEntries;
+
+    bool mPad();
+};
+
+
+// LZ4 block format [no frame], compatible with LZ4_decompress_safe
+void lz4Compress(const unsigned char* source, size_t size, std::vector<unsigned char>& out);
+bool lz4Decompress(const unsigned char* source, size_t storedSize, unsigned char* destination, size_t size);
+
+extern AssetArchive gAssets;
+#endif
@@ -0,0 +1,197 @@
+#include "benchmark.hpp"
+#include "allocTracker.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+
+void Benchmark::mPose(const SceneBuilding& building, Camera* camera) const
+{
+  // t goes 0 -> 1 over the timed frames, warm up stands at the start
+  float t = (float)(mFrameIndex - mWarmupFrames) / mFrames;
+  t = std::min(std::max(t, 0.0f), 1.0f);
+
+  // the interactive start [Camera()], then one room step at a time
+  glm::vec3 start = glm::vec3(-7.5f, 2.4f, -5.5f);
+  glm::vec3 roomStep = glm::vec3(building.mRoomStep[0], building.mRoomStep[1], building.mRoomStep[2]);
+  glm::vec3 eye = start + t * (float)(building.mRooms - 1) * roomStep;
+
+  float yaw = -90.0f + 720.0f * t;
+  float pitch = 10.0f * std::sin(t * 6.2831853f * 3.0f);
+  camera->setPose(eye, yaw, pitch);
+}
+
+
+bool Benchmark::mRecord(float frameMs, float cullMs, float hiZMs, float cpuCullMs, float inputLatencyMs)
+{
+  if (mFrameIndex++ >= mWarmupFrames)
+  {
+    // the timed frames shouldn't allocate, these included
+    if (mFrameMs.empty())
+    {
+      for (std::vector<float>* times : {&mFrameMs, &mCullMs, &mHiZMs, &mCpuCullMs, &mInputLatencyMs}) times->reserve(mFrames);
+    }
+    mFrameMs.push_back(frameMs);
+    mCullMs.push_back(cullMs);
+    mHiZMs.push_back(hiZMs);
+    mCpuCullMs.push_back(cpuCullMs);
+    mInputLatencyMs.push_back(inputLatencyMs);
+  }
+  return (int)mFrameMs.size() < mFrames;
+}
+
+
+void Benchmark::mRecordCounters(const int64_t* counters)
+{
+  if (mFrameIndex < mWarmupFrames) return;
+  for (int id = 0; id < CounterIdCount; id++) mCounterSums[id] += (double)counters[id];
+  mCounterFrames++;
+}
+
+
+void Benchmark::mRecordScale(float scale, float gpuFrameMs)
+{
+  if (mFrameIndex < mWarmupFrames) return;
+
+  if (mScale.empty())
+  {
+    mScale.reserve(mFrames);
+    mGpuFrameMs.reserve(mFrames);
+  }
+  mScale.push_back(scale);
+  mGpuFrameMs.push_back(gpuFrameMs);
+}
+
+
+void Benchmark::mRecordAllocations(uint64_t total)
+{
+  uint64_t frame = total - mLastAllocations;
+  mLastAllocations = total;
+  if (mFrameIndex < mWarmupFrames) return;
+
+  mSteadyAllocations += frame;
+  if (frame > 0) mAllocatingFrames++;
+}
+
+
+static float percentile(std::vector<float> values, float p)
+{
+  if (values.empty()) return 0.0f;
+  size_t i = std::min(values.size() - 1, (size_t)(p * values.size()));
+  std::nth_element(values.begin(), values.begin() + i, values.end());
+  return values[i];
+}
+
+static float average(const std::vector<float>& values)
+{
+  double sum = 0.0;
+  for (float v : values) sum += v;
+  return values.empty() ? 0.0f : (float)(sum / values.size());
+}
+
+// resident now [statm] and the peak [getrusage, KB on Linux]
+static void residentMB(double* now, double* peak)
+{
+  *now = *peak = 0.0;
+
+  long pages = 0, resident = 0;
+  FILE* fp = fopen("/proc/self/statm", "r");
+  if (fp)
+  {
+    if (fscanf(fp, "%ld %ld", &pages, &resident) == 2) *now = resident * (double)sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+    fclose(fp);
+  }
+
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) *peak = usage.ru_maxrss / 1024.0;
+}
+
+
+void Benchmark::mPrintReport(size_t instances, const SceneBuilding& building, size_t textureBytes, int threads) const
+{
+  double rss, peakRss;
+  residentMB(&rss, &peakRss);
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "Benchmark: " << building.mFloors << " floors x " << building.mRooms << " rooms, "
+            << instances << " instances, " << mFrameMs.size() << " frames [" << mWarmupFrames << " warm up]" << std::endl
+            << "  startup   " << mStartupMs << " ms" << std::endl
+            << "  frame     avg " << average(mFrameMs) << ", p50 " << percentile(mFrameMs, 0.5f)
+            << ", p95 " << percentile(mFrameMs, 0.95f) << ", p99 " << percentile(mFrameMs, 0.99f)
+            << ", max " << percentile(mFrameMs, 1.0f) << " ms" << std::endl
+            << "  gpu cull  avg " << average(mCullMs) << " ms, hi-z avg " << average(mHiZMs) << " ms" << std::endl
+            << "  gpu frame avg " << average(mGpuFrameMs) << ", p95 " << percentile(mGpuFrameMs, 0.95f) << " ms" << std::endl
+            << "  cpu cull  avg " << average(mCpuCullMs) << ", p95 " << percentile(mCpuCullMs, 0.95f)
+            << " ms on " << threads << " threads" << std::endl
+            << "  input     avg " << average(mInputLatencyMs) << ", p95 " << percentile(mInputLatencyMs, 0.95f)
+            << " ms to the swap" << std::endl
+            << "  memory    " << rss << " MB resident, " << peakRss << " MB peak, "
+            << textureBytes / (1024.0 * 1024.0) << " MB textures in VRAM" << std::endl;
+
+  // per frame averages, four a line
+  std::cout << std::setprecision(0);
+  for (int id = 0; id < CounterIdCount; id++)
+  {
+    std::cout << (id % 4 == 0 ? (id == 0 ? "  counters  " : "\n            ") : ", ")
+              << Counters::mName(id) << " " << (mCounterFrames ? mCounterSums[id] / mCounterFrames : 0.0);
+  }
+  std::cout << " [per frame]" << std::endl;
+
+  // dynamic resolution: where the scale went, a sample every tenth of the run
+  if (mScaleBudgetMs > 0.0f && !mScale.empty())
+  {
+    int over = 0;
+    for (float ms : mGpuFrameMs) if (ms > mScaleBudgetMs) over++;
+
+    std::cout << std::setprecision(2)
+              << "  scale     avg " << average(mScale) << ", min " << *std::min_element(mScale.begin(), mScale.end())
+              << ", max " << *std::max_element(mScale.begin(), mScale.end()) << " for " << mScaleBudgetMs << " ms, "
+              << 100.0f * over / mGpuFrameMs.size() << "% of the frames over" << std::endl
+              << "            ";
+    size_t step = std::max<size_t>(1, mScale.size() / 10);
+    for (size_t i = 0; i < mScale.size(); i += step) std::cout << mScale[i] << " ";
+    std::cout << "[every " << step << " frames]" << std::endl;
+  }
+  if (Allocations::mEnabled())
+  {
+    std::cout << "  allocs    " << mSteadyAllocations << " in the timed frames [" << mAllocatingFrames << " frames allocated]" << std::endl;
+  }
+  std::cout << std::defaultfloat << std::setprecision(6);
+}
+
+
+bool Benchmark::mWriteCountersJson(const char* path) const
+{
+  FILE* fp = fopen(path, "w");
+  if (!fp)
+  {
+    std::cout << "Failed to write the counters to: " << path << std::endl;
+    return false;
+  }
+
+  double averages[CounterIdCount];
+  for (int id = 0; id < CounterIdCount; id++) averages[id] = mCounterFrames ? mCounterSums[id] / mCounterFrames : 0.0;
+
+  fprintf(fp, "{\n  \"frames\": %d,\n  \"frame_ms\": %.3f,\n  \"per_frame\": ", mCounterFrames, average(mFrameMs));
+  Counters::mWriteJson(fp, averages, "  ");
+
+  // dynamic resolution, every timed frame
+  if (mScaleBudgetMs > 0.0f)
+  {
+    fprintf(fp, ",\n  \"gpu_budget_ms\": %.3f,\n  \"scale\": [", mScaleBudgetMs);
+    for (size_t i = 0; i < mScale.size(); i++) fprintf(fp, "%s%.3f", i ? ", " : "", mScale[i]);
+    fprintf(fp, "],\n  \"gpu_frame_ms\": [");
+    for (size_t i = 0; i < mGpuFrameMs.size(); i++) fprintf(fp, "%s%.3f", i ? ", " : "", mGpuFrameMs[i]);
+    fprintf(fp, "]");
+  }
+  fprintf(fp, "\n}\n");
+  fclose(fp);
+  std::cout << "Counters written to: " << path << std::endl;
+  return true;
+}
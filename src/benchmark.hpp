@@ -0,0 +1,57 @@
+#ifndef BENCHMARK_HEADER
+#define BENCHMARK_HEADER
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+#include "camera.hpp"
+#include "sceneFile.hpp"
+#include "counters.hpp"
+
+// --benchmark N: the camera flies a fixed path instead of following the mouse, N frames
+// are timed after mWarmupFrames [shaders, texture uploads, first Hi-Z], then the report
+// is printed and the program quits
+//
+// The path only depends on the frame number and the scene's building, so two runs of
+// the same command line see the same frames. Pair it with --floors / --rooms to see how
+// frame time, memory and startup go with the instance count, --threads for how the CPU
+// cull goes with the cores [README, scaling]
+class Benchmark
+{
+  public:
+    int mFrames = 0; // 0 = interactive
+    int mWarmupFrames = 60;
+    double mStartupMs = 0.0; // main() until the frame loop starts
+    float mScaleBudgetMs = 0.0f; // dynamic resolution's GPU budget, 0 = it's off
+
+    bool mActive() const { return mFrames > 0; }
+
+    // down the ground floor's rooms, turning around twice on the way
+    void mPose(const SceneBuilding& building, Camera* camera) const;
+
+    // last frame's times, false once every frame is in
+    bool mRecord(float frameMs, float cullMs, float hiZMs, float cpuCullMs, float inputLatencyMs);
+    void mRecordCounters(const int64_t* counters); // same frames as mRecord, call it first
+    void mRecordAllocations(uint64_t total);       // running count of the frame scopes [allocTracker.hpp], same
+    void mRecordScale(float scale, float gpuFrameMs); // dynamic resolution's trajectory, same
+    bool mAllocationFree() const { return mSteadyAllocations == 0; } // no timed frame allocated [always with tracking off]
+    void mPrintReport(size_t instances, const SceneBuilding& building, size_t textureBytes, int threads) const;
+    bool mWriteCountersJson(const char* path) const; // per frame averages
+
+  private:
+    int mFrameIndex = 0;
+    std::vector<float> mFrameMs;
+    std::vector<float> mCullMs;
+    std::vector<float> mHiZMs;
+    std::vector<float> mCpuCullMs;
+    std::vector<float> mInputLatencyMs;
+    std::vector<float> mScale;
+    std::vector<float> mGpuFrameMs;
+    double mCounterSums[CounterIdCount] = {};
+    int mCounterFrames = 0;
+    uint64_t mLastAllocations = 0;
+    uint64_t mSteadyAllocations = 0;
+    int mAllocatingFrames = 0;
+};
+#endif
@@ -108,3 +108,18 @@ void Camera::mouseLook(float xPos, float yPos)
 
   m_targetPosition = glm::normalize(direction);
 }
+
+void Camera::setPose(glm::vec3 eye, float yawDegrees, float pitchDegrees)
+{
+  // mouseLook carries on from here
+  m_eye = eye;
+  yaw = yawDegrees;
+  pitch = pitchDegrees;
+
+  glm::vec3 direction;
+  direction.x = std::cos(glm::radians(pitch)) * std::cos(glm::radians(yaw));
+  direction.y = std::sin(glm::radians(pitch));
+  direction.z = std::cos(glm::radians(pitch)) * std::sin(glm::radians(yaw));
+
+  m_targetPosition = glm::normalize(direction);
+}
@@ -24,5 +24,6 @@ class Camera
     void moveUp(float);
     void moveDown(float);
     void mouseLook(float, float);
+    void setPose(glm::vec3 eye, float yawDegrees, float pitchDegrees); // scripted cameras [benchmark]
 };
 #endif
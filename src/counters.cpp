@@ -0,0 +1,119 @@
+#include <atomic>
+#include <mutex>
+#include <cstdio>
+#include <iostream>
+
+#include "counters.hpp"
+
+// Blocks live as long as the program [a thread that exits keeps its counts in the totals]
+static std::atomic<void*> gBlocks{nullptr};
+static std::mutex gBlocksMutex;
+static std::atomic<int> gPoolUsed{0};
+
+Counters::Block Counters::mPool[Counters::mPoolSize];
+
+static const char* gNames[CounterIdCount] =
+{
+  "draw_calls",
+  "draw_commands",
+  "triangles",
+  "instances_submitted",
+  "instances_culled",
+  "program_binds",
+  "texture_binds",
+  "vertex_array_binds",
+  "upload_bytes",
+  "light_mask_changes",
+  "scene_vs_invocations",
+  "scene_fs_invocations",
+  "recovery_vs_invocations",
+  "recovery_fs_invocations",
+};
+
+static const char* gLabels[CounterIdCount] =
+{
+  "DRAWS",
+  "COMMANDS",
+  "TRIANGLES",
+  "INSTANCES",
+  "CULLED",
+  "PROGRAMS",
+  "TEXTURES",
+  "VAOS",
+  "UPLOAD B",
+  "LIGHT MASKS",
+  "SCENE VS",
+  "SCENE FS",
+  "HI-Z VS",
+  "HI-Z FS",
+};
+
+
+const char* Counters::mName(int id)
+{
+  return id >= 0 && id < CounterIdCount ? gNames[id] : "";
+}
+
+
+const char* Counters::mLabel(int id)
+{
+  return id >= 0 && id < CounterIdCount ? gLabels[id] : "";
+}
+
+
+Counters::Block* Counters::mLocal()
+{
+  thread_local Block* block = nullptr;
+  if (block) return block;
+
+  int index = gPoolUsed.fetch_add(1, std::memory_order_relaxed);
+  block = index < mPoolSize ? &mPool[index] : new Block();
+  std::lock_guard<std::mutex> lock(gBlocksMutex);
+  block->mNext = (Block*)gBlocks.load(std::memory_order_relaxed);
+  gBlocks.store(block, std::memory_order_release);
+  return block;
+}
+
+
+void Counters::mCollect(int64_t* frame)
+{
+  for (int id = 0; id < CounterIdCount; id++) frame[id] = 0;
+
+  for (Block* block = (Block*)gBlocks.load(std::memory_order_acquire); block; block = block->mNext)
+  {
+    for (int id = 0; id < CounterIdCount; id++)
+    {
+      int64_t value = block->mValues[id].load(std::memory_order_relaxed);
+      frame[id] += value - block->mCollected[id];
+      block->mCollected[id] = value;
+    }
+  }
+}
+
+
+void Counters::mWriteJson(FILE* fp, const double* values, const char* indent)
+{
+  fprintf(fp, "{\n");
+  for (int id = 0; id < CounterIdCount; id++)
+  {
+    fprintf(fp, "%s  \"%s\": %.2f%s\n", indent, gNames[id], values[id], id + 1 < CounterIdCount ? "," : "");
+  }
+  fprintf(fp, "%s}", indent);
+}
+
+
+bool Counters::mWriteJson(const char* path, const double* values)
+{
+  FILE* fp = fopen(path, "w");
+  if (!fp)
+  {
+    std::cout << "Failed to write the counters to: " << path << std::endl;
+    return false;
+  }
+
+  mWriteJson(fp, values, "");
+  fprintf(fp, "\n");
+  fclose(fp);
+  std::cout << "Counters written to: " << path << std::endl;
+  return true;
+}
@@ -0,0 +1,67 @@
+#ifndef COUNTERS_HEADER
+#define COUNTERS_HEADER
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+// What a frame did, next to how long it took [overlay, benchmark report, JSON]
+enum CounterId
+{
+  CounterDrawCalls,           // API calls, one glMultiDrawElementsIndirect is one
+  CounterDrawCommands,        // indirect commands behind them
+  CounterTriangles,           // survived the GPU cull [read back a frame late]
+  CounterInstancesSubmitted,  // passed the CPU culling [portals + occlusion]
+  CounterInstancesCulled,
+  CounterProgramBinds,
+  CounterTextureBinds,
+  CounterVertexArrayBinds,
+  CounterUploadBytes,         // CPU -> GPU buffer data, stream buffer or glBufferSubData
+  CounterLightMaskChanges,    // instances whose light mask changed and went to the SSBO
+  CounterSceneVertexInvocations,    // pipeline statistics of the main pass
+  CounterSceneFragmentInvocations,
+  CounterRecoveryVertexInvocations, // ... and of the Hi-Z disoccluded pass
+  CounterRecoveryFragmentInvocations,
+  CounterIdCount
+};
+
+// Every thread adds to its own block [thread_local, registered on first use], so an add is
+// a load and a store on a line no other thread writes. mCollect, once a frame on one
+// thread, sums what every block gained since the last mCollect
+//
+// Frames are counted where the work happens: the simulation thread's adds for frame N + 1
+// can land in the render thread's frame N, close enough for counters
+class Counters
+{
+  public:
+    static const char* mName(int id);      // snake_case, the JSON keys
+    static const char* mLabel(int id);     // short, for the overlay
+
+    static void mAdd(CounterId id, int64_t count = 1)
+    {
+      std::atomic<int64_t>& value = mLocal()->mValues[id];
+      value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+    }
+
+    static void mCollect(int64_t* frame); // CounterIdCount values
+
+    // {"name": value, ...}, values as they are [totals, per frame averages]
+    static void mWriteJson(FILE* fp, const double* values, const char* indent = "  ");
+    static bool mWriteJson(const char* path, const double* values);
+
+  private:
+    struct Block
+    {
+      std::atomic<int64_t> mValues[CounterIdCount] = {};
+      int64_t mCollected[CounterIdCount] = {}; // the collecting thread's, last seen values
+      Block* mNext = nullptr;
+    };
+
+    // blocks come from here, a thread's first mAdd never allocates [it can be in a timed
+    // frame, a worker's first cull job]. More threads than that get a new one
+    static const int mPoolSize = 64;
+    static Block mPool[mPoolSize];
+
+    static Block* mLocal();
+};
+#endif
@@ -0,0 +1,56 @@
+#include <iostream>
+
+#include "cpuMemory.hpp"
+
+std::atomic<size_t> CpuMemory::gBytes[MemoryTagCount] = {};
+std::atomic<size_t> CpuMemory::gBudget{0};
+std::atomic<bool> CpuMemory::gWarned{false};
+
+static const char* gTagNames[MemoryTagCount] =
+{
+  "geometry",
+  "scene buffers",
+  "textures",
+  "shadow maps",
+  "render targets",
+  "streaming",
+  "overlay",
+  "meshes",
+  "instances",
+  "transforms",
+};
+
+
+const char* CpuMemory::mTagName(int tag)
+{
+  return tag >= 0 && tag < MemoryTagCount ? gTagNames[tag] : "";
+}
+
+
+size_t CpuMemory::mBytes()
+{
+  size_t total = 0;
+  for (int tag = 0; tag < MemoryTagCount; tag++) total += gBytes[tag].load(std::memory_order_relaxed);
+  return total;
+}
+
+
+void CpuMemory::mAllocated(MemoryTag tag, size_t bytes)
+{
+  gBytes[tag].fetch_add(bytes, std::memory_order_relaxed);
+
+  size_t budget = mBudget();
+  if (budget == 0) return;
+
+  size_t total = mBytes();
+  if (total <= budget)
+  {
+    gWarned.store(false, std::memory_order_relaxed);
+    return;
+  }
+  if (!gWarned.exchange(true))
+  {
+    std::cout << "Memory: over the CPU budget, " << total / (1024.0 * 1024.0) << " of " << budget / (1024.0 * 1024.0)
+              << " MB [last: " << mTagName(tag) << "]" << std::endl;
+  }
+}
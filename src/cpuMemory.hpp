@@ -0,0 +1,83 @@
+#ifndef CPU_MEMORY_HEADER
+#define CPU_MEMORY_HEADER
+
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+// Who owns the memory, GPU objects and CPU containers share the tags
+enum MemoryTag
+{
+  MemoryGeometry,      // GPU: the geometry pool
+  MemoryScene,         // GPU: instance / cluster / command buffers
+  MemoryTextures,      // GPU: streamed textures, placeholders, texture arrays
+  MemoryShadowMaps,
+  MemoryRenderTargets, // GPU: the multisampled scene, resolved depth, Hi-Z pyramid
+  MemoryStreaming,     // GPU: the per frame stream buffer, the texture upload ring
+  MemoryOverlay,       // GPU: debug lines, text
+  MemoryMeshes,        // CPU: Mesh3D vertex / index vectors
+  MemoryInstances,     // CPU: GpuScene's copy of the instance SSBO
+  MemoryTransforms,    // CPU: TransformArray
+  MemoryTagCount
+};
+
+// CPU bytes per tag from TrackedAllocator, the GL free half of the memory registry
+// [memoryRegistry.hpp] so CPU only code [benchmarks/] links without GL. Any thread
+//
+// The budget is a total in bytes, 0 = none; going over prints a warning once [until it is
+// back under]
+class CpuMemory
+{
+  public:
+    static void mSetBudget(size_t bytes) { gBudget.store(bytes, std::memory_order_relaxed); }
+    static size_t mBudget() { return gBudget.load(std::memory_order_relaxed); }
+
+    static size_t mBytes(MemoryTag tag) { return gBytes[tag].load(std::memory_order_relaxed); }
+    static size_t mBytes();
+
+    static void mAllocated(MemoryTag tag, size_t bytes);
+    static void mFreed(MemoryTag tag, size_t bytes) { gBytes[tag].fetch_sub(bytes, std::memory_order_relaxed); }
+
+    static const char* mTagName(int tag);
+
+  private:
+    static std::atomic<size_t> gBytes[MemoryTagCount];
+    static std::atomic<size_t> gBudget;
+    static std::atomic<bool> gWarned;
+};
+
+// std::allocator that counts its bytes under a tag
+template <typename T, MemoryTag Tag>
+struct TrackedAllocator
+{
+  typedef T value_type;
+
+  template <typename U>
+  struct rebind { typedef TrackedAllocator<U, Tag> other; };
+
+  TrackedAllocator() = default;
+  template <typename U>
+  TrackedAllocator(const TrackedAllocator<U, Tag>&) {}
+
+  T* allocate(size_t count)
+  {
+    CpuMemory::mAllocated(Tag, count * sizeof(T));
+    return std::allocator<T>().allocate(count);
+  }
+
+  void deallocate(T* pointer, size_t count)
+  {
+    CpuMemory::mFreed(Tag, count * sizeof(T));
+    std::allocator<T>().deallocate(pointer, count);
+  }
+
+  template <typename U>
+  bool operator==(const TrackedAllocator<U, Tag>&) const { return true; }
+  template <typename U>
+  bool operator!=(const TrackedAllocator<U, Tag>&) const { return false; }
+};
+
+template <typename T, MemoryTag Tag>
+using TrackedVector = std::vector<T, TrackedAllocator<T, Tag>>;
+#endif
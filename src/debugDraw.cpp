@@ -0,0 +1,171 @@
+#include "../glad/glad.h"
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+#include <cstddef>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#include "debugDraw.hpp"
+#include "shader.hpp"
+#include "counters.hpp"
+#include "memoryRegistry.hpp"
+
+
+uint32_t DebugDraw::mRgba(float r, float g, float b, float a)
+{
+  auto channel = [](float v) { return (uint32_t)(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f); };
+  return channel(r) | channel(g) << 8 | channel(b) << 16 | channel(a) << 24;
+}
+
+
+void DebugDraw::mAabb(glm::vec3 minCorner, glm::vec3 maxCorner, uint32_t color)
+{
+  if (!mEnabled) return;
+
+  glm::vec3 c[8];
+  for (int i = 0; i < 8; i++)
+  {
+    c[i] = glm::vec3(i & 1 ? maxCorner.x : minCorner.x,
+                     i & 2 ? maxCorner.y : minCorner.y,
+                     i & 4 ? maxCorner.z : minCorner.z);
+  }
+
+  // the 12 edges, corners differing in one bit
+  for (int i = 0; i < 8; i++)
+  {
+    for (int bit = 1; bit < 8; bit <<= 1)
+    {
+      if (!(i & bit)) mLine(c[i], c[i | bit], color);
+    }
+  }
+}
+
+
+void DebugDraw::mFrustum(const glm::mat4& projectionView, uint32_t color)
+{
+  if (!mEnabled) return;
+
+  glm::mat4 inverse = glm::inverse(projectionView);
+  glm::vec3 c[8];
+  for (int i = 0; i < 8; i++)
+  {
+    glm::vec4 clip = glm::vec4(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f, 1.0f);
+    glm::vec4 world = inverse * clip;
+    c[i] = glm::vec3(world) / world.w;
+  }
+
+  for (int i = 0; i < 8; i++)
+  {
+    for (int bit = 1; bit < 8; bit <<= 1)
+    {
+      if (!(i & bit)) mLine(c[i], c[i | bit], color);
+    }
+  }
+}
+
+
+void DebugDraw::mCircle(glm::vec3 center, glm::vec3 axisA, glm::vec3 axisB, float radius, uint32_t color)
+{
+  glm::vec3 previous = center + axisA * radius;
+  for (int i = 1; i <= mSegments; i++)
+  {
+    float angle = 6.2831853f * i / mSegments;
+    glm::vec3 next = center + (axisA * std::cos(angle) + axisB * std::sin(angle)) * radius;
+    mLine(previous, next, color);
+    previous = next;
+  }
+}
+
+
+void DebugDraw::mCone(glm::vec3 apex, glm::vec3 direction, float length, float radius, uint32_t color)
+{
+  if (!mEnabled) return;
+
+  // any two axes across the direction
+  glm::vec3 up = std::fabs(direction.y) < 0.99f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+  glm::vec3 axisA = glm::normalize(glm::cross(direction, up));
+  glm::vec3 axisB = glm::cross(direction, axisA);
+
+  glm::vec3 base = apex + direction * length;
+  mCircle(base, axisA, axisB, radius, color);
+  for (int i = 0; i < 4; i++)
+  {
+    float angle = 1.5707963f * i;
+    mLine(apex, base + (axisA * std::cos(angle) + axisB * std::sin(angle)) * radius, color);
+  }
+}
+
+
+void DebugDraw::mSphere(glm::vec3 center, float radius, uint32_t color)
+{
+  if (!mEnabled) return;
+
+  glm::vec3 x = glm::vec3(1.0f, 0.0f, 0.0f), y = glm::vec3(0.0f, 1.0f, 0.0f), z = glm::vec3(0.0f, 0.0f, 1.0f);
+  mCircle(center, x, y, radius, color);
+  mCircle(center, y, z, radius, color);
+  mCircle(center, z, x, radius, color);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ RENDERER ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+void DebugRenderer::mCreate()
+{
+  Shader shader;
+  mProgram = shader.mCreateGraphicsPipeline("shaders/debug/vert.glsl", "shaders/debug/frag.glsl");
+
+  // separate format, so a flush only rebinds the buffer + offset
+  glGenVertexArrays(1, &mVertexArrayObject);
+  glBindVertexArray(mVertexArrayObject);
+  glEnableVertexAttribArray(0); // position
+  glVertexAttribFormat(0, 3, GL_FLOAT, GL_FALSE, offsetof(DebugVertex, mPosition));
+  glVertexAttribBinding(0, 0);
+  glEnableVertexAttribArray(1); // color
+  glVertexAttribFormat(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(DebugVertex, mColor));
+  glVertexAttribBinding(1, 0);
+  glBindVertexArray(0);
+
+  glGenBuffers(1, &mFallbackBuffer);
+}
+
+
+void DebugRenderer::mFlush(const std::vector<DebugVertex>& vertices, const glm::mat4& projectionView, StreamBuffer* stream)
+{
+  if (vertices.empty() || !mProgram) return;
+
+  size_t bytes = vertices.size() * sizeof(DebugVertex);
+  StreamAllocation allocation;
+  if (stream) allocation = stream->mAllocate(bytes, sizeof(DebugVertex));
+
+  glBindVertexArray(mVertexArrayObject);
+  if (allocation.mData)
+  {
+    memcpy(allocation.mData, vertices.data(), bytes);
+    glBindVertexBuffer(0, allocation.mBuffer, allocation.mOffset, sizeof(DebugVertex));
+  }
+  else
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, mFallbackBuffer);
+    glBufferData(GL_ARRAY_BUFFER, bytes, vertices.data(), GL_STREAM_DRAW);
+    gMemory.mTrackBuffer(mFallbackBuffer, bytes, MemoryOverlay, "debug line fallback");
+    Counters::mAdd(CounterUploadBytes, bytes);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexBuffer(0, mFallbackBuffer, 0, sizeof(DebugVertex));
+  }
+
+  glUseProgram(mProgram);
+  GLint location = glGetUniformLocation(mProgram, "u_projectionView");
+  glUniformMatrix4fv(location, 1, GL_FALSE, &projectionView[0][0]);
+
+  glDisable(GL_DEPTH_TEST);
+  glDrawArrays(GL_LINES, 0, (GLsizei)vertices.size());
+  glEnable(GL_DEPTH_TEST);
+
+  Counters::mAdd(CounterVertexArrayBinds);
+  Counters::mAdd(CounterProgramBinds);
+  Counters::mAdd(CounterDrawCalls);
+
+  glBindVertexArray(0);
+}
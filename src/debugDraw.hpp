@@ -0,0 +1,65 @@
+#ifndef DEBUG_DRAW_HEADER
+#define DEBUG_DRAW_HEADER
+
+#include "../glad/glad.h"
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+#include <cstdint>
+
+#include "streamBuffer.hpp"
+
+struct DebugVertex
+{
+  glm::vec3 mPosition;
+  uint32_t mColor; // RGBA8, DebugDraw::mRgba
+};
+
+// Immediate mode lines [bounds, light frusta and cones, the ceiling grid], simulation side
+//
+// Every call appends line list vertices to the vector given to mBegin [the render packet's],
+// the render thread draws all of them with DebugRenderer in one glDrawArrays. Switched off,
+// every call is the one mEnabled test and the vector stays empty
+class DebugDraw
+{
+  public:
+    bool mEnabled = false;
+    size_t mMaxVertices = 1 << 16; // a frame's worth, the rest is dropped [= one 1 MB stream allocation]
+
+    static uint32_t mRgba(float r, float g, float b, float a = 1.0f);
+
+    void mBegin(std::vector<DebugVertex>* out) { mOut = out; mOut->clear(); }
+
+    void mLine(glm::vec3 from, glm::vec3 to, uint32_t color)
+    {
+      if (!mEnabled || mOut->size() + 2 > mMaxVertices) return;
+      mOut->push_back({from, color});
+      mOut->push_back({to, color});
+    }
+
+    void mAabb(glm::vec3 minCorner, glm::vec3 maxCorner, uint32_t color);
+    void mFrustum(const glm::mat4& projectionView, uint32_t color);                            // the clip cube through its inverse
+    void mCone(glm::vec3 apex, glm::vec3 direction, float length, float radius, uint32_t color); // radius at the base
+    void mSphere(glm::vec3 center, float radius, uint32_t color);                              // three great circles
+
+  private:
+    static const int mSegments = 16;
+    std::vector<DebugVertex>* mOut = nullptr;
+
+    void mCircle(glm::vec3 center, glm::vec3 axisA, glm::vec3 axisB, float radius, uint32_t color);
+};
+
+// Render thread: the lines of a frame out of the stream buffer [or its own buffer when that
+// is full], unlit, over the finished scene without depth test
+class DebugRenderer
+{
+  public:
+    void mCreate();
+    void mFlush(const std::vector<DebugVertex>& vertices, const glm::mat4& projectionView, StreamBuffer* stream);
+
+  private:
+    GLuint mProgram = 0;
+    GLuint mVertexArrayObject = 0;
+    GLuint mFallbackBuffer = 0;
+};
+#endif
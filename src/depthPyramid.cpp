@@ -0,0 +1,87 @@
+#include "../glad/glad.h"
+
+#include <algorithm>
+
+#include "depthPyramid.hpp"
+#include "shader.hpp"
+#include "counters.hpp"
+#include "memoryRegistry.hpp"
+
+
+bool DepthPyramid::mCreate(int screenWidth, int screenHeight)
+{
+  mScreenWidth = screenWidth;
+  mScreenHeight = screenHeight;
+  mWidth = (screenWidth + 1) / 2;
+  mHeight = (screenHeight + 1) / 2;
+
+  mLevels = 1;
+  for (int size = std::max(mWidth, mHeight); size > 1; size = (size + 1) / 2) mLevels++;
+
+  glGenTextures(1, &mTextureObject);
+  glBindTexture(GL_TEXTURE_2D, mTextureObject);
+  glTexStorage2D(GL_TEXTURE_2D, mLevels, GL_R32F, mWidth, mHeight);
+  gMemory.mTrackTexture(mTextureObject, GL_R32F, mWidth, mHeight, mLevels, 1, MemoryRenderTargets, "Hi-Z pyramid");
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  Shader shader;
+  mReduceProgram = shader.mCreateComputePipeline("shaders/hiz/comp.glsl");
+  return mReduceProgram != 0;
+}
+
+
+// One dispatch per level, each reads the level above it
+// Smaller content only dispatches its own corner of every level, the texels past it are stale
+// and nothing reads them [the cull clamps to the content, the next level to its source size]
+void DepthPyramid::mBuild(GLuint depthTexture, int contentWidth, int contentHeight)
+{
+  mContentWidth = std::min(std::max(contentWidth, 1), mScreenWidth);
+  mContentHeight = std::min(std::max(contentHeight, 1), mScreenHeight);
+
+  // 0 - 8 shadow maps, 9 object texture, 10 the pyramid in the cull shader
+  glUseProgram(mReduceProgram);
+  Counters::mAdd(CounterProgramBinds);
+  glActiveTexture(GL_TEXTURE11);
+
+  GLint sourceLocation = glGetUniformLocation(mReduceProgram, "u_source");
+  GLint levelLocation = glGetUniformLocation(mReduceProgram, "u_sourceLevel");
+  GLint sizeLocation = glGetUniformLocation(mReduceProgram, "u_sourceSize");
+  glUniform1i(sourceLocation, 11);
+
+  int sourceWidth = mContentWidth;
+  int sourceHeight = mContentHeight;
+  int width = (mContentWidth + 1) / 2;
+  int height = (mContentHeight + 1) / 2;
+
+  for (int level = 0; level < mLevels; level++)
+  {
+    if (level == 0)
+    {
+      glBindTexture(GL_TEXTURE_2D, depthTexture);
+      glUniform1i(levelLocation, 0);
+    }
+    else
+    {
+      glBindTexture(GL_TEXTURE_2D, mTextureObject);
+      glUniform1i(levelLocation, level - 1);
+    }
+    glUniform2i(sizeLocation, sourceWidth, sourceHeight);
+
+    glBindImageTexture(0, mTextureObject, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+    glDispatchCompute((width + 7) / 8, (height + 7) / 8, 1);
+    glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+
+    sourceWidth = width;
+    sourceHeight = height;
+    width = std::max(1, (width + 1) / 2);
+    height = std::max(1, (height + 1) / 2);
+  }
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  Counters::mAdd(CounterTextureBinds, mLevels);
+  mValid = true;
+}
@@ -0,0 +1,32 @@
+#ifndef DEPTH_PYRAMID_HEADER
+#define DEPTH_PYRAMID_HEADER
+
+#include "../glad/glad.h"
+
+// Hi-Z: mip chain of the scene depth where every texel keeps the farthest depth under it
+//
+// Level 0 is half the screen [rounded up], every level halves again down to 1x1
+// so screen pixel p lands in texel p >> (level + 1) of any level
+//
+// With dynamic resolution the depth only covers mContentWidth x mContentHeight [bottom left],
+// the levels are built over that much and the cull maps the screen onto it
+class DepthPyramid
+{
+  public:
+    GLuint mTextureObject = 0; // GL_R32F with all the mips
+    int mScreenWidth = 0;
+    int mScreenHeight = 0;
+    int mWidth = 0;            // size of level 0
+    int mHeight = 0;
+    int mLevels = 0;
+    int mContentWidth = 0;     // of the depth the last mBuild read
+    int mContentHeight = 0;
+    bool mValid = false;       // false until the first mBuild, nothing to test against before it
+
+    bool mCreate(int screenWidth, int screenHeight);
+    void mBuild(GLuint depthTexture, int contentWidth, int contentHeight); // drawn size, <= the screen
+
+  private:
+    GLuint mReduceProgram = 0;
+};
+#endif
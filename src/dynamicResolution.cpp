@@ -0,0 +1,40 @@
+#include "dynamicResolution.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+
+float DynamicResolution::mUpdate(float gpuMs)
+{
+  if (!mEnabled)
+  {
+    mScale = 1.0f;
+    return mScale;
+  }
+
+  if (gpuMs <= 0.0f) return mScale; // no query came back yet
+
+  float error = (mBudgetMs - gpuMs) / mBudgetMs;
+  if (std::fabs(error) < mDeadband) error = 0.0f;
+
+  // the GPU time goes with the pixel count [scale^2], half the relative error is about right per axis
+  float step = 0.5f * (mGainP * (error - mLastError) + mGainI * error);
+  mLastError = error;
+
+  mScale = std::min(std::max(mScale + step, mMinScale), mMaxScale);
+  return mScale;
+}
+
+
+void DynamicResolution::mRenderSize(int width, int height, int* renderWidth, int* renderHeight) const
+{
+  if (mScale >= 1.0f)
+  {
+    *renderWidth = width;
+    *renderHeight = height;
+    return;
+  }
+
+  *renderWidth = std::min(width, std::max(8, ((int)(width * mScale) + 4) / 8 * 8));
+  *renderHeight = std::min(height, std::max(8, ((int)(height * mScale) + 4) / 8 * 8));
+}
@@ -0,0 +1,36 @@
+#ifndef DYNAMIC_RESOLUTION_HEADER
+#define DYNAMIC_RESOLUTION_HEADER
+
+// Scale of the scene target [per axis, 1 = the window], steered so the GPU frame time
+// [GpuFrameTimer] sits at mBudgetMs. Render thread, once a frame before anything is drawn
+//
+// PI in velocity form on the relative headroom e = (budget - gpu) / budget:
+//   scale += mGainP * (e - last e) + mGainI * e
+// clamped to [mMinScale, mMaxScale], so there's nothing to wind up. The times are a few
+// frames old [query ring], small gains keep it from chasing its own tail. Within
+// mDeadband of the budget nothing moves, otherwise the size would wobble by a pixel a frame
+class DynamicResolution
+{
+  public:
+    bool mEnabled = false;   // --dynamic-res, off draws at the window size like before
+    float mBudgetMs = 8.0f;  // --gpu-budget-ms
+    float mMinScale = 0.5f;  // --min-scale
+    float mMaxScale = 1.0f;  // --max-scale
+    float mGainP = 0.2f;     // --res-gain p,i
+    float mGainI = 0.05f;
+    float mDeadband = 0.05f; // of the budget
+    float mSharpness = 0.5f; // --sharpness, 0 = plain bilinear upscale
+
+    float mScale = 1.0f;
+
+    // last GPU frame time in, scale for this frame out [1 when it's off]
+    float mUpdate(float gpuMs);
+
+    // the render size for a window of width x height, rounded to 8 pixels so a small
+    // change of scale doesn't resize every frame
+    void mRenderSize(int width, int height, int* renderWidth, int* renderHeight) const;
+
+  private:
+    float mLastError = 0.0f;
+};
+#endif
@@ -0,0 +1,87 @@
+#include "../glm/ext/matrix_transform.hpp"
+#include "../glm/geometric.hpp"
+
+#include "frustum.hpp"
+
+
+Frustum::Frustum()
+{
+  for (int i = 0; i < 6; i++) mPlanes[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+
+Frustum::Frustum(const glm::mat4& projectionView)
+{
+  mExtract(projectionView);
+}
+
+
+// Gribb & Hartmann: every plane is a sum/difference of the 4th row with another row
+void Frustum::mExtract(const glm::mat4& m)
+{
+  glm::vec4 row0 = glm::vec4(m[0][0], m[1][0], m[2][0], m[3][0]);
+  glm::vec4 row1 = glm::vec4(m[0][1], m[1][1], m[2][1], m[3][1]);
+  glm::vec4 row2 = glm::vec4(m[0][2], m[1][2], m[2][2], m[3][2]);
+  glm::vec4 row3 = glm::vec4(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+  mPlanes[0] = row3 + row0; // left
+  mPlanes[1] = row3 - row0; // right
+  mPlanes[2] = row3 + row1; // bottom
+  mPlanes[3] = row3 - row1; // top
+  mPlanes[4] = row3 + row2; // near
+  mPlanes[5] = row3 - row2; // far
+
+  // normalize, so that the distance we get is in world units [needed for spheres]
+  for (int i = 0; i < 6; i++)
+  {
+    float length = glm::length(glm::vec3(mPlanes[i]));
+    if (length > 0.0f) mPlanes[i] /= length;
+  }
+}
+
+
+bool Frustum::mIntersectsSphere(glm::vec3 center, float radius) const
+{
+  for (int i = 0; i < 6; i++)
+  {
+    float distance = glm::dot(glm::vec3(mPlanes[i]), center) + mPlanes[i].w;
+    if (distance < -radius) return false;
+  }
+  return true;
+}
+
+
+bool Frustum::mIntersectsBox(glm::vec3 minCorner, glm::vec3 maxCorner) const
+{
+  for (int i = 0; i < 6; i++)
+  {
+    // corner which is furthest along the plane normal
+    glm::vec3 positive;
+    positive.x = mPlanes[i].x >= 0.0f ? maxCorner.x : minCorner.x;
+    positive.y = mPlanes[i].y >= 0.0f ? maxCorner.y : minCorner.y;
+    positive.z = mPlanes[i].z >= 0.0f ? maxCorner.z : minCorner.z;
+
+    if (glm::dot(glm::vec3(mPlanes[i]), positive) + mPlanes[i].w < 0.0f) return false;
+  }
+  return true;
+}
+
+
+// Arvo's method: every column of the matrix pushes min/max by the smaller/larger product
+void transformBox(const glm::mat4& model, glm::vec3 localMin, glm::vec3 localMax, glm::vec3* worldMin, glm::vec3* worldMax)
+{
+  glm::vec3 translation = glm::vec3(model[3]);
+  *worldMin = translation;
+  *worldMax = translation;
+
+  for (int column = 0; column < 3; column++)
+  {
+    for (int row = 0; row < 3; row++)
+    {
+      float a = model[column][row] * localMin[column];
+      float b = model[column][row] * localMax[column];
+      (*worldMin)[row] += a < b ? a : b;
+      (*worldMax)[row] += a < b ? b : a;
+    }
+  }
+}
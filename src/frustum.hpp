@@ -0,0 +1,22 @@
+#ifndef FRUSTUM_HEADER
+#define FRUSTUM_HEADER
+
+#include "../glm/ext/matrix_transform.hpp"
+
+// Six planes pulled out of a projection * view matrix
+// Plane normals point inside, so a point is inside when dot(plane, p) >= 0
+class Frustum
+{
+  public:
+    glm::vec4 mPlanes[6];
+
+    Frustum();
+    Frustum(const glm::mat4& projectionView);
+    void mExtract(const glm::mat4& projectionView);
+    bool mIntersectsSphere(glm::vec3 center, float radius) const;
+    bool mIntersectsBox(glm::vec3 minCorner, glm::vec3 maxCorner) const;
+};
+
+// World space box around a transformed object space box
+void transformBox(const glm::mat4& model, glm::vec3 localMin, glm::vec3 localMax, glm::vec3* worldMin, glm::vec3* worldMax);
+#endif
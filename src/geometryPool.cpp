@@ -0,0 +1,174 @@
+#include "../glad/glad.h"
+
+#include <vector>
+#include <cstddef>
+#include <iostream>
+
+#include "geometryPool.hpp"
+#include "mesh.hpp"
+#include "memoryRegistry.hpp"
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ RANGE ALLOCATOR ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+void RangeAllocator::mReset(GLuint capacity)
+{
+  mCapacity = capacity;
+  mUsed = 0;
+  mFreeRanges.clear();
+  mFreeRanges.push_back({0, capacity});
+}
+
+
+bool RangeAllocator::mAllocate(GLuint size, GLuint* offset)
+{
+  for (size_t i = 0; i < mFreeRanges.size(); i++)
+  {
+    Range& range = mFreeRanges[i];
+    if (range.mSize < size) continue;
+
+    *offset = range.mOffset;
+    range.mOffset += size;
+    range.mSize -= size;
+    if (range.mSize == 0) mFreeRanges.erase(mFreeRanges.begin() + i);
+
+    mUsed += size;
+    return true;
+  }
+  return false;
+}
+
+
+void RangeAllocator::mFree(GLuint offset, GLuint size)
+{
+  if (size == 0) return;
+  mUsed -= size;
+
+  size_t i = 0;
+  while (i < mFreeRanges.size() && mFreeRanges[i].mOffset < offset) i++;
+  mFreeRanges.insert(mFreeRanges.begin() + i, {offset, size});
+
+  // merge with the right neighbour, then with the left one
+  if (i + 1 < mFreeRanges.size() && mFreeRanges[i].mOffset + mFreeRanges[i].mSize == mFreeRanges[i + 1].mOffset)
+  {
+    mFreeRanges[i].mSize += mFreeRanges[i + 1].mSize;
+    mFreeRanges.erase(mFreeRanges.begin() + i + 1);
+  }
+  if (i > 0 && mFreeRanges[i - 1].mOffset + mFreeRanges[i - 1].mSize == mFreeRanges[i].mOffset)
+  {
+    mFreeRanges[i - 1].mSize += mFreeRanges[i].mSize;
+    mFreeRanges.erase(mFreeRanges.begin() + i);
+  }
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ GEOMETRY POOL ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+void GeometryPool::mCreate(GLuint vertexCapacity, GLuint indexCapacity)
+{
+  mVertices.mReset(vertexCapacity);
+  mIndices.mReset(indexCapacity);
+
+  glGenVertexArrays(1, &mVertexArrayObject);
+  glBindVertexArray(mVertexArrayObject);
+
+  glGenBuffers(1, &mVertexBufferObject);
+  glBindBuffer(GL_ARRAY_BUFFER, mVertexBufferObject);
+  glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCapacity * sizeof(PoolVertex), nullptr, GL_STATIC_DRAW);
+  gMemory.mTrackBuffer(mVertexBufferObject, (size_t)vertexCapacity * sizeof(PoolVertex), MemoryGeometry, "geometry pool vertices");
+
+  GLsizei stride = sizeof(PoolVertex);
+  glEnableVertexAttribArray(0); // position
+  glVertexAttribPointer(0, 3, GL_FLOAT, false, stride, (void*)offsetof(PoolVertex, mPosition));
+  glEnableVertexAttribArray(1); // uv
+  glVertexAttribPointer(1, 2, GL_FLOAT, false, stride, (void*)offsetof(PoolVertex, mUv));
+  glEnableVertexAttribArray(2); // normal
+  glVertexAttribPointer(2, 3, GL_FLOAT, false, stride, (void*)offsetof(PoolVertex, mNormal));
+  glEnableVertexAttribArray(3); // tangent
+  glVertexAttribPointer(3, 3, GL_FLOAT, false, stride, (void*)offsetof(PoolVertex, mTangent));
+  glEnableVertexAttribArray(4); // bitangent
+  glVertexAttribPointer(4, 3, GL_FLOAT, false, stride, (void*)offsetof(PoolVertex, mBitangent));
+
+  glGenBuffers(1, &mIndexBufferObject);
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mIndexBufferObject);
+  glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr)indexCapacity * sizeof(GLuint), nullptr, GL_STATIC_DRAW);
+  gMemory.mTrackBuffer(mIndexBufferObject, (size_t)indexCapacity * sizeof(GLuint), MemoryGeometry, "geometry pool indices");
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+
+bool GeometryPool::mUpload(const Mesh3D& mesh, MeshAllocation* allocation)
+{
+  GLuint vertexCount = mesh.mVertexData.size() / 3;
+  GLuint indexCount = mesh.mIndexData.size();
+
+  if (!mVertices.mAllocate(vertexCount, &allocation->mBaseVertex))
+  {
+    std::cout << "Geometry pool is out of vertex space, for mesh: " << mesh.name << std::endl;
+    return false;
+  }
+  if (!mIndices.mAllocate(indexCount, &allocation->mFirstIndex))
+  {
+    std::cout << "Geometry pool is out of index space, for mesh: " << mesh.name << std::endl;
+    mVertices.mFree(allocation->mBaseVertex, vertexCount);
+    return false;
+  }
+  allocation->mVertexCount = vertexCount;
+  allocation->mIndexCount = indexCount;
+
+  // interleave the 5 separate arrays we got from the loader
+  std::vector<PoolVertex> vertices(vertexCount);
+  for (GLuint i = 0; i < vertexCount; i++)
+  {
+    PoolVertex& v = vertices[i];
+    for (int k = 0; k < 3; k++)
+    {
+      v.mPosition[k] = mesh.mVertexData[i * 3 + k];
+      v.mNormal[k] = mesh.mNormalData[i * 3 + k];
+      v.mTangent[k] = mesh.mTangentData[i * 3 + k];
+      v.mBitangent[k] = mesh.mBitangentData[i * 3 + k];
+    }
+    v.mUv[0] = mesh.mUvData[i * 2];
+    v.mUv[1] = mesh.mUvData[i * 2 + 1];
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, mVertexBufferObject);
+  glBufferSubData(GL_ARRAY_BUFFER,
+                  (GLintptr)allocation->mBaseVertex * sizeof(PoolVertex),
+                  (GLsizeiptr)vertexCount * sizeof(PoolVertex),
+                  vertices.data());
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // indices stay local to the mesh, baseVertex of the draw command moves them
+  glBindBuffer(GL_COPY_WRITE_BUFFER, mIndexBufferObject);
+  glBufferSubData(GL_COPY_WRITE_BUFFER,
+                  (GLintptr)allocation->mFirstIndex * sizeof(GLuint),
+                  (GLsizeiptr)indexCount * sizeof(GLuint),
+                  mesh.mIndexData.data());
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  return true;
+}
+
+
+void GeometryPool::mRelease(const MeshAllocation& allocation)
+{
+  mVertices.mFree(allocation.mBaseVertex, allocation.mVertexCount);
+  mIndices.mFree(allocation.mFirstIndex, allocation.mIndexCount);
+}
+
+
+// Attribute 5 is the index into the instance SSBO, one per instance [divisor 1]
+// The draw command's baseInstance picks where in this buffer a draw starts reading
+void GeometryPool::mSetInstanceIdBuffer(GLuint buffer)
+{
+  glBindVertexArray(mVertexArrayObject);
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  glEnableVertexAttribArray(5);
+  glVertexAttribIPointer(5, 1, GL_UNSIGNED_INT, 0, (void*)0);
+  glVertexAttribDivisor(5, 1);
+  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -0,0 +1,67 @@
+#ifndef GEOMETRY_POOL_HEADER
+#define GEOMETRY_POOL_HEADER
+
+#include "../glad/glad.h"
+
+#include <vector>
+
+#include "mesh.hpp"
+
+// What every vertex in the pool looks like [interleaved]
+struct PoolVertex
+{
+  float mPosition[3];
+  float mUv[2];
+  float mNormal[3];
+  float mTangent[3];
+  float mBitangent[3];
+};
+
+// Where a mesh ended up inside the big buffers
+struct MeshAllocation
+{
+  GLuint mBaseVertex = 0;
+  GLuint mVertexCount = 0;
+  GLuint mFirstIndex = 0;
+  GLuint mIndexCount = 0;
+};
+
+// First fit allocator over [0, capacity), free neighbours are merged back together
+class RangeAllocator
+{
+  private:
+    struct Range
+    {
+      GLuint mOffset;
+      GLuint mSize;
+    };
+    std::vector<Range> mFreeRanges; // sorted by offset
+    GLuint mCapacity = 0;
+    GLuint mUsed = 0;
+
+  public:
+    void mReset(GLuint capacity);
+    bool mAllocate(GLuint size, GLuint* offset);
+    void mFree(GLuint offset, GLuint size);
+    GLuint mGetUsed() const { return mUsed; }
+    GLuint mGetCapacity() const { return mCapacity; }
+};
+
+// One VAO, one vertex buffer and one index buffer for every asset in the scene
+class GeometryPool
+{
+  private:
+    GLuint mVertexBufferObject = 0;
+    GLuint mIndexBufferObject = 0;
+    RangeAllocator mVertices;
+    RangeAllocator mIndices;
+
+  public:
+    GLuint mVertexArrayObject = 0;
+
+    void mCreate(GLuint vertexCapacity, GLuint indexCapacity);
+    bool mUpload(const Mesh3D& mesh, MeshAllocation* allocation);
+    void mRelease(const MeshAllocation& allocation);
+    void mSetInstanceIdBuffer(GLuint buffer);
+};
+#endif
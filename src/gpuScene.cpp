@@ -0,0 +1,678 @@
+#include "../glad/glad.h"
+#include "../glm/ext/matrix_transform.hpp"
+#include "../glm/gtc/type_ptr.hpp"
+
+#include <vector>
+#include <map>
+#include <string>
+#include <utility>
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include "gpuScene.hpp"
+#include "geometryPool.hpp"
+#include "frustum.hpp"
+#include "shader.hpp"
+#include "depthPyramid.hpp"
+#include "sceneFile.hpp"
+#include "counters.hpp"
+#include "memoryRegistry.hpp"
+
+
+GLuint GpuScene::mCreateBuffer(GLenum target, GLsizeiptr size, const void* data, GLenum usage, const char* owner)
+{
+  GLuint buffer = 0;
+  glGenBuffers(1, &buffer);
+  glBindBuffer(target, buffer);
+  // GL doesn't like zero sized buffers being bound as SSBOs
+  glBufferData(target, size > 0 ? size : 16, size > 0 ? data : nullptr, usage);
+  glBindBuffer(target, 0);
+  gMemory.mTrackBuffer(buffer, size > 0 ? size : 16, MemoryScene, owner);
+  return buffer;
+}
+
+
+void GpuScene::mBuild(const SceneStore& store, GLuint defaultPipeline, bool uploadsDone)
+{
+  // 1. every model file is uploaded once, no matter how many assets / instances use it
+  GLuint vertexTotal = 0;
+  GLuint indexTotal = 0;
+  std::map<std::string, const Mesh3D*> firstUser;
+  for (const Mesh3D& mesh : store.mAssets)
+  {
+    if (firstUser.count(mesh.mModelPath) || mesh.mVertexData.empty()) continue;
+    firstUser[mesh.mModelPath] = &mesh;
+    vertexTotal += mesh.mVertexData.size() / 3;
+    indexTotal += mesh.mIndexData.size();
+  }
+
+  // some headroom, so assets can be streamed in later without a rebuild
+  mPool.mCreate(vertexTotal + vertexTotal / 4 + 1, indexTotal + indexTotal / 4 + 1);
+
+  for (const auto& pair : firstUser)
+  {
+    const Mesh3D& mesh = *pair.second;
+    Asset asset;
+    if (!mPool.mUpload(mesh, &asset.mAllocation)) continue;
+
+    if (mesh.mMeshlets.empty()) asset.mClusters.push_back(buildWholeMeshlet(&mesh));
+    else asset.mClusters = mesh.mMeshlets;
+
+    mAssets[pair.first] = asset;
+  }
+
+  // 2. instances in the store's dense order [same index here as there, unless a model
+  // failed to load], what they are drawn with is kept for mBuildCommands
+  auto& instances = mInstances;
+  instances.clear();
+  mInstanceBoundsMin.clear();
+  mInstanceBoundsMax.clear();
+  mInstanceTextures.clear();
+  mInstancePipelines.clear();
+  mInstanceAssets.clear();
+  mOccluders.clear();
+  mPortalBoundsMin.clear();
+  mPortalBoundsMax.clear();
+  mInstanceLocalMin.clear();
+  mInstanceLocalMax.clear();
+  mInstanceOccluder.clear();
+
+  std::vector<bool> uploaded(store.mAssets.size());
+  size_t instanceCount = 0;
+  for (size_t i = 0; i < store.mAssets.size(); i++) uploaded[i] = mAssets.count(store.mAssets[i].mModelPath) > 0;
+  for (size_t i = 0; i < store.mCount(); i++) if (uploaded[store.mAsset[i]]) instanceCount++;
+  mTransforms.mResize(instanceCount);
+
+  std::vector<bool> portals;
+  for (size_t i = 0; i < store.mCount(); i++)
+  {
+    if (!uploaded[store.mAsset[i]]) continue;
+    const Mesh3D& asset = store.mAssets[store.mAsset[i]];
+
+    InstanceData instance;
+    instance.mColor = glm::vec4(store.mColor[i], 1.0f);
+    mTransforms.mSet(instances.size(), store.mOffset[i], store.mRotate[i], store.mScale[i]);
+    mInstanceLocalMin.push_back(store.mBoundsMin[i]);
+    mInstanceLocalMax.push_back(store.mBoundsMax[i]);
+
+    mInstanceOccluder.push_back(-1);
+    if (store.mFlags[i] & SceneAssetOccluder)
+    {
+      glm::vec3 size = store.mBoundsMax[i] - store.mBoundsMin[i];
+      OccluderProxy occluder;
+      occluder.mInstance = instances.size();
+      occluder.mMin = store.mBoundsMin[i] + size * asset.mOccluderBoxMin;
+      occluder.mMax = store.mBoundsMin[i] + size * asset.mOccluderBoxMax;
+      mInstanceOccluder.back() = mOccluders.size();
+      mOccluders.push_back(occluder);
+    }
+
+    portals.push_back((store.mFlags[i] & SceneAssetPortal) != 0);
+    mInstancePipelines.push_back(store.mPipeline[i] != 0 ? store.mPipeline[i] : defaultPipeline);
+    mInstanceTextures.push_back(store.mTexture[i]);
+    mInstanceAssets.push_back(asset.mModelPath);
+    instances.push_back(instance);
+  }
+
+  // matrices for all of them in one go, then everything that hangs off them
+  mInstanceBoundsMin.resize(instances.size());
+  mInstanceBoundsMax.resize(instances.size());
+  mTransforms.mUpdate(&mChangedTransforms, mJobs);
+  mApplyTransforms(mChangedTransforms);
+  for (GLuint i : mChangedTransforms) mWriteTransform(i, mTransforms.mModel(i), mTransforms.mNormal(i));
+
+  for (size_t i = 0; i < instances.size(); i++)
+  {
+    if (!portals[i]) continue;
+    mPortalBoundsMin.push_back(mInstanceBoundsMin[i]);
+    mPortalBoundsMax.push_back(mInstanceBoundsMax[i]);
+  }
+
+  // 3. textures resolved per instance, then the commands [placeholders are never moved
+  // into a layer, the cache still swaps them by name]
+  mResidency.mInit();
+  mBuildResidency(uploadsDone);
+  mAssignTextureSlots();
+
+  mInstanceBuffer = mCreateBuffer(GL_SHADER_STORAGE_BUFFER, instances.size() * sizeof(InstanceData), instances.data(), GL_DYNAMIC_DRAW, "instances");
+  mStatsBuffer = mCreateBuffer(GL_SHADER_STORAGE_BUFFER, sizeof(CullStats), nullptr, GL_DYNAMIC_COPY, "cull stats");
+  for (GLuint& buffer : mStatsReadbackBuffers)
+    buffer = mCreateBuffer(GL_COPY_WRITE_BUFFER, sizeof(CullStats), nullptr, GL_STREAM_READ, "cull stats readback");
+
+  std::vector<GLuint> allVisible(instances.size(), 1);
+  mVisibilityBuffer = mCreateBuffer(GL_SHADER_STORAGE_BUFFER, allVisible.size() * sizeof(GLuint), allVisible.data(), GL_DYNAMIC_DRAW, "instance visibility");
+  mVisibility = StreamAllocation();
+  mVisibility.mBuffer = mVisibilityBuffer;
+  mVisibility.mSize = std::max<GLsizeiptr>(16, allVisible.size() * sizeof(GLuint));
+  mBoundVisibility = mVisibility;
+
+  mBuildCommands();
+
+  Shader shader;
+  mCullProgram = shader.mCreateComputePipeline("shaders/cull/comp.glsl");
+
+  std::cout << "GPU scene: " << mAssets.size() << " assets, "
+            << instances.size() << " instances, "
+            << mCommandCount << " draw commands in "
+            << mBuckets.size() << " buckets, "
+            << mOccluders.size() << " occluders, "
+            << mPortalBoundsMin.size() << " portals" << std::endl;
+
+  mLightMasksDirty = true;
+}
+
+
+// Instances follow the textures that moved into array layers, mTextureMoves tells the rest
+void GpuScene::mBuildResidency(bool uploadsDone)
+{
+  mTextureMoves.clear();
+  mResidency.mBuild(mInstanceTextures, uploadsDone ? &mTextureMoves : nullptr);
+  for (const TextureSwap& move : mTextureMoves)
+    std::replace(mInstanceTextures.begin(), mInstanceTextures.end(), move.mOld, move.mNew);
+}
+
+
+// Layer + handle of every instance from the residency, CPU copy only
+void GpuScene::mAssignTextureSlots()
+{
+  for (size_t i = 0; i < mInstances.size(); i++)
+  {
+    TextureSlot slot = mResidency.mSlot(mInstanceTextures[i]);
+    mInstances[i].mTextureLayer = slot.mLayer;
+    mInstances[i].mTextureHandle = slot.mHandle;
+  }
+}
+
+
+// Instances grouped by [pipeline, texture array] and then by asset [with bindless the
+// array is always 0, so it's one bucket per pipeline]. Everything sized by the commands
+// is made again, can be called whenever the grouping changes
+void GpuScene::mBuildCommands()
+{
+  GLuint oldBuffers[] = {mClusterBuffer, mCullItemBuffer, mCommandTemplateBuffer, mCommandBuffer,
+                         mDisoccludedCommandTemplateBuffer, mDisoccludedCommandBuffer,
+                         mHiZRejectedBuffer, mVisibleInstanceBuffer};
+  gMemory.mDeleteBuffers(sizeof(oldBuffers) / sizeof(oldBuffers[0]), oldBuffers);
+
+  std::map<std::pair<GLuint, GLuint>, std::map<std::string, std::vector<GLuint>>> groups;
+  for (size_t i = 0; i < mInstances.size(); i++)
+  {
+    GLuint array = mResidency.mSlot(mInstanceTextures[i]).mArray;
+    groups[{mInstancePipelines[i], array}][mInstanceAssets[i]].push_back(i);
+  }
+
+  // one indirect command per [bucket, asset, cluster]
+  // every instance of that asset gets a slot in the visible list of the command
+  std::vector<DrawElementsIndirectCommand> commands;
+  std::vector<ClusterData> clusters;
+  std::vector<CullItem> cullItems;
+  GLuint visibleSlots = 0;
+
+  mBuckets.clear();
+  for (const auto& group : groups)
+  {
+    DrawBucket bucket;
+    bucket.mPipeline = group.first.first;
+    bucket.mTexture = group.first.second;
+    bucket.mFirstCommand = commands.size();
+
+    for (const auto& assetGroup : group.second)
+    {
+      const Asset& asset = mAssets[assetGroup.first];
+      const std::vector<GLuint>& users = assetGroup.second;
+
+      for (const Meshlet& meshlet : asset.mClusters)
+      {
+        DrawElementsIndirectCommand command;
+        command.mCount = meshlet.mTriangleCount * 3;
+        command.mInstanceCount = 0;
+        command.mFirstIndex = asset.mAllocation.mFirstIndex + meshlet.mIndexOffset;
+        command.mBaseVertex = asset.mAllocation.mBaseVertex;
+        command.mBaseInstance = visibleSlots;
+        visibleSlots += users.size();
+
+        ClusterData cluster;
+        cluster.mSphere = glm::vec4(meshlet.mCenter, meshlet.mRadius);
+        cluster.mCone = glm::vec4(meshlet.mConeAxis, meshlet.mConeCutoff);
+
+        for (GLuint user : users) cullItems.push_back({user, (GLuint)commands.size()});
+        commands.push_back(command);
+        clusters.push_back(cluster);
+      }
+    }
+
+    bucket.mCommandCount = commands.size() - bucket.mFirstCommand;
+    mBuckets.push_back(bucket);
+  }
+
+  mCommandCount = commands.size();
+  mCullItemCount = cullItems.size();
+
+  mClusterBuffer = mCreateBuffer(GL_SHADER_STORAGE_BUFFER, clusters.size() * sizeof(ClusterData), clusters.data(), GL_STATIC_DRAW, "clusters");
+  mCullItemBuffer = mCreateBuffer(GL_SHADER_STORAGE_BUFFER, cullItems.size() * sizeof(CullItem), cullItems.data(), GL_STATIC_DRAW, "cull items");
+  mCommandTemplateBuffer = mCreateBuffer(GL_COPY_READ_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STATIC_DRAW, "command templates");
+  mCommandBuffer = mCreateBuffer(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_DRAW, "commands");
+
+  // second Hi-Z phase: same commands, own half of the visible list
+  for (DrawElementsIndirectCommand& command : commands) command.mBaseInstance += visibleSlots;
+  mDisoccludedCommandTemplateBuffer = mCreateBuffer(GL_COPY_READ_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_STATIC_DRAW, "disoccluded command templates");
+  mDisoccludedCommandBuffer = mCreateBuffer(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), commands.data(), GL_DYNAMIC_DRAW, "disoccluded commands");
+  mHiZRejectedBuffer = mCreateBuffer(GL_SHADER_STORAGE_BUFFER, cullItems.size() * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW, "Hi-Z rejected");
+
+  mVisibleInstanceBuffer = mCreateBuffer(GL_ARRAY_BUFFER, 2 * visibleSlots * sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW, "visible instances");
+
+  mPool.mSetInstanceIdBuffer(mVisibleInstanceBuffer);
+}
+
+
+// ~~~~~~~ CPU side [simulation thread], no GL ~~~~~~~
+
+// Bits go to the render side through mSetLightMasks
+void GpuScene::mComputeLightMasks(const LightVolume* lights, int lightCount, std::vector<GLuint>& masks)
+{
+  computeLightMasks(lights, lightCount, mInstanceBoundsMin, mInstanceBoundsMax, masks, mJobs);
+  mLightMasksDirty = false;
+}
+
+
+// World boxes and occluders of the changed instances. Every instance only touches its own entries
+void GpuScene::mApplyTransforms(const std::vector<GLuint>& changed)
+{
+  auto apply = [&](uint32_t first, uint32_t last)
+  {
+    for (uint32_t n = first; n < last; n++)
+    {
+      GLuint i = changed[n];
+      const glm::mat4& model = mTransforms.mModel(i);
+      transformBox(model, mInstanceLocalMin[i], mInstanceLocalMax[i], &mInstanceBoundsMin[i], &mInstanceBoundsMax[i]);
+      if (mInstanceOccluder[i] >= 0) mOccluders[mInstanceOccluder[i]].mModel = model;
+    }
+  };
+
+  if (mJobs) mJobs->mParallelFor(changed.size(), 512, apply);
+  else apply(0, changed.size());
+}
+
+
+void GpuScene::mSetTransform(size_t instance, glm::vec3 offset, float rotate, glm::vec3 scale)
+{
+  if (instance < mTransforms.mCount()) mTransforms.mSet(instance, offset, rotate, scale);
+}
+
+
+// Nothing moves in the classroom so far, this is a flag check most frames. Portal boxes
+// stay where they were built [doors and windows don't move]
+bool GpuScene::mUpdateTransforms(std::vector<GLuint>& moved, std::vector<glm::mat4>& models, std::vector<glm::mat3>& normals)
+{
+  if (!mTransforms.mIsDirty()) return false;
+
+  mTransforms.mUpdate(&mChangedTransforms, mJobs);
+  mApplyTransforms(mChangedTransforms);
+
+  moved.assign(mChangedTransforms.begin(), mChangedTransforms.end());
+  models.resize(moved.size());
+  normals.resize(moved.size());
+  for (size_t n = 0; n < moved.size(); n++)
+  {
+    models[n] = mTransforms.mModel(moved[n]);
+    normals[n] = mTransforms.mNormal(moved[n]);
+  }
+
+  mLightMasksDirty = true;
+  return true;
+}
+
+
+// ~~~~~~~ GPU side [render thread] ~~~~~~~
+
+void GpuScene::mWriteTransform(size_t i, const glm::mat4& model, const glm::mat3& normal)
+{
+  mInstances[i].mModel = model;
+  for (int column = 0; column < 3; column++) mInstances[i].mNormalMatrix[column] = glm::vec4(normal[column], 0.0f);
+}
+
+
+void GpuScene::mSetTransforms(const std::vector<GLuint>& moved, const std::vector<glm::mat4>& models, const std::vector<glm::mat3>& normals)
+{
+  for (size_t n = 0; n < moved.size(); n++) mWriteTransform(moved[n], models[n], normals[n]);
+  mUploadInstances(moved);
+}
+
+
+// Only the runs of changed instances go to the SSBO [moved is sorted]
+// With the stream buffer a run is written there and copied over on the GPU
+void GpuScene::mUploadInstances(const std::vector<GLuint>& moved)
+{
+  glBindBuffer(GL_COPY_WRITE_BUFFER, mInstanceBuffer);
+  for (size_t first = 0; first < moved.size();)
+  {
+    size_t last = first;
+    while (last + 1 < moved.size() && moved[last + 1] == moved[last] + 1) last++;
+
+    GLuint count = moved[last] - moved[first] + 1;
+    size_t bytes = count * sizeof(InstanceData);
+    GLintptr offset = moved[first] * sizeof(InstanceData);
+
+    StreamAllocation staging;
+    if (mStream) staging = mStream->mAllocate(bytes, 16);
+    if (staging.mData)
+    {
+      memcpy(staging.mData, &mInstances[moved[first]], bytes);
+      glBindBuffer(GL_COPY_READ_BUFFER, staging.mBuffer);
+      glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, staging.mOffset, offset, bytes);
+    }
+    else
+    {
+      glBufferSubData(GL_COPY_WRITE_BUFFER, offset, bytes, &mInstances[moved[first]]);
+      Counters::mAdd(CounterUploadBytes, bytes);
+    }
+    first = last + 1;
+  }
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+
+// Masks are redone for every instance when anything moves, but only the ones that
+// changed go up [the same runs as mSetTransforms]
+void GpuScene::mSetLightMasks(const std::vector<GLuint>& masks)
+{
+  if (masks.size() != mInstances.size()) return;
+
+  long total = 0;
+  mChangedLightMasks.clear();
+  for (size_t i = 0; i < mInstances.size(); i++)
+  {
+    for (GLuint bits = masks[i]; bits != 0; bits &= bits - 1) total++;
+    if (mInstances[i].mLightMask == masks[i]) continue;
+
+    mInstances[i].mLightMask = masks[i];
+    mChangedLightMasks.push_back((GLuint)i);
+  }
+
+  mLightsPerInstance = mInstances.empty() ? 0.0f : (float)total / mInstances.size();
+  Counters::mAdd(CounterLightMaskChanges, mChangedLightMasks.size());
+  mUploadInstances(mChangedLightMasks);
+}
+
+
+void GpuScene::mSetInstanceVisibility(const std::vector<GLuint>& visibility)
+{
+  if (visibility.size() != mInstances.size() || visibility.empty()) return;
+
+  size_t bytes = visibility.size() * sizeof(GLuint);
+  StreamAllocation allocation;
+  if (mStream) allocation = mStream->mAllocate(bytes);
+  if (allocation.mData)
+  {
+    memcpy(allocation.mData, visibility.data(), bytes);
+    mVisibility = allocation;
+    return;
+  }
+
+  // no room, the old way
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, mVisibilityBuffer);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, bytes, visibility.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  Counters::mAdd(CounterUploadBytes, bytes);
+  mVisibility = StreamAllocation();
+  mVisibility.mBuffer = mVisibilityBuffer;
+  mVisibility.mSize = bytes;
+}
+
+
+// A texture finished streaming in, the instances still point at its placeholder
+// [which is deleted right after this, so its handle has to go now]
+void GpuScene::mReplaceTexture(GLuint oldTexture, GLuint newTexture)
+{
+  mResidency.mForget(oldTexture);
+  for (GLuint& texture : mInstanceTextures)
+  {
+    if (texture != oldTexture) continue;
+    texture = newTexture;
+    mTexturesDirty = true;
+  }
+}
+
+
+// Handles die with the placeholders, so bindless is redone right away. Arrays hold their
+// own copy [or a view], they wait for the last upload instead of regrouping every time
+void GpuScene::mRefreshTextures(bool uploadsDone)
+{
+  if (!mTexturesDirty) return;
+  if (!mResidency.mBindless && !uploadsDone) return;
+
+  mBuildResidency(uploadsDone);
+  mAssignTextureSlots();
+  if (!mResidency.mBindless) mBuildCommands();
+
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, mInstanceBuffer);
+  glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, mInstances.size() * sizeof(InstanceData), mInstances.data());
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+  mTexturesDirty = false;
+}
+
+
+void GpuScene::mResetCommands(GLuint templateBuffer, GLuint commandBuffer)
+{
+  // instanceCount back to zero
+  glBindBuffer(GL_COPY_READ_BUFFER, templateBuffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, commandBuffer);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, mCommandCount * sizeof(DrawElementsIndirectCommand));
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+
+void GpuScene::mSetHiZUniforms(const glm::mat4& projectionView, const DepthPyramid* hiZ)
+{
+  bool useHiZ = hiZ != nullptr && hiZ->mValid;
+
+  GLint location = glGetUniformLocation(mCullProgram, "u_hiZCulling");
+  glUniform1i(location, useHiZ ? 1 : 0);
+
+  location = glGetUniformLocation(mCullProgram, "u_projectionView");
+  glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(projectionView));
+
+  // 0 - 8 shadow maps, 9 object texture
+  glActiveTexture(GL_TEXTURE10);
+  glBindTexture(GL_TEXTURE_2D, useHiZ ? hiZ->mTextureObject : 0);
+  if (useHiZ) Counters::mAdd(CounterTextureBinds);
+  location = glGetUniformLocation(mCullProgram, "u_hiZ");
+  glUniform1i(location, 10);
+
+  if (!useHiZ) return;
+
+  location = glGetUniformLocation(mCullProgram, "u_hiZScreenSize");
+  glUniform2i(location, hiZ->mContentWidth, hiZ->mContentHeight); // what its depth covered
+
+  location = glGetUniformLocation(mCullProgram, "u_hiZLevels");
+  glUniform1i(location, hiZ->mLevels);
+}
+
+
+void GpuScene::mBindCullBuffers(GLuint commandBuffer)
+{
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mInstanceBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, mClusterBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, mCullItemBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, commandBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 4, mVisibleInstanceBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, mStatsBuffer);
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, 6, mBoundVisibility.mBuffer, mBoundVisibility.mOffset, mBoundVisibility.mSize);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, mHiZRejectedBuffer);
+}
+
+
+// The last cull's counters, copied on the GPU behind everything that wrote them [both phases]
+// with a fence after the copy. A slot whose fence never came back is dropped
+void GpuScene::mQueueStatsReadback()
+{
+  int slot = mStatsSlot;
+  if (mStatsFences[slot]) glDeleteSync(mStatsFences[slot]);
+
+  glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT);
+  glBindBuffer(GL_COPY_READ_BUFFER, mStatsBuffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, mStatsReadbackBuffers[slot]);
+  glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, sizeof(CullStats));
+  glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  mStatsFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  mStatsSlot = (slot + 1) % mStatsReadbackCount;
+}
+
+
+// Oldest copy first, stops at the first one still in flight [the ones after it are newer].
+// Only reads what the GPU is done with, the CPU never waits [same ring as GpuTimer]
+void GpuScene::mReadStats()
+{
+  for (int i = 0; i < mStatsReadbackCount; i++)
+  {
+    int slot = (mStatsSlot + i) % mStatsReadbackCount;
+    if (!mStatsFences[slot]) continue;
+
+    GLenum status = glClientWaitSync(mStatsFences[slot], 0, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) break;
+
+    glBindBuffer(GL_COPY_READ_BUFFER, mStatsReadbackBuffers[slot]);
+    glGetBufferSubData(GL_COPY_READ_BUFFER, 0, sizeof(CullStats), &mLastStats);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glDeleteSync(mStatsFences[slot]);
+    mStatsFences[slot] = 0;
+  }
+}
+
+
+// occlusionCulling uses the flags of the last mSetInstanceVisibility and hiZ the pyramid of
+// the last frame, both are only valid for the camera, so light passes leave them off
+void GpuScene::mCull(const glm::mat4& projectionView, glm::vec3 viewPos, bool coneCulling, bool occlusionCulling, const DepthPyramid* hiZ)
+{
+  // counters of a cull a few frames back, this one's go in the ring next time
+  if (mStatsPending) mQueueStatsReadback();
+  mReadStats();
+
+  // zeroed on the GPU, in order behind the copy
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, mStatsBuffer);
+  glClearBufferData(GL_SHADER_STORAGE_BUFFER, GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+  glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+  mStatsPending = true;
+
+  mResetCommands(mCommandTemplateBuffer, mCommandBuffer);
+  mResetCommands(mDisoccludedCommandTemplateBuffer, mDisoccludedCommandBuffer);
+
+  Frustum frustum(projectionView);
+
+  glUseProgram(mCullProgram);
+  Counters::mAdd(CounterProgramBinds);
+
+  GLint location = glGetUniformLocation(mCullProgram, "u_frustumPlanes[0]");
+  glUniform4fv(location, 6, glm::value_ptr(frustum.mPlanes[0]));
+
+  location = glGetUniformLocation(mCullProgram, "u_viewPos");
+  glUniform3f(location, viewPos.x, viewPos.y, viewPos.z);
+
+  location = glGetUniformLocation(mCullProgram, "u_coneCulling");
+  glUniform1i(location, coneCulling ? 1 : 0);
+
+  location = glGetUniformLocation(mCullProgram, "u_occlusionCulling");
+  glUniform1i(location, occlusionCulling ? 1 : 0);
+
+  location = glGetUniformLocation(mCullProgram, "u_itemCount");
+  glUniform1ui(location, mCullItemCount);
+
+  location = glGetUniformLocation(mCullProgram, "u_phase");
+  glUniform1i(location, 1);
+
+  // without CPU occlusion the flags aren't read, the fixed buffer is bound so a stream
+  // region from frames ago never is
+  if (occlusionCulling) mBoundVisibility = mVisibility;
+  else
+  {
+    mBoundVisibility = StreamAllocation();
+    mBoundVisibility.mBuffer = mVisibilityBuffer;
+    mBoundVisibility.mSize = std::max<GLsizeiptr>(16, mInstances.size() * sizeof(GLuint));
+  }
+
+  mSetHiZUniforms(projectionView, hiZ);
+  mBindCullBuffers(mCommandBuffer);
+
+  glDispatchCompute((mCullItemCount + 63) / 64, 1, 1);
+
+  // commands are read by the indirect draw, the visible list as a vertex attribute
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+
+// Second phase, hiZ has to be built from this frame's depth by now
+// Whatever was hidden last frame but shows up in this one ends in the disoccluded commands
+void GpuScene::mCullDisoccluded(const glm::mat4& projectionView, const DepthPyramid& hiZ)
+{
+  if (!hiZ.mValid) return;
+
+  glUseProgram(mCullProgram);
+  Counters::mAdd(CounterProgramBinds);
+
+  GLint location = glGetUniformLocation(mCullProgram, "u_itemCount");
+  glUniform1ui(location, mCullItemCount);
+
+  location = glGetUniformLocation(mCullProgram, "u_phase");
+  glUniform1i(location, 2);
+
+  mSetHiZUniforms(projectionView, &hiZ);
+  mBindCullBuffers(mDisoccludedCommandBuffer);
+
+  glDispatchCompute((mCullItemCount + 63) / 64, 1, 1);
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+
+void GpuScene::mDraw(GLuint pipeline, bool disoccluded)
+{
+  glBindVertexArray(mPool.mVertexArrayObject);
+  Counters::mAdd(CounterVertexArrayBinds);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, disoccluded ? mDisoccludedCommandBuffer : mCommandBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mInstanceBuffer);
+
+  GLint location = glGetUniformLocation(pipeline, "u_bindlessTextures");
+  glUniform1i(location, mResidency.mBindless ? 1 : 0);
+
+  for (const DrawBucket& bucket : mBuckets)
+  {
+    if (bucket.mPipeline != pipeline) continue;
+
+    // arrays only, with bindless the handles are in the instances
+    glActiveTexture(GL_TEXTURE9);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, bucket.mTexture);
+    glMultiDrawElementsIndirect(GL_TRIANGLES,
+                                GL_UNSIGNED_INT,
+                                (void*)(bucket.mFirstCommand * sizeof(DrawElementsIndirectCommand)),
+                                bucket.mCommandCount,
+                                0);
+    Counters::mAdd(CounterTextureBinds);
+    Counters::mAdd(CounterDrawCalls);
+    Counters::mAdd(CounterDrawCommands, bucket.mCommandCount);
+  }
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+
+// Depth only passes don't care about programs or textures, buckets are back to back
+void GpuScene::mDrawAll()
+{
+  glBindVertexArray(mPool.mVertexArrayObject);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, mCommandBuffer);
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, mInstanceBuffer);
+
+  glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, mCommandCount, 0);
+  Counters::mAdd(CounterVertexArrayBinds);
+  Counters::mAdd(CounterDrawCalls);
+  Counters::mAdd(CounterDrawCommands, mCommandCount);
+
+  glBindVertexArray(0);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
@@ -0,0 +1,199 @@
+#ifndef GPU_SCENE_HEADER
+#define GPU_SCENE_HEADER
+
+#include "../glad/glad.h"
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+#include <map>
+#include <string>
+
+#include "mesh.hpp"
+#include "meshlet.hpp"
+#include "geometryPool.hpp"
+#include "depthPyramid.hpp"
+#include "lightMask.hpp"
+#include "textureResidency.hpp"
+#include "transformArray.hpp"
+#include "sceneStore.hpp"
+#include "streamBuffer.hpp"
+#include "cpuMemory.hpp"
+
+// ~~~~~~~ Mirrors of the std430 structs in shaders/cull/comp.glsl, keep them in sync ~~~~~~~
+
+struct InstanceData
+{
+  glm::mat4 mModel;
+  glm::vec4 mNormalMatrix[3];     // mat3 in std430 [xyz of each column], inverse transpose of mModel
+  glm::vec4 mColor;
+  GLuint mLightMask = 0xFFFFFFFF; // bit i = light i reaches this instance
+  GLuint mTextureLayer = 0;       // layer in the bucket's texture array
+  GLuint64 mTextureHandle = 0;    // bindless handle, 0 when arrays are used
+};
+
+struct ClusterData
+{
+  glm::vec4 mSphere; // xyz center, w radius [object space]
+  glm::vec4 mCone;   // xyz axis, w cutoff
+};
+
+// one [instance, cluster] pair the culling shader has to look at
+struct CullItem
+{
+  GLuint mInstance;
+  GLuint mCommand;
+};
+
+// layout is fixed by GL
+struct DrawElementsIndirectCommand
+{
+  GLuint mCount;
+  GLuint mInstanceCount;
+  GLuint mFirstIndex;
+  GLint mBaseVertex;
+  GLuint mBaseInstance;
+};
+
+struct CullStats
+{
+  GLuint mVisibleTriangles = 0;
+  GLuint mCulledTriangles = 0;
+  GLuint mVisibleClusters = 0;
+  GLuint mCulledClusters = 0;
+  GLuint mOccludedClusters = 0;  // part of the culled ones, hidden by Hi-Z
+  GLuint mRecoveredClusters = 0; // dropped by the first Hi-Z phase, drawn by the second
+};
+
+// Solid box handed to the CPU occlusion culler [object space + its model matrix]
+struct OccluderProxy
+{
+  GLuint mInstance;
+  glm::mat4 mModel;
+  glm::vec3 mMin;
+  glm::vec3 mMax;
+};
+
+// Commands sharing a program and a texture array, drawn with one glMultiDrawElementsIndirect
+struct DrawBucket
+{
+  GLuint mPipeline = 0;
+  GLuint mTexture = 0; // GL_TEXTURE_2D_ARRAY, 0 with bindless textures
+  GLuint mFirstCommand = 0;
+  GLuint mCommandCount = 0;
+};
+
+
+// Whole scene lives on the GPU:
+//   every asset in one GeometryPool, every instance in one SSBO,
+//   a compute shader culls [instance, meshlet] pairs and fills the indirect commands
+//   with Hi-Z on, a second cull after the depth pyramid fills a second set of commands
+//
+// Split in two halves that run on different threads [main.cpp, render thread]: the CPU
+// side owns the transforms and boxes, the GPU side owns mInstances and the GL objects
+class GpuScene
+{
+  private:
+    struct Asset
+    {
+      MeshAllocation mAllocation;
+      std::vector<Meshlet> mClusters;
+    };
+
+    GeometryPool mPool;
+    std::map<std::string, Asset> mAssets;
+
+    GLuint mCullProgram = 0;
+    GLuint mInstanceBuffer = 0;
+    GLuint mClusterBuffer = 0;
+    GLuint mCullItemBuffer = 0;
+    GLuint mCommandBuffer = 0;
+    GLuint mCommandTemplateBuffer = 0; // commands with instanceCount = 0, copied over every cull
+    GLuint mVisibleInstanceBuffer = 0;
+    GLuint mStatsBuffer = 0;
+    static const int mStatsReadbackCount = 3;
+    GLuint mStatsReadbackBuffers[mStatsReadbackCount] = {}; // copies of mStatsBuffer, read once their fence is done
+    GLsync mStatsFences[mStatsReadbackCount] = {};
+    int mStatsSlot = 0;
+    GLuint mVisibilityBuffer = 0; // one uint per instance, the flags when mStream is off or full
+    GLuint mDisoccludedCommandBuffer = 0;
+    GLuint mDisoccludedCommandTemplateBuffer = 0;
+    GLuint mHiZRejectedBuffer = 0; // one uint per cull item, phase 1 tells phase 2 what to test again
+
+    GLuint mCommandCount = 0;
+    GLuint mCullItemCount = 0;
+    bool mStatsPending = false;
+
+    // this frame's CPU occlusion flags [in mStream, or mVisibilityBuffer without it] and what
+    // the cull binds, the latter only set by mCull so the second phase reads the same
+    StreamAllocation mVisibility;
+    StreamAllocation mBoundVisibility;
+
+    // per instance, what mBuildCommands groups by
+    TextureResidency mResidency;
+    std::vector<GLuint> mInstanceTextures;
+    std::vector<GLuint> mInstancePipelines;
+    std::vector<std::string> mInstanceAssets;
+    bool mTexturesDirty = false;
+
+    // placement of every instance, matrices are only redone for the ones that moved
+    TransformArray mTransforms;
+    std::vector<glm::vec3> mInstanceLocalMin; // mesh bounds, object space
+    std::vector<glm::vec3> mInstanceLocalMax;
+    std::vector<int> mInstanceOccluder;       // index in mOccluders, -1 for none
+    std::vector<GLuint> mChangedTransforms;
+    std::vector<GLuint> mChangedLightMasks; // render thread, reused
+
+    GLuint mCreateBuffer(GLenum target, GLsizeiptr size, const void* data, GLenum usage, const char* owner);
+    void mResetCommands(GLuint templateBuffer, GLuint commandBuffer);
+    void mQueueStatsReadback();
+    void mReadStats();
+    void mSetHiZUniforms(const glm::mat4& projectionView, const DepthPyramid* hiZ);
+    void mBindCullBuffers(GLuint commandBuffer);
+    void mAssignTextureSlots();
+    void mBuildCommands();
+    void mBuildResidency(bool uploadsDone);
+    void mApplyTransforms(const std::vector<GLuint>& changed);
+    void mUploadInstances(const std::vector<GLuint>& changed);
+    void mWriteTransform(size_t i, const glm::mat4& model, const glm::mat3& normal);
+
+  public:
+    std::vector<DrawBucket> mBuckets;
+    CullStats mLastStats;
+
+    // CPU copy of the instance SSBO [render thread]
+    TrackedVector<InstanceData, MemoryInstances> mInstances;
+
+    // for the cullers, indexed like the SSBO [simulation thread]
+    std::vector<glm::vec3> mInstanceBoundsMin;
+    std::vector<glm::vec3> mInstanceBoundsMax;
+    std::vector<OccluderProxy> mOccluders;
+    std::vector<glm::vec3> mPortalBoundsMin; // world boxes of the portal instances
+    std::vector<glm::vec3> mPortalBoundsMax;
+    bool mLightMasksDirty = true; // instances moved since the last mComputeLightMasks
+    JobSystem* mJobs = nullptr;   // CPU side work is split over it when set, GL stays on this thread
+    StreamBuffer* mStream = nullptr; // per frame uploads go through it when set
+
+    void mBuild(const SceneStore& store, GLuint defaultPipeline, bool uploadsDone = true);
+    std::vector<TextureSwap> mTextureMoves; // textures that now live in an array layer, the store + cache switch over
+
+    // CPU side, the simulation thread: placement, boxes, occluders, light masks. What the
+    // GPU side needs comes out of here and goes over in the render packet
+    void mSetTransform(size_t instance, glm::vec3 offset, float rotate, glm::vec3 scale); // applied by mUpdateTransforms
+    bool mUpdateTransforms(std::vector<GLuint>& moved, std::vector<glm::mat4>& models, std::vector<glm::mat3>& normals); // false: nothing moved
+    bool mTransformsDirty() const { return mTransforms.mIsDirty(); } // mSetTransform since the last mUpdateTransforms
+    void mComputeLightMasks(const LightVolume* lights, int lightCount, std::vector<GLuint>& masks);
+
+    // GPU side, the render thread: mInstances and everything GL
+    void mSetTransforms(const std::vector<GLuint>& moved, const std::vector<glm::mat4>& models, const std::vector<glm::mat3>& normals);
+    void mSetLightMasks(const std::vector<GLuint>& masks);
+    float mLightsPerInstance = 0.0f; // average bits of the last mSetLightMasks [render thread]
+    void mSetInstanceVisibility(const std::vector<GLuint>& visibility);
+    void mReplaceTexture(GLuint oldTexture, GLuint newTexture);
+    void mRefreshTextures(bool uploadsDone);
+    void mCull(const glm::mat4& projectionView, glm::vec3 viewPos, bool coneCulling,
+               bool occlusionCulling = false, const DepthPyramid* hiZ = nullptr);
+    void mCullDisoccluded(const glm::mat4& projectionView, const DepthPyramid& hiZ);
+    void mDraw(GLuint pipeline, bool disoccluded = false);
+    void mDrawAll();
+};
+#endif
@@ -0,0 +1,63 @@
+#include "../glad/glad.h"
+
+#include "gpuTimer.hpp"
+
+
+void GpuTimer::mBegin()
+{
+  if (mQueries[0] == 0) glGenQueries(mQueryCount, mQueries);
+
+  // this slot was used mQueryCount frames ago, it is usually done by now
+  GLuint query = mQueries[mCurrent];
+  if (mIssued[mCurrent])
+  {
+    GLint available = 0;
+    glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available)
+    {
+      GLuint64 nanoseconds = 0;
+      glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+      mLastMs = nanoseconds / 1000000.0f;
+    }
+  }
+
+  glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+
+void GpuTimer::mEnd()
+{
+  glEndQuery(GL_TIME_ELAPSED);
+  mIssued[mCurrent] = true;
+  mCurrent = (mCurrent + 1) % mQueryCount;
+}
+
+
+void GpuFrameTimer::mBegin()
+{
+  if (mQueries[0] == 0) glGenQueries(mQueryCount * 2, mQueries);
+
+  GLuint* pair = mQueries + mCurrent * 2;
+  if (mIssued[mCurrent])
+  {
+    GLint available = 0;
+    glGetQueryObjectiv(pair[1], GL_QUERY_RESULT_AVAILABLE, &available); // the end is the later one
+    if (available)
+    {
+      GLuint64 begin = 0, end = 0;
+      glGetQueryObjectui64v(pair[0], GL_QUERY_RESULT, &begin);
+      glGetQueryObjectui64v(pair[1], GL_QUERY_RESULT, &end);
+      mLastMs = (end - begin) / 1000000.0f;
+    }
+  }
+
+  glQueryCounter(pair[0], GL_TIMESTAMP);
+}
+
+
+void GpuFrameTimer::mEnd()
+{
+  glQueryCounter(mQueries[mCurrent * 2 + 1], GL_TIMESTAMP);
+  mIssued[mCurrent] = true;
+  mCurrent = (mCurrent + 1) % mQueryCount;
+}
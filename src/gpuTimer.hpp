@@ -0,0 +1,40 @@
+#ifndef GPU_TIMER_HEADER
+#define GPU_TIMER_HEADER
+
+#include "../glad/glad.h"
+
+// GL_TIME_ELAPSED around a block of GL calls
+// A few queries in flight, results are picked up frames later so the CPU never waits
+// Timers can't overlap each other [GL allows one TIME_ELAPSED query at a time]
+class GpuTimer
+{
+  public:
+    float mLastMs = 0.0f;
+
+    void mBegin();
+    void mEnd();
+
+  private:
+    static const int mQueryCount = 3;
+    GLuint mQueries[mQueryCount] = {};
+    bool mIssued[mQueryCount] = {};
+    int mCurrent = 0;
+};
+
+// Same ring with two GL_TIMESTAMP queries instead, so it can wrap the whole frame
+// while the GpuTimers inside it run [what dynamic resolution steers by]
+class GpuFrameTimer
+{
+  public:
+    float mLastMs = 0.0f;
+
+    void mBegin();
+    void mEnd();
+
+  private:
+    static const int mQueryCount = 3;
+    GLuint mQueries[mQueryCount * 2] = {}; // begin, end
+    bool mIssued[mQueryCount] = {};
+    int mCurrent = 0;
+};
+#endif
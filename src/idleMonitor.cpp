@@ -0,0 +1,94 @@
+#include "idleMonitor.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdio>
+
+#include <sys/resource.h>
+
+
+static double wallSeconds()
+{
+  return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+
+// user + system of the whole process, every thread
+static double cpuSeconds()
+{
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+
+// package 0 energy counter, -1 when there is none or it's root only
+static double packageJoules()
+{
+  FILE* fp = fopen("/sys/class/powercap/intel-rapl:0/energy_uj", "r");
+  if (!fp) return -1.0;
+
+  unsigned long long microJoules = 0;
+  bool ok = fscanf(fp, "%llu", &microJoules) == 1;
+  fclose(fp);
+  return ok ? microJoules / 1e6 : -1.0;
+}
+
+
+void IdleMonitor::mSample()
+{
+  double seconds = wallSeconds(), cpu = cpuSeconds(), joules = packageJoules();
+  if (mSampled)
+  {
+    Totals& totals = mTotals[mIdleNow ? 1 : 0];
+    totals.mSeconds += seconds - mLastSeconds;
+    totals.mCpuSeconds += cpu - mLastCpuSeconds;
+    if (joules >= mLastJoules && mLastJoules >= 0.0) totals.mJoules += joules - mLastJoules; // skips a wrap around
+  }
+
+  mSampled = true;
+  mLastSeconds = seconds;
+  mLastCpuSeconds = cpu;
+  mLastJoules = joules;
+}
+
+
+bool IdleMonitor::mUpdate(bool changed)
+{
+  if (!mSampled) mSample();
+
+  mUnchanged = changed || !mEnabled ? 0 : mUnchanged + 1;
+  bool idle = mUnchanged > mSettleFrames;
+  if (idle != mIdleNow)
+  {
+    mSample();
+    mIdleNow = idle;
+  }
+
+  mTotals[mIdleNow ? 1 : 0].mFrames++;
+  return mIdleNow;
+}
+
+
+void IdleMonitor::mPrintReport()
+{
+  mSample();
+
+  const char* names[2] = {"drawing", "idle"};
+  bool energy = mLastJoules >= 0.0;
+
+  std::cout << std::fixed << std::setprecision(2) << "Idle mode: " << (mEnabled ? "on" : "off") << ", "
+            << mPresents << " re-presents" << std::endl;
+  for (int state = 0; state < 2; state++)
+  {
+    const Totals& totals = mTotals[state];
+    if (totals.mSeconds <= 0.0) continue;
+
+    std::cout << "  " << std::left << std::setw(8) << names[state] << std::right << totals.mSeconds << " s, "
+              << totals.mFrames << " frames, CPU " << 100.0 * totals.mCpuSeconds / totals.mSeconds << "% of a core";
+    if (energy) std::cout << ", package " << totals.mJoules / totals.mSeconds << " W";
+    std::cout << std::endl;
+  }
+  std::cout << std::defaultfloat << std::setprecision(6);
+}
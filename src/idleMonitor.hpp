@@ -0,0 +1,64 @@
+#ifndef IDLE_MONITOR_HEADER
+#define IDLE_MONITOR_HEADER
+
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <cstdint>
+
+// What the image depends on besides the scene itself, a frame with the same inputs as
+// the last one and nothing dirty draws the same pixels
+struct FrameInputs
+{
+  glm::mat4 mView = glm::mat4(0.0f);
+  glm::mat4 mProjection = glm::mat4(0.0f);
+  uint32_t mSwitches = 0; // bit per toggle [main.cpp, CurrentInputs]
+
+  bool operator==(const FrameInputs& other) const
+  {
+    return mView == other.mView && mProjection == other.mProjection && mSwitches == other.mSwitches;
+  }
+};
+
+// Redraw on demand: after mSettleFrames unchanged frames [the Hi-Z pyramid and the query
+// rings are a frame or two behind] the loop stops drawing, the scene target still holds
+// the last image and is only presented again when the window asks [exposed, restored].
+// The simulation thread waits for events meanwhile, mWaitSeconds at most
+//
+// Time, CPU time and package energy [RAPL, when the powercap files are readable] are
+// summed per state, sampled on every switch, for the report at exit
+class IdleMonitor
+{
+  public:
+    bool mEnabled = true;       // --idle 0 draws every frame
+    int mSettleFrames = 3;
+    double mWaitSeconds = 0.5;
+
+    // once a frame, true = nothing to draw
+    bool mUpdate(bool changed);
+    bool mIdle() const { return mIdleNow; }
+    void mCountPresent() { mPresents++; }
+
+    void mPrintReport();
+
+  private:
+    struct Totals
+    {
+      double mSeconds = 0.0;
+      double mCpuSeconds = 0.0;
+      double mJoules = 0.0;
+      uint64_t mFrames = 0;
+    };
+
+    int mUnchanged = 0;
+    bool mIdleNow = false;
+    uint64_t mPresents = 0;
+    Totals mTotals[2]; // drawing, idle
+
+    bool mSampled = false;
+    double mLastSeconds = 0.0;
+    double mLastCpuSeconds = 0.0;
+    double mLastJoules = -1.0; // < 0: no RAPL
+
+    void mSample(); // adds everything since the last sample to the current state
+};
+#endif
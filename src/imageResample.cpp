@@ -0,0 +1,161 @@
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "imageResample.hpp"
+
+
+// Clamped source index + normalized weight of every tap of every output pixel on one axis
+struct FilterTaps
+{
+  int mTapCount = 0;
+  std::vector<int> mIndex;
+  std::vector<float> mWeight;
+};
+
+
+static float lanczos3(float x)
+{
+  x = std::fabs(x);
+  if (x < 1e-5f) return 1.0f;
+  if (x >= 3.0f) return 0.0f;
+
+  const float pi = 3.14159265358979f;
+  float px = pi * x;
+  return 3.0f * std::sin(px) * std::sin(px / 3.0f) / (px * px);
+}
+
+
+static void buildTaps(int sourceSize, int destinationSize, FilterTaps* taps)
+{
+  float scale = (float)sourceSize / destinationSize;
+  float filterScale = std::max(1.0f, scale); // shrinking widens the kernel, growing doesn't
+  float support = 3.0f * filterScale;
+
+  taps->mTapCount = (int)std::ceil(support * 2.0f) + 1;
+  taps->mIndex.resize((size_t)destinationSize * taps->mTapCount);
+  taps->mWeight.resize((size_t)destinationSize * taps->mTapCount);
+
+  for (int o = 0; o < destinationSize; o++)
+  {
+    // pixel centers sit at i + 0.5 on both sides
+    float center = (o + 0.5f) * scale - 0.5f;
+    int first = (int)std::ceil(center - support);
+
+    int* index = &taps->mIndex[(size_t)o * taps->mTapCount];
+    float* weight = &taps->mWeight[(size_t)o * taps->mTapCount];
+    float sum = 0.0f;
+    for (int k = 0; k < taps->mTapCount; k++)
+    {
+      index[k] = std::min(sourceSize - 1, std::max(0, first + k));
+      weight[k] = lanczos3((first + k - center) / filterScale);
+      sum += weight[k];
+    }
+    for (int k = 0; k < taps->mTapCount; k++) weight[k] /= sum;
+  }
+}
+
+
+// one source row -> newWidth float RGBA pixels
+static void filterRow(const unsigned char* row, int channels, const FilterTaps& taps, int newWidth, float* out)
+{
+  for (int o = 0; o < newWidth; o++)
+  {
+    const int* index = &taps.mIndex[(size_t)o * taps.mTapCount];
+    const float* weight = &taps.mWeight[(size_t)o * taps.mTapCount];
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    __m128 sum = _mm_setzero_ps();
+    for (int k = 0; k < taps.mTapCount; k++)
+    {
+      const unsigned char* p = row + (size_t)index[k] * channels;
+      __m128 pixel;
+      if (channels == 4)
+      {
+        int packed;
+        memcpy(&packed, p, 4);
+        pixel = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero));
+      }
+      else pixel = _mm_setr_ps(p[0], p[1], p[2], 255.0f); // last pixel of the row has no 4th byte to read
+      sum = _mm_add_ps(sum, _mm_mul_ps(pixel, _mm_set1_ps(weight[k])));
+    }
+    _mm_storeu_ps(out + o * 4, sum);
+#else
+    float sum[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int k = 0; k < taps.mTapCount; k++)
+    {
+      const unsigned char* p = row + (size_t)index[k] * channels;
+      for (int c = 0; c < 4; c++) sum[c] += (c < channels ? p[c] : 255.0f) * weight[k];
+    }
+    memcpy(out + o * 4, sum, sizeof(sum));
+#endif
+  }
+}
+
+
+void resampleImage(const unsigned char* source, int width, int height, int channels,
+                   unsigned char* destination, int newWidth, int newHeight)
+{
+  FilterTaps horizontal, vertical;
+  buildTaps(width, newWidth, &horizontal);
+  buildTaps(height, newHeight, &vertical);
+
+  // window of horizontally filtered rows, row r lives in slot r % ringRows
+  int ringRows = vertical.mTapCount;
+  size_t rowFloats = (size_t)newWidth * 4;
+  std::vector<float> ring(rowFloats * ringRows);
+  std::vector<float> sum(rowFloats);
+  int filteredUpTo = -1;
+
+  for (int o = 0; o < newHeight; o++)
+  {
+    const int* index = &vertical.mIndex[(size_t)o * vertical.mTapCount];
+    const float* weight = &vertical.mWeight[(size_t)o * vertical.mTapCount];
+
+    // windows only move down, the last tap is the lowest row
+    for (int row = filteredUpTo + 1; row <= index[vertical.mTapCount - 1]; row++)
+    {
+      filterRow(source + (size_t)row * width * channels, channels, horizontal, newWidth, &ring[(row % ringRows) * rowFloats]);
+    }
+    filteredUpTo = std::max(filteredUpTo, index[vertical.mTapCount - 1]);
+
+    std::fill(sum.begin(), sum.end(), 0.0f);
+    for (int k = 0; k < vertical.mTapCount; k++)
+    {
+      const float* row = &ring[(index[k] % ringRows) * rowFloats];
+#if defined(__SSE2__)
+      __m128 w = _mm_set1_ps(weight[k]);
+      for (size_t j = 0; j < rowFloats; j += 4)
+      {
+        _mm_storeu_ps(&sum[j], _mm_add_ps(_mm_loadu_ps(&sum[j]), _mm_mul_ps(_mm_loadu_ps(row + j), w)));
+      }
+#else
+      for (size_t j = 0; j < rowFloats; j++) sum[j] += row[j] * weight[k];
+#endif
+    }
+
+    // lanczos rings below 0 and above 255, clamp while packing
+    unsigned char* out = destination + (size_t)o * newWidth * channels;
+    for (int x = 0; x < newWidth; x++)
+    {
+#if defined(__SSE2__)
+      __m128i rounded = _mm_cvtps_epi32(_mm_loadu_ps(&sum[x * 4])); // rounds to nearest
+      __m128i packed = _mm_packus_epi16(_mm_packs_epi32(rounded, rounded), _mm_setzero_si128());
+      int pixel = _mm_cvtsi128_si32(packed);
+      memcpy(out + x * channels, &pixel, channels);
+#else
+      for (int c = 0; c < channels; c++)
+      {
+        float value = std::floor(sum[x * 4 + c] + 0.5f);
+        out[x * channels + c] = (unsigned char)std::min(255.0f, std::max(0.0f, value));
+      }
+#endif
+    }
+  }
+}
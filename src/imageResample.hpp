@@ -0,0 +1,11 @@
+#ifndef IMAGE_RESAMPLE_HEADER
+#define IMAGE_RESAMPLE_HEADER
+
+// Separable Lanczos 3 resize of 8 bit images [3 or 4 channels]
+//
+// Rows are filtered horizontally into float RGBA as the vertical pass needs them, only
+// a window of them is kept, so huge images don't need a full float copy. Both passes
+// work on whole pixels / runs of floats with SSE
+void resampleImage(const unsigned char* source, int width, int height, int channels,
+                   unsigned char* destination, int newWidth, int newHeight);
+#endif
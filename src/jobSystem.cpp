@@ -0,0 +1,201 @@
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <iostream>
+
+#include "jobSystem.hpp"
+#include "allocTracker.hpp"
+
+// which deque is this thread's, -1 for threads the system doesn't know [they run jobs inline]
+static thread_local int gThreadIndex = -1;
+
+
+bool JobSystem::Deque::mPush(Job* job)
+{
+  int64_t bottom = mBottom.load(std::memory_order_relaxed);
+  int64_t top = mTop.load(std::memory_order_acquire);
+  if (bottom - top >= mCapacity) return false;
+
+  mItems[bottom & (mCapacity - 1)].store(job, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  mBottom.store(bottom + 1, std::memory_order_relaxed);
+  return true;
+}
+
+
+// Owner only. The last job can race a thief, the CAS on top decides who gets it
+JobSystem::Job* JobSystem::Deque::mPop()
+{
+  int64_t bottom = mBottom.load(std::memory_order_relaxed) - 1;
+  mBottom.store(bottom, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t top = mTop.load(std::memory_order_relaxed);
+
+  if (top > bottom)
+  {
+    mBottom.store(bottom + 1, std::memory_order_relaxed); // was empty
+    return nullptr;
+  }
+
+  Job* job = mItems[bottom & (mCapacity - 1)].load(std::memory_order_relaxed);
+  if (top == bottom)
+  {
+    if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) job = nullptr;
+    mBottom.store(bottom + 1, std::memory_order_relaxed);
+  }
+  return job;
+}
+
+
+JobSystem::Job* JobSystem::Deque::mSteal()
+{
+  int64_t top = mTop.load(std::memory_order_acquire);
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  int64_t bottom = mBottom.load(std::memory_order_acquire);
+  if (top >= bottom) return nullptr;
+
+  Job* job = mItems[top & (mCapacity - 1)].load(std::memory_order_relaxed);
+  if (!mTop.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) return nullptr;
+  return job;
+}
+
+
+void JobSystem::mStart(int workers)
+{
+  mStop();
+  if (workers < 0) workers = std::max(0, (int)std::thread::hardware_concurrency() - 1);
+  if (workers == 0) return;
+
+  mQuit = false;
+  for (int i = 0; i <= workers; i++) mThreads.push_back(std::unique_ptr<Thread>(new Thread()));
+
+  gThreadIndex = 0;
+  for (int i = 1; i <= workers; i++) mThreads[i]->mThread = std::thread(&JobSystem::mWorker, this, i);
+  std::cout << "Jobs: " << workers << " workers + the main thread" << std::endl;
+}
+
+
+void JobSystem::mStop()
+{
+  if (mThreads.empty()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQuit = true;
+  }
+  mWake.notify_all();
+  for (std::unique_ptr<Thread>& thread : mThreads)
+  {
+    if (thread->mThread.joinable()) thread->mThread.join();
+  }
+  mThreads.clear();
+  gThreadIndex = -1;
+}
+
+
+void JobSystem::mRun(JobFunction function, void* data, uint32_t begin, uint32_t end, Counter* counter)
+{
+  counter->mPending.fetch_add(1, std::memory_order_relaxed);
+
+  Job inlineJob = {function, data, begin, end, counter};
+  int index = gThreadIndex;
+  if (index < 0 || index >= (int)mThreads.size())
+  {
+    mExecute(&inlineJob);
+    return;
+  }
+
+  Thread& thread = *mThreads[index];
+  Job* job = &thread.mPool[thread.mNextJob++ & (mCapacity - 1)];
+  *job = inlineJob;
+  if (!thread.mDeque.mPush(job))
+  {
+    mExecute(job); // full, no point waiting for room
+    return;
+  }
+
+  mQueued.fetch_add(1, std::memory_order_seq_cst);
+  if (mSleeping.load(std::memory_order_seq_cst) > 0)
+  {
+    // under the lock, or the wake up could land between a sleeper's check and its wait
+    std::lock_guard<std::mutex> lock(mMutex);
+    mWake.notify_one();
+  }
+}
+
+
+void JobSystem::mExecute(Job* job)
+{
+  Job local = *job; // the slot goes back to its ring
+  local.mFunction(local.mData, local.mBegin, local.mEnd);
+  local.mCounter->mPending.fetch_sub(1, std::memory_order_release);
+}
+
+
+// own jobs first [newest, still in cache], then the oldest of someone else's
+JobSystem::Job* JobSystem::mFind(int index)
+{
+  Thread& thread = *mThreads[index];
+  Job* job = thread.mDeque.mPop();
+  if (!job)
+  {
+    int count = mThreads.size();
+    for (int i = 0; i < count && !job; i++)
+    {
+      int victim = (thread.mVictim + i) % count;
+      if (victim != index) job = mThreads[victim]->mDeque.mSteal();
+      if (job) thread.mVictim = victim;
+    }
+  }
+  if (job) mQueued.fetch_sub(1, std::memory_order_relaxed);
+  return job;
+}
+
+
+// Helps out instead of blocking, a job waiting on its children keeps the thread busy
+void JobSystem::mWait(Counter* counter)
+{
+  int index = gThreadIndex;
+  while (counter->mPending.load(std::memory_order_acquire) > 0)
+  {
+    Job* job = (index >= 0 && index < (int)mThreads.size()) ? mFind(index) : nullptr;
+    if (job) mExecute(job);
+    else std::this_thread::yield();
+  }
+}
+
+
+// Spins a little after running out of work [the next parallel for is usually right
+// behind], then sleeps until something is pushed
+void JobSystem::mWorker(int index)
+{
+  AllocScope scope("jobs");
+  gThreadIndex = index;
+  int idle = 0;
+  while (!mQuit.load(std::memory_order_relaxed))
+  {
+    Job* job = mFind(index);
+    if (job)
+    {
+      mExecute(job);
+      idle = 0;
+      continue;
+    }
+
+    if (++idle < 256)
+    {
+      std::this_thread::yield();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mSleeping.fetch_add(1, std::memory_order_seq_cst);
+    mWake.wait(lock, [this]() { return mQueued.load(std::memory_order_seq_cst) > 0 || mQuit.load(); });
+    mSleeping.fetch_sub(1, std::memory_order_seq_cst);
+    idle = 0;
+  }
+}
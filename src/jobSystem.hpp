@@ -0,0 +1,112 @@
+#ifndef JOB_SYSTEM_HEADER
+#define JOB_SYSTEM_HEADER
+
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+
+// Work stealing job system for the CPU side of a frame [culling, light masks, matrices]
+//
+// Every thread [the workers + the one that called mStart, index 0] owns a Chase-Lev deque:
+// it pushes and pops its own jobs at the bottom, idle threads steal from the top of the
+// others'. A job is a function pointer + data + a [begin, end) range, nothing is allocated
+// per job [each thread has a ring of them]
+//
+// Dependencies are counters: mRun adds one to the counter, the job finishing takes it
+// away, mWait(counter) runs other jobs until it is zero. Jobs may start more jobs on the
+// same counter. GL stays on the main thread, jobs never touch it
+class JobSystem
+{
+  public:
+    typedef void (*JobFunction)(void* data, uint32_t begin, uint32_t end);
+
+    struct Counter
+    {
+      std::atomic<int> mPending{0};
+    };
+
+    ~JobSystem() { mStop(); }
+
+    // workers < 0: one less than the hardware threads, 0: everything runs on the caller
+    void mStart(int workers = -1);
+    void mStop();
+    int mThreadCount() const { return mThreads.empty() ? 1 : (int)mThreads.size(); } // workers + the main thread
+
+    void mRun(JobFunction function, void* data, uint32_t begin, uint32_t end, Counter* counter);
+    void mWait(Counter* counter);
+
+    // body(begin, end) over [0, count) in chunks of at least grain, returns when all are done
+    template <typename Body>
+    void mParallelFor(uint32_t count, uint32_t grain, const Body& body)
+    {
+      if (count == 0) return;
+      int threads = mThreadCount();
+      if (threads <= 1 || count <= grain)
+      {
+        body(0, count);
+        return;
+      }
+
+      // ~8 chunks per thread is enough to even things out and keeps the rings small
+      uint32_t chunks = threads * 8;
+      uint32_t size = (count + chunks - 1) / chunks;
+      if (size < grain) size = grain;
+
+      Counter counter;
+      for (uint32_t begin = 0; begin < count; begin += size)
+      {
+        uint32_t end = begin + size < count ? begin + size : count;
+        mRun([](void* data, uint32_t b, uint32_t e) { (*(const Body*)data)(b, e); }, (void*)&body, begin, end, &counter);
+      }
+      mWait(&counter);
+    }
+
+  private:
+    struct Job
+    {
+      JobFunction mFunction = nullptr;
+      void* mData = nullptr;
+      uint32_t mBegin = 0;
+      uint32_t mEnd = 0;
+      Counter* mCounter = nullptr;
+    };
+
+    static const int64_t mCapacity = 4096; // jobs in flight per thread, power of two
+
+    // Chase-Lev: the owner at the bottom, thieves at the top
+    struct Deque
+    {
+      std::atomic<int64_t> mTop{0};
+      std::atomic<int64_t> mBottom{0};
+      std::atomic<Job*> mItems[mCapacity];
+
+      bool mPush(Job* job);
+      Job* mPop();
+      Job* mSteal();
+    };
+
+    struct Thread
+    {
+      Deque mDeque;
+      Job mPool[mCapacity];
+      uint32_t mNextJob = 0; // ring, only the owner allocates
+      uint32_t mVictim = 0;  // where stealing starts next
+      std::thread mThread;
+    };
+
+    std::vector<std::unique_ptr<Thread>> mThreads;
+    std::atomic<int> mQueued{0};   // pushed and not taken yet
+    std::atomic<int> mSleeping{0};
+    std::atomic<bool> mQuit{false};
+    std::mutex mMutex;
+    std::condition_variable mWake;
+
+    void mWorker(int index);
+    Job* mFind(int index);
+    void mExecute(Job* job);
+};
+#endif
@@ -23,6 +23,7 @@ Light::Light()
   mOuterCutOffAngle = 75.0f;
   mInnerCutOffCosine = cos(glm::radians(mInnerCutOffAngle));
   mOuterCutOffCosine = cos(glm::radians(mOuterCutOffAngle));
+  mInfluenceThreshold = 0.02f;
 }
 
 // don't remove this blank constructor
@@ -45,7 +46,7 @@ glm::mat4 Light::mGetProjectionMatrix()
   return projection;
 }
 
-void Light::mGenShadowMap(std::map<std::string, Mesh3D> meshes)
+void Light::mGenShadowMap(GpuScene& scene)
 {
   mShadowMap.SetLightPosition(mPosition);
   GLuint shaderID = mShader.mCreateGraphicsPipeline("shaders/shadow/vert.glsl", "shaders/shadow/frag.glsl");
@@ -57,5 +58,20 @@ void Light::mGenShadowMap(std::map<std::string, Mesh3D> meshes)
   glm::mat4 lightViewSpace = mGetViewMatrix();
   glm::mat4 lightProjectionSpace = mGetProjectionMatrix();
 
-  mShadowMap.GenShadowMap(meshes, lightViewSpace, lightProjectionSpace);
+  mShadowMap.GenShadowMap(scene, lightViewSpace, lightProjectionSpace);
+}
+
+
+LightVolume Light::mGetVolume() const
+{
+  LightVolume volume;
+  volume.mPosition = mPosition;
+  volume.mDirection = glm::normalize(mTargetDirection);
+  volume.mCosOuter = cos(glm::radians(mOuterCutOffAngle));
+  volume.mSinOuter = sin(glm::radians(mOuterCutOffAngle));
+
+  // 1 / (1 + linear * d + quad * d^2) = threshold, solved for d
+  float c = 1.0f - 1.0f / mInfluenceThreshold;
+  volume.mRange = (-attenuationLinear + sqrt(attenuationLinear * attenuationLinear - 4.0f * attenuationQuad * c)) / (2.0f * attenuationQuad);
+  return volume;
 }
@@ -9,6 +9,8 @@
 #include "shadowMap.hpp"
 #include "mesh.hpp"
 #include "shader.hpp"
+#include "gpuScene.hpp"
+#include "lightMask.hpp"
 
 
 class Light
@@ -29,6 +31,7 @@ class Light
     float mOuterCutOffAngle;
     float mInnerCutOffCosine;
     float mOuterCutOffCosine;
+    float mInfluenceThreshold; // attenuation under which the light is ignored [light masks]
 
     ShadowMap mShadowMap;
     Shader mShader;
@@ -37,6 +40,7 @@ class Light
     Light(glm::vec3);
     glm::mat4 mGetProjectionMatrix();
     glm::mat4 mGetViewMatrix();
-    void mGenShadowMap(std::map<std::string, Mesh3D> meshes);
+    void mGenShadowMap(GpuScene& scene);
+    LightVolume mGetVolume() const;
 };
 #endif
@@ -0,0 +1,116 @@
+#include "../glad/glad.h"
+#include "../glm/ext/matrix_transform.hpp"
+#include "../glm/geometric.hpp"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "lightMask.hpp"
+
+
+// Cone vs sphere [closest distance from the sphere center to the cone surface]
+//   v          = center - apex
+//   along      = dot(v, direction)
+//   coneDist   = cos * |v x direction| - along * sin
+// The sphere misses when coneDist > radius, when it is behind the apex
+// or when it is further than the range
+#if !defined(__SSE2__)
+static bool sphereInCone(const LightVolume& light, glm::vec3 center, float radius)
+{
+  glm::vec3 v = center - light.mPosition;
+  float lengthSquared = glm::dot(v, v);
+  float along = glm::dot(v, light.mDirection);
+  float across = std::sqrt(std::fmax(lengthSquared - along * along, 0.0f));
+  float coneDistance = light.mCosOuter * across - along * light.mSinOuter;
+
+  float reach = light.mRange + radius;
+  return coneDistance <= radius && along >= -radius && lengthSquared <= reach * reach;
+}
+#endif
+
+
+void computeLightMasks(const LightVolume* lights,
+                       int lightCount,
+                       const std::vector<glm::vec3>& boundsMin,
+                       const std::vector<glm::vec3>& boundsMax,
+                       std::vector<GLuint>& masks,
+                       JobSystem* jobs)
+{
+  size_t count = boundsMin.size();
+  masks.assign(count, 0);
+
+  // spheres in SoA, padded to a multiple of 4 with spheres that never pass
+  size_t padded = (count + 3) & ~(size_t)3;
+  std::vector<float> centerX(padded, 1e30f), centerY(padded, 1e30f), centerZ(padded, 1e30f), radius(padded, 0.0f);
+
+  // 4 instances a quad, the quads are independent [each range writes its own masks]
+  auto quads = [&](uint32_t firstQuad, uint32_t lastQuad)
+  {
+    size_t first = firstQuad * (size_t)4, last = lastQuad * (size_t)4;
+    for (size_t i = first; i < std::min(last, count); i++)
+    {
+      glm::vec3 center = (boundsMin[i] + boundsMax[i]) * 0.5f;
+      centerX[i] = center.x;
+      centerY[i] = center.y;
+      centerZ[i] = center.z;
+      radius[i] = glm::length(boundsMax[i] - boundsMin[i]) * 0.5f;
+    }
+
+    for (int l = 0; l < lightCount && l < 32; l++)
+    {
+      const LightVolume& light = lights[l];
+      GLuint bit = 1u << l;
+
+#if defined(__SSE2__)
+      const __m128 apexX = _mm_set1_ps(light.mPosition.x);
+      const __m128 apexY = _mm_set1_ps(light.mPosition.y);
+      const __m128 apexZ = _mm_set1_ps(light.mPosition.z);
+      const __m128 dirX = _mm_set1_ps(light.mDirection.x);
+      const __m128 dirY = _mm_set1_ps(light.mDirection.y);
+      const __m128 dirZ = _mm_set1_ps(light.mDirection.z);
+      const __m128 cosOuter = _mm_set1_ps(light.mCosOuter);
+      const __m128 sinOuter = _mm_set1_ps(light.mSinOuter);
+      const __m128 range = _mm_set1_ps(light.mRange);
+      const __m128 zero = _mm_setzero_ps();
+
+      for (size_t i = first; i < last; i += 4)
+      {
+        __m128 r = _mm_loadu_ps(&radius[i]);
+        __m128 vx = _mm_sub_ps(_mm_loadu_ps(&centerX[i]), apexX);
+        __m128 vy = _mm_sub_ps(_mm_loadu_ps(&centerY[i]), apexY);
+        __m128 vz = _mm_sub_ps(_mm_loadu_ps(&centerZ[i]), apexZ);
+
+        __m128 lengthSquared = _mm_add_ps(_mm_mul_ps(vx, vx), _mm_add_ps(_mm_mul_ps(vy, vy), _mm_mul_ps(vz, vz)));
+        __m128 along = _mm_add_ps(_mm_mul_ps(vx, dirX), _mm_add_ps(_mm_mul_ps(vy, dirY), _mm_mul_ps(vz, dirZ)));
+        __m128 across = _mm_sqrt_ps(_mm_max_ps(_mm_sub_ps(lengthSquared, _mm_mul_ps(along, along)), zero));
+        __m128 coneDistance = _mm_sub_ps(_mm_mul_ps(cosOuter, across), _mm_mul_ps(along, sinOuter));
+        __m128 reach = _mm_add_ps(range, r);
+
+        __m128 inside = _mm_and_ps(_mm_cmple_ps(coneDistance, r),
+                        _mm_and_ps(_mm_cmpge_ps(along, _mm_sub_ps(zero, r)),
+                                   _mm_cmple_ps(lengthSquared, _mm_mul_ps(reach, reach))));
+
+        int lanes = _mm_movemask_ps(inside);
+        for (int k = 0; k < 4; k++)
+        {
+          if ((lanes & (1 << k)) && i + k < count) masks[i + k] |= bit;
+        }
+      }
+#else
+      for (size_t i = first; i < std::min(last, count); i++)
+      {
+        glm::vec3 center = glm::vec3(centerX[i], centerY[i], centerZ[i]);
+        if (sphereInCone(light, center, radius[i])) masks[i] |= bit;
+      }
+#endif
+    }
+  };
+
+  if (jobs) jobs->mParallelFor(padded / 4, 1024, quads);
+  else quads(0, padded / 4);
+}
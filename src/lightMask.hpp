@@ -0,0 +1,30 @@
+#ifndef LIGHT_MASK_HEADER
+#define LIGHT_MASK_HEADER
+
+#include "../glad/glad.h"
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+
+#include "jobSystem.hpp"
+
+// Everything the mask test needs from a Light [kept apart, so it runs without GL]
+struct LightVolume
+{
+  glm::vec3 mPosition;
+  glm::vec3 mDirection;   // normalized
+  float mCosOuter;        // outer cone half angle
+  float mSinOuter;
+  float mRange;           // attenuation is negligible past this
+};
+
+// Bit i of masks[n] is set when light i can reach the box of instance n
+// [sphere around the box against the spot cone and the range, 4 instances at a time,
+// split over the job system's threads when there is one]
+void computeLightMasks(const LightVolume* lights,
+                       int lightCount,
+                       const std::vector<glm::vec3>& boundsMin,
+                       const std::vector<glm::vec3>& boundsMax,
+                       std::vector<GLuint>& masks,
+                       JobSystem* jobs = nullptr);
+#endif
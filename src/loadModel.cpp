@@ -7,6 +7,8 @@
 #include "../glm/ext/vector_float3.hpp"
 #include "../glm/geometric.hpp"
 
+#include "assetArchive.hpp"
+
 
 bool loadObj(const char* path,
             std::vector<float> &outVertices,
@@ -15,7 +17,11 @@ bool loadObj(const char* path,
             std::vector<float> &outTangents,
             std::vector<float> &outBitangents)
 {
-  FILE* fp = fopen(path, "r");
+  // archive or loose file, fmemopen keeps the fscanf parsing below as it was
+  std::vector<unsigned char> scratch;
+  size_t size = 0;
+  const unsigned char* text = gAssets.mLoad(path, &size, scratch);
+  FILE* fp = text ? fmemopen((void*)text, size, "r") : NULL;
   if (fp == NULL)
   {
     printf("Can't even open the file\n");
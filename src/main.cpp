@@ -1,12 +1,22 @@
 /*
   TO RUN:                 1.  g++ src/*.cpp glad/glad.c -o prog -I./glad/ -lGL -lglfw -ldl [from parent directory]
                           2.  ./prog
+                          [-DTRACK_ALLOCATIONS counts every new per startup phase / frame, allocTracker.hpp]
+
+  SCALING RUNS:           ./prog --floors 10 --rooms 20 [--jitter 0.1 --jitter-rotate 5 --seed 7]
+                          ./prog --benchmark 600 [times 600 frames on a fixed camera path, then quits]
+                          ./prog --dynamic-res 1 --gpu-budget-ms 8 [scene resolution follows the GPU time]
 
 
   TO NAVIGATE:            WASD           -> in XZ axis
                           Top Down arrow -> Y axis
                           Mouse
                           Press "C" to toggle bw phong and gouroud shading
+                          Press "O" to toggle occlusion culling
+                          Press "H" to toggle Hi-Z occlusion culling
+                          Press "P" to toggle portal [room] visibility
+                          Press "B" to toggle debug lines, "I" the counters overlay, "J" writes counters.json
+                          Press "M" to print the GPU / CPU memory report
 
 
   TO UNDERSTAND THE CODE: Start from main function [at very bottom]               
@@ -31,6 +41,11 @@
 #include <fstream>
 #include <cstring>
 #include <cstdio>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <mutex>
 
 // My libraries
 #include "app.hpp"
@@ -40,6 +55,16 @@
 #include "shader.hpp"
 #include "shadowMap.hpp"
 #include "light.hpp"
+#include "meshlet.hpp"
+#include "frustum.hpp"
+#include "occlusionCuller.hpp"
+#include "lightMask.hpp"
+#include "textureCache.hpp"
+#include "assetArchive.hpp"
+#include "sceneFile.hpp"
+#include "counters.hpp"
+#include "memoryRegistry.hpp"
+#include "allocTracker.hpp"
 
 
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ GLOBALS ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -84,6 +109,34 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     case GLFW_KEY_C:
       gApp.mIsPhong = !gApp.mIsPhong;
       break;
+
+    case GLFW_KEY_O:
+      if (action == GLFW_PRESS) gApp.mOcclusionCulling = !gApp.mOcclusionCulling;
+      break;
+
+    case GLFW_KEY_H:
+      if (action == GLFW_PRESS) gApp.mHiZCulling = !gApp.mHiZCulling;
+      break;
+
+    case GLFW_KEY_P:
+      if (action == GLFW_PRESS) gApp.mPortalCulling = !gApp.mPortalCulling;
+      break;
+
+    case GLFW_KEY_B:
+      if (action == GLFW_PRESS) gApp.mDebugDraw.mEnabled = !gApp.mDebugDraw.mEnabled;
+      break;
+
+    case GLFW_KEY_I:
+      if (action == GLFW_PRESS) gApp.mOverlay = !gApp.mOverlay;
+      break;
+
+    case GLFW_KEY_J:
+      if (action == GLFW_PRESS) gApp.mDumpCounters = true;
+      break;
+
+    case GLFW_KEY_M:
+      if (action == GLFW_PRESS) gApp.mPrintMemory = true;
+      break;
   }
 }
 
@@ -91,17 +144,27 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
 // Handle mouse inputs
 void cursorPosition_callback(GLFWwindow* window, double xPos, double yPos)
 {
+  if (gApp.mBenchmark.mActive()) return; // the path drives the camera
   gApp.mCamera.mouseLook(xPos, yPos);
 }
 
 
+// Exposed / restored while idle, the last frame has to be shown again
+void refresh_callback(GLFWwindow*)
+{
+  gApp.mNeedsPresent = true;
+}
+
+
 // Getting things ready
 void initialization(App* app) 
 { 
+  AllocScope scope("startup: window");
   if (!glfwInit()) return;
   
-  // anti-anliasing
-  glfwWindowHint(GLFW_SAMPLES, 8);
+  // anti-anliasing is done in the offscreen scene target [RenderTarget]
+  // the window has to be single sampled for the blit into it
+  glfwWindowHint(GLFW_SAMPLES, 0);
 
   app->mWindow = glfwCreateWindow(app->mScreenWidth, app->mScreenHeight, app->mTitle, NULL, NULL);
 
@@ -119,11 +182,16 @@ void initialization(App* app)
   }
 
   glEnable(GL_MULTISAMPLE);
+  if (app->mBenchmark.mActive()) glfwSwapInterval(0); // frame times, not the refresh rate
+
+  // textures decode + upload on their own thread [falls back to synchronous loads]
+  if (app->mTextureStreamer.mStart(app->mWindow)) app->mTextureCache.mSetStreamer(&app->mTextureStreamer);
 
   glfwSetKeyCallback(app->mWindow, key_callback); 
   glfwSetInputMode(app->mWindow, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
   
   glfwSetCursorPosCallback(app->mWindow, cursorPosition_callback);
+  glfwSetWindowRefreshCallback(app->mWindow, refresh_callback);
 }
 
 
@@ -162,12 +230,7 @@ void initializeGrid()
     }
   }
 
-  glGenVertexArrays(1, &gGrid.mVertexArrayObject);
-
-  glGenBuffers(1, &gGrid.mVertexBufferObjectH);
-  glGenBuffers(1, &gGrid.mVertexBufferObjectV);
-  // we will fill the buffers in `DisplayGrid` function
-  // as we are using 2 position vbo's for convinence
+  // drawn as debug lines [DebugOverlay]
 }
 
 
@@ -186,152 +249,41 @@ bool meshCreate(const char* path, Mesh3D* mesh)
     return false;
   }
 
-  mesh->mVertexData = vertexData;
-  mesh->mUvData = uvData;
-  mesh->mNormalData = normalData;
-  mesh->mTangentData = tangentData;
-  mesh->mBitangentData = bitangentData;
+  mesh->mVertexData.assign(vertexData.begin(), vertexData.end());
+  mesh->mUvData.assign(uvData.begin(), uvData.end());
+  mesh->mNormalData.assign(normalData.begin(), normalData.end());
+  mesh->mTangentData.assign(tangentData.begin(), tangentData.end());
+  mesh->mBitangentData.assign(bitangentData.begin(), bitangentData.end());
+
+  buildIndexedMesh(mesh);   // weld duplicate vertices, gives us mIndexData
+  buildMeshlets(mesh);      // only splits the high poly ones
+
+  for (size_t i = 0; i < mesh->mVertexData.size(); i += 3)
+  {
+    glm::vec3 p = glm::vec3(mesh->mVertexData[i], mesh->mVertexData[i + 1], mesh->mVertexData[i + 2]);
+    mesh->mBoundsMin = i == 0 ? p : glm::min(mesh->mBoundsMin, p);
+    mesh->mBoundsMax = i == 0 ? p : glm::max(mesh->mBoundsMax, p);
+  }
 
   return true;
 }
 
 
-// Load texture
+// Load texture [shared with every other mesh using the same image]
 bool loadTexture(const char* path, Mesh3D* mesh)
 {
-  glGenTextures(1, &mesh->mTextureObject);
-  glBindTexture(GL_TEXTURE_2D, mesh->mTextureObject);
+  mesh->mTextureObject = gApp.mTextureCache.mAcquire(path);
 
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-
-  stbi_set_flip_vertically_on_load(true); // This line fixed a bug which was so annoying  
-
-  int width, height, nChannels;
-  unsigned char* data = stbi_load(path, &width, &height, &nChannels, 0);
-  
-
-  if (data)
-  {
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-  }
-  else
+  if (mesh->mTextureObject == 0)
   {
     std::cout << "Failed to load texture, for mesh: " << mesh->name << std::endl;
     return false;
   }
 
-  glBindTexture(GL_TEXTURE_2D, 0);
-  stbi_image_free(data);
-
   return true;
 }
 
 
-// Sets up mesh data transfer from CPU to GPU 
-void meshCTGdataTransfer(Mesh3D* mesh) 
-{
-  glGenVertexArrays(1, &mesh->mVertexArrayObject);
-  glBindVertexArray(mesh->mVertexArrayObject);
-
-  // 1. start generating our position VBO
-  glGenBuffers(1, &mesh->mPositionVertexBufferObject);
-  glBindBuffer(GL_ARRAY_BUFFER, mesh->mPositionVertexBufferObject);
-  glBufferData(GL_ARRAY_BUFFER,
-              mesh->mVertexData.size() * sizeof(float),
-              mesh->mVertexData.data(),
-              GL_STATIC_DRAW);
-
-
-  //    Linking the position attrib in VAO
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0, 
-                        3,
-                        GL_FLOAT,
-                        false,
-                        0, 
-                        (void*)0);
-
-  // 2. start generating our uv VBO
-  glGenBuffers(1, &mesh->mUvVertexBufferObject);
-  glBindBuffer(GL_ARRAY_BUFFER, mesh->mUvVertexBufferObject);
-  glBufferData(GL_ARRAY_BUFFER,
-              mesh->mUvData.size() * sizeof(float),
-              mesh->mUvData.data(),
-              GL_STATIC_DRAW);
-
-  //    Linking the uv attrib in VAO
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(1,
-                        2,
-                        GL_FLOAT,
-                        false,
-                        0,
-                        (void*)0);
-
-  // 3. start generating our normals VBO
-  glGenBuffers(1, &mesh->mNormalVertexBufferObject);
-  glBindBuffer(GL_ARRAY_BUFFER, mesh->mNormalVertexBufferObject);
-  glBufferData(GL_ARRAY_BUFFER,
-              mesh->mNormalData.size() * sizeof(float),
-              mesh->mNormalData.data(),
-              GL_STATIC_DRAW);
-
-  //    Linking the normal attrib in VAO
-  glEnableVertexAttribArray(2);
-  glVertexAttribPointer(2,
-                        3,
-                        GL_FLOAT,
-                        false,
-                        0,
-                        (void*)0);
-
-  // 4. start generating our tangents VBO
-  glGenBuffers(1, &mesh->mTangentVertexBufferObject);
-  glBindBuffer(GL_ARRAY_BUFFER, mesh->mTangentVertexBufferObject);
-  glBufferData(GL_ARRAY_BUFFER,
-              mesh->mTangentData.size() * sizeof(float),
-              mesh->mTangentData.data(),
-              GL_STATIC_DRAW);
-
-  //    Linking the normal attrib in VAO
-  glEnableVertexAttribArray(3);
-  glVertexAttribPointer(3,
-                        3,
-                        GL_FLOAT,
-                        false,
-                        0,
-                        (void*)0);
-
-  // 5. start generating our bitangents VBO
-  glGenBuffers(1, &mesh->mBitangentVertexBufferObject);
-  glBindBuffer(GL_ARRAY_BUFFER, mesh->mBitangentVertexBufferObject);
-  glBufferData(GL_ARRAY_BUFFER,
-              mesh->mBitangentData.size() * sizeof(float),
-              mesh->mBitangentData.data(),
-              GL_STATIC_DRAW);
-
-  //    Linking the normal attrib in VAO
-  glEnableVertexAttribArray(4);
-  glVertexAttribPointer(4,
-                        3,
-                        GL_FLOAT,
-                        false,
-                        0,
-                        (void*)0);
-
-  glBindVertexArray(0);
-  glDisableVertexAttribArray(0); 
-  glDisableVertexAttribArray(1);
-  glDisableVertexAttribArray(2);
-  glDisableVertexAttribArray(3);
-  glDisableVertexAttribArray(4);
-}
-
-
 void Input(App* app)
 {
   if(glfwGetKey(app->mWindow, GLFW_KEY_ESCAPE) == GLFW_PRESS)
@@ -339,60 +291,13 @@ void Input(App* app)
 }
 
 
-void DisplayGrid(App* app)
-{
-  // Local to world
-  GLint location = glGetUniformLocation(app->mGraphicsPipelineShaderProgram, "u_model");
-  glm::mat4 model = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.0f));
-  glUniformMatrix4fv(location, 1, GL_FALSE, &model[0][0]);
-
-  glBindVertexArray(gGrid.mVertexArrayObject);
-
-  // 1 -> Drawing horizontal lines
-  glBindBuffer(GL_ARRAY_BUFFER, gGrid.mVertexBufferObjectH);
-  glBufferData(GL_ARRAY_BUFFER,
-               gGrid.mVertexDataH.size() * sizeof(glm::vec3),
-               gGrid.mVertexDataH.data(),
-               GL_STATIC_DRAW);
-
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0,
-                        3,
-                        GL_FLOAT,
-                        false,
-                        0,
-                        (void*)0);
-
-  glDrawArrays(GL_LINES, 0, gGrid.mVertexDataH.size());
-
-  // 2 -> Drawing vertical lines
-  glBindBuffer(GL_ARRAY_BUFFER, gGrid.mVertexBufferObjectV);
-  glBufferData(GL_ARRAY_BUFFER,
-               gGrid.mVertexDataV.size() * sizeof(glm::vec3),
-               gGrid.mVertexDataV.data(),
-               GL_STATIC_DRAW);
-
-  glEnableVertexAttribArray(0);
-  glVertexAttribPointer(0,
-                        3,
-                        GL_FLOAT,
-                        false,
-                        0,
-                        (void*)0);
-
-  glDrawArrays(GL_LINES, 0, gGrid.mVertexDataV.size());
-
-  glBindVertexArray(0);
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
-  glDisableVertexAttribArray(0);
-}
-
-
 void LightInformation(App* app, GLuint graphicsPipeline)
 {
-  // LightPosition
-  GLint location = glGetUniformLocation(graphicsPipeline, "u_lightPos");
-  glUniform3f(location, app->mRefLightPos.x, app->mRefLightPos.y, app->mRefLightPos.z);
+  // LightPositions [the rest of the 9 are masked out]
+  glm::vec3 positions[9] = {};
+  for (int i = 0; i < app->mLightsNumber; i++) positions[i] = app->mLights[i].mPosition;
+  GLint location = glGetUniformLocation(graphicsPipeline, "u_lightPositions");
+  glUniform3fv(location, 9, glm::value_ptr(positions[0]));
 
   // LightColor
   location = glGetUniformLocation(graphicsPipeline, "u_lightColor");
@@ -449,606 +354,730 @@ void PreDraw(App* app)
   glEnable(GL_DEPTH_TEST);
   glCullFace(GL_BACK);
 
-  glViewport(0, 0, app->mScreenWidth, app->mScreenHeight);
+  app->mSceneTarget.mBind();
   glClearColor(0.94f, 0.65f, 0.4f, 1.f);
   glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT );
 }
 
 
-void MeshTransformation(App* app, Mesh3D* mesh, GLuint graphicsPipeline)
+// Per program, once a frame. Per object data [model matrix, color] lives in the instance SSBO
+// The camera is the packet's, the simulation thread may already be moving it
+void CameraInformation(GLuint graphicsPipeline, const RenderPacket& packet)
 {
-  // Local to world
-  GLint location = glGetUniformLocation(graphicsPipeline, "u_model");
-  glm::mat4 model = glm::translate(glm::mat4(1.0f), mesh->mOffset);
-  model = glm::rotate(model, glm::radians(mesh->mRotate), glm::vec3(0.0f, 1.0f, 0.0f));
-  model = glm::scale(model, mesh->mScale);
-  glUniformMatrix4fv(location, 1, GL_FALSE, &model[0][0]);
-
-
   // World to camera
-  location = glGetUniformLocation(graphicsPipeline, "u_view");
-  glm::mat4 cameraSpace = app->mCamera.getViewMatrix(); 
-  glUniformMatrix4fv(location, 1, GL_FALSE, &cameraSpace[0][0]);    
+  GLint location = glGetUniformLocation(graphicsPipeline, "u_view");
+  glUniformMatrix4fv(location, 1, GL_FALSE, &packet.mView[0][0]);    
 
 
   // Real screen view
   location = glGetUniformLocation(graphicsPipeline, "u_projection");
-  glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)app->mScreenWidth/app->mScreenHeight, 0.1f, 100.0f);
-  glUniformMatrix4fv(location, 1, GL_FALSE, &projection[0][0]);
+  glUniformMatrix4fv(location, 1, GL_FALSE, &packet.mProjection[0][0]);
 
 
   // ViewPosition
   location = glGetUniformLocation(graphicsPipeline, "u_viewPos");
-  glm::vec3 viewPos = app->mCamera.getViewPos();
-  glUniform3f(location, viewPos.x, viewPos.y, viewPos.z);
+  glUniform3f(location, packet.mViewPos.x, packet.mViewPos.y, packet.mViewPos.z);
 
 
   // toggleShading
   location = glGetUniformLocation(graphicsPipeline, "u_isPhong");
-  glUniform1i(location, app->mIsPhong);
+  glUniform1i(location, packet.mIsPhong);
 
-  // color
-  location = glGetUniformLocation(graphicsPipeline, "u_color");
-  glUniform3f(location, mesh->mColor.x, mesh->mColor.y, mesh->mColor.z);
+  // lights of the rooms the camera can see into
+  location = glGetUniformLocation(graphicsPipeline, "u_activeLights");
+  glUniform1ui(location, packet.mActiveLights);
 }
 
 
-void Draw(Mesh3D* mesh, App* app) 
+// Every bucket of this program in one glMultiDrawElementsIndirect each
+void Draw(App* app, GLuint graphicsPipeline, const RenderPacket& packet, bool disoccluded) 
 {
-  for (int i = 0; i < app->mLightsNumber; i++)
-  {
-    glActiveTexture(GL_TEXTURE0 + i);
-    glBindTexture(GL_TEXTURE_2D, app->mLights[i].mShadowMap.mTextureObject);    
-  }
-
-  glActiveTexture(GL_TEXTURE0 + app->mLightsNumber);
-  glBindTexture(GL_TEXTURE_2D, mesh->mTextureObject);
-  glBindVertexArray(mesh->mVertexArrayObject);
-  glDrawArrays(GL_TRIANGLES, 0, mesh->mVertexData.size() / 3);
+  glUseProgram(graphicsPipeline);
+  Counters::mAdd(CounterProgramBinds);
+  CameraInformation(graphicsPipeline, packet);
+  app->mScene.mDraw(graphicsPipeline, disoccluded);
 }
 
 
-void mainLoop(App* app) 
+void DrawScene(App* app, const RenderPacket& packet, bool disoccluded = false)
 {
-  glUseProgram(app->mGraphicsPipelineShaderProgram);
-  LightInformation(app, app->mGraphicsPipelineShaderProgram);
+  // for simple meshes 
+  Draw(app, app->mGraphicsPipelineShaderProgram, packet, disoccluded);
 
-  glUseProgram(app->mNormalsGraphicsPipelineShaderProgram);
-  LightInformation(app, app->mNormalsGraphicsPipelineShaderProgram);
+  // for normal meshes [walls and ceilings]
+  Draw(app, app->mNormalsGraphicsPipelineShaderProgram, packet, disoccluded);
 
-  glUseProgram(app->mCeilingLightGraphicsPipelineShaderProgram);
-  LightInformation(app, app->mCeilingLightGraphicsPipelineShaderProgram);
-  while (!glfwWindowShouldClose(app->mWindow))
+  // for Ceiling lights meshes
+  Draw(app, app->mCeilingLightGraphicsPipelineShaderProgram, packet, disoccluded);
+}
+
+
+// Rooms reachable through the portals, occluders into the small CPU depth buffer, then
+// every instance against both [either can be off]
+// The result goes to the GPU as one flag per instance [the packet's], read by the cull shader
+// The depth buffer is drawn in bands and the instances tested in ranges on the job system
+void OcclusionCulling(App* app, RenderPacket* packet)
+{
+  auto start = std::chrono::steady_clock::now();
+  const glm::mat4& projectionView = packet->mProjectionView;
+  GpuScene& scene = app->mScene;
+  JobSystem& jobs = app->mJobs;
+  OcclusionCuller& culler = app->mOcclusionCuller;
+  PortalVisibility& portals = app->mPortals;
+  bool occlusion = app->mOcclusionCulling;
+  bool rooms = app->mPortalCulling && portals.mHasCells();
+
+  // rooms the camera can see into, through doors and windows
+  if (rooms)
   {
-    // get fps
-    float currentTime = glfwGetTime();
-    app->mDeltaTime = currentTime - app->mLastFrame;
-    app->mLastFrame = currentTime;
-  
-    Input(app);
-    PreDraw(app);
-    // DisplayGrid(app);
+    portals.mUpdate(projectionView, packet->mViewPos);
 
-    // 1. for simple meshes 
-    GLuint currentGraphicsPipeline = app->mGraphicsPipelineShaderProgram;
-    glUseProgram(currentGraphicsPipeline);
+    glm::vec3 positions[9];
+    for (int i = 0; i < app->mLightsNumber; i++) positions[i] = app->mLights[i].mPosition;
+    packet->mActiveLights = portals.mLightMask(positions, app->mLightsNumber);
+  }
+  else packet->mActiveLights = 0xFFFFFFFF;
+  app->mStats.mVisibleCells = rooms ? portals.mVisitedCells : 0;
 
+  if (occlusion)
+  {
+    culler.mBeginFrame(projectionView);
 
-    for (auto& pair : gApp.meshes)
+    // a band is two tile rows, every band sees every occluder but only writes its rows
+    const int bandRows = 2 * OcclusionCuller::mTileSize;
+    const int bands = OcclusionCuller::mHeight / bandRows;
+    jobs.mParallelFor(bands, 1, [&](uint32_t first, uint32_t last)
     {
-      Mesh3D& mesh = pair.second;
-      if (mesh.mGraphicsPipeline != 0) continue;
-      MeshTransformation(app, &mesh, currentGraphicsPipeline);
-      Draw(&mesh, app);
-    }
-
-    // 2. for normal meshes [walls and ceilings]
-    currentGraphicsPipeline = app->mNormalsGraphicsPipelineShaderProgram;
-    glUseProgram(currentGraphicsPipeline);
-    // LightInformation(app, currentGraphicsPipeline);
+      for (uint32_t band = first; band < last; band++)
+      {
+        for (const OccluderProxy& occluder : scene.mOccluders)
+        {
+          culler.mRenderOccluder(occluder.mModel, occluder.mMin, occluder.mMax, band * bandRows, (band + 1) * bandRows);
+        }
+        culler.mFinalize(band * 2, band * 2 + 2);
+      }
+    });
+  }
 
-    for (auto& pair : gApp.meshes)
+  std::vector<GLuint>& visibility = packet->mVisibility;
+  visibility.resize(scene.mInstanceBoundsMin.size());
+  jobs.mParallelFor(scene.mInstanceBoundsMin.size(), 2048, [&](uint32_t first, uint32_t last)
+  {
+    int tested = 0, occluded = 0, drawn = 0;
+    for (uint32_t i = first; i < last; i++)
     {
-      Mesh3D& mesh = pair.second;
-      if (mesh.isLight || mesh.mGraphicsPipeline == 0) continue;
-      MeshTransformation(app, &mesh, currentGraphicsPipeline);
-      Draw(&mesh, app);
+      bool visible = !rooms || portals.mIsInstanceVisible(i);
+      if (visible && occlusion)
+      {
+        tested++;
+        visible = culler.mIsVisible(scene.mInstanceBoundsMin[i], scene.mInstanceBoundsMax[i]);
+        if (!visible) occluded++;
+      }
+      visibility[i] = visible ? 1 : 0;
+      drawn += visible ? 1 : 0;
     }
+    culler.mTestedObjects += tested;
+    culler.mOccludedObjects += occluded;
+    Counters::mAdd(CounterInstancesSubmitted, drawn); // this thread's block
+    Counters::mAdd(CounterInstancesCulled, (last - first) - drawn);
+  });
+  app->mStats.mCpuCullMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  app->mStats.mOcclusionRatio = occlusion ? culler.mGetOcclusionRatio() : 0.0f;
+}
 
-    // 3. for Ceiling lights meshes
-    currentGraphicsPipeline = app->mCeilingLightGraphicsPipelineShaderProgram;
-    glUseProgram(currentGraphicsPipeline);
-    // LightInformation(app, currentGraphicsPipeline);
 
-    for (auto& pair : gApp.meshes)
-    {
-      Mesh3D& mesh = pair.second;
-      if ((!mesh.isLight && mesh.mGraphicsPipeline != 0) 
-           || mesh.mGraphicsPipeline == 0) continue;
-      MeshTransformation(app, &mesh, currentGraphicsPipeline);
-      Draw(&mesh, app);
-    }
+// Only when something moved, the masks live in the instance SSBO until then
+void UpdateLightMasks(App* app, RenderPacket* packet)
+{
+  packet->mLightMasks.clear();
+  if (!app->mLightsDirty && !app->mScene.mLightMasksDirty) return;
 
-    // Update the screen
-    glfwPollEvents(); 
-    glfwSwapBuffers(app->mWindow);
-  }
+  LightVolume volumes[32];
+  int count = std::min(app->mLightsNumber, 32);
+  for (int i = 0; i < count; i++) volumes[i] = app->mLights[i].mGetVolume();
+
+  app->mScene.mComputeLightMasks(volumes, count, packet->mLightMasks);
+  app->mLightsDirty = false;
 }
 
 
-void cleanUp() 
+// Textures the scene moved into array layers, the store and the cache switch over to them
+void AdoptTextureMoves(App* app)
 {
-  glfwTerminate();
-  return;
+  std::vector<TextureSwap>& moves = app->mScene.mTextureMoves;
+  for (const TextureSwap& move : moves) app->mStore.mReplaceTexture(move.mOld, move.mNew);
+  app->mTextureCache.mAdoptMoves(moves);
+  moves.clear();
 }
 
 
-void ObjectCreation(const char* name,
-                    glm::vec3 scale,
-                    glm::vec3 offset,
-                    GLfloat rotate,
-                    const char* modelPath,
-                    const char* texturePath = "",
-                    GLuint graphicsPipeline = 0,
-                    glm::vec3 color = glm::vec3(0.0),
-                    bool isLight = false)
+// Textures the upload thread finished since the last frame, placeholders get swapped out
+void FinishTextureUploads(App* app)
 {
-  Mesh3D mesh;
-  
-  mesh.name = name; 
-  mesh.mScale = scale;
-  mesh.mOffset = offset;
-  mesh.mRotate = rotate;
-  mesh.mModelPath = modelPath;
-  mesh.mTexturePath = texturePath;
-  mesh.mGraphicsPipeline = graphicsPipeline;
-  mesh.mColor = color;
-  mesh.isLight = isLight;
-
-  //meshes.push_back(mesh);
-  gApp.meshes[name] = mesh;
+  std::vector<TextureSwap>& swaps = app->mTextureSwaps;
+  swaps.clear();
+  app->mTextureCache.mFinishUploads(swaps);
+  if (swaps.empty()) return;
+
+  for (const TextureSwap& swap : swaps)
+  {
+    app->mScene.mReplaceTexture(swap.mOld, swap.mNew);
+    app->mStore.mReplaceTexture(swap.mOld, swap.mNew);
+  }
+  app->mTextureCache.mDeletePlaceholders(swaps);
+
+  bool uploadsDone = app->mTextureCache.mPendingUploads() == 0;
+  app->mScene.mRefreshTextures(uploadsDone);
+  AdoptTextureMoves(app);
+  if (uploadsDone) app->mTextureCache.mPrintReport();
 }
 
 
-void ObjectFilling()
+// Simulation side counters are ours, the render side ones are copied under the lock
+FrameStats CurrentStats(App* app)
 {
-  for (auto& pair : gApp.meshes) {
-    Mesh3D& mesh = pair.second;
-    if(!meshCreate(mesh.mModelPath, &mesh))       // Loading position, UV, normals for vertices
-    {
-      std::cout << "Failed to load model for " << mesh.name << std::endl;
-    };
+  FrameStats stats = app->mStats;
+  std::lock_guard<std::mutex> lock(app->mStatsMutex);
+  stats.mSubmittedTriangles = app->mRenderStats.mSubmittedTriangles;
+  stats.mCulledTriangles = app->mRenderStats.mCulledTriangles;
+  stats.mHiZOccludedClusters = app->mRenderStats.mHiZOccludedClusters;
+  stats.mHiZRecoveredClusters = app->mRenderStats.mHiZRecoveredClusters;
+  stats.mCullMs = app->mRenderStats.mCullMs;
+  stats.mHiZMs = app->mRenderStats.mHiZMs;
+  stats.mInputLatencyMs = app->mRenderStats.mInputLatencyMs;
+  stats.mGpuFrameMs = app->mRenderStats.mGpuFrameMs;
+  stats.mRenderScale = app->mRenderStats.mRenderScale;
+  stats.mLightsPerInstance = app->mRenderStats.mLightsPerInstance;
+  for (int id = 0; id < CounterIdCount; id++) stats.mCounters[id] = app->mRenderStats.mCounters[id];
+  return stats;
+}
 
-    if(strcmp(mesh.mTexturePath, "") != 0)
-    {
-      if (!loadTexture(mesh.mTexturePath, &mesh)) // Loading texture for object [if avaliable] 
-      {
-        std::cout << "Failed to load texture for " << mesh.name << std::endl;
-      }
-    } 
-    else std::cout << "No texture allocated for " << mesh.name << std::endl;
 
-    meshCTGdataTransfer(&mesh);
-  }
+// J: the last frame's counters to counters.json
+void DumpCounters(App* app)
+{
+  FrameStats stats = CurrentStats(app);
+  double values[CounterIdCount];
+  for (int id = 0; id < CounterIdCount; id++) values[id] = (double)stats.mCounters[id];
+  Counters::mWriteJson("counters.json", values);
 }
 
 
-void BenchPlacement()
+void UpdateStats(App* app)
 {
-  Mesh3D refBench = gApp.meshes.at("Bench");
-  gApp.meshes.erase("Bench");
+  float currentTime = glfwGetTime();
+  if (currentTime - app->mStatsLastPrint < 1.0f) return;
+  app->mStatsLastPrint = currentTime;
+
+  FrameStats stats = CurrentStats(app);
+  char title[400];
+  snprintf(title, sizeof(title), "%s | %.1f ms%s | input %.1f ms | gpu %.1f ms at %.0f%% | triangles: %ld | culled: %ld | rooms: %d/%d | lights %.1f/instance | occluded: %.0f%% | hi-z: %ld clusters, %ld back | cull %.2f ms, hi-z %.2f ms, cpu %.2f ms [%d threads]",
+           app->mTitle,
+           app->mDeltaTime * 1000.0f,
+           app->mIdle.mIdle() ? " [idle]" : "",
+           stats.mInputLatencyMs,
+           stats.mGpuFrameMs,
+           stats.mRenderScale * 100.0f,
+           stats.mSubmittedTriangles,
+           stats.mCulledTriangles,
+           stats.mVisibleCells,
+           app->mPortals.mCellCount(),
+           stats.mLightsPerInstance,
+           app->mOcclusionCulling ? stats.mOcclusionRatio * 100.0f : 0.0f,
+           stats.mHiZOccludedClusters,
+           stats.mHiZRecoveredClusters,
+           stats.mCullMs,
+           stats.mHiZMs,
+           stats.mCpuCullMs,
+           app->mJobs.mThreadCount());
+  glfwSetWindowTitle(app->mWindow, title);
+}
+
+
+// ~~~~~~~ Simulation thread [main]: input, camera, CPU culling -> one packet a frame ~~~~~~~
+
+// B: the ceiling grid, every light [position, shadow frustum and cone], and the boxes of the instances
+// near the camera [green drawn, red culled on the CPU, grey when CPU culling is off]
+void DebugOverlay(App* app, RenderPacket* packet)
+{
+  DebugDraw& debug = app->mDebugDraw;
+
+  uint32_t gridColor = DebugDraw::mRgba(0.2f, 0.2f, 0.2f);
+  for (size_t i = 0; i + 1 < gGrid.mVertexDataH.size(); i += 2) debug.mLine(gGrid.mVertexDataH[i], gGrid.mVertexDataH[i + 1], gridColor);
+  for (size_t i = 0; i + 1 < gGrid.mVertexDataV.size(); i += 2) debug.mLine(gGrid.mVertexDataV[i], gGrid.mVertexDataV[i + 1], gridColor);
 
-  float distbwBenchRow = 1.57f;
-  float distbwBenchCol = 3.25f;
+  for (int i = 0; i < app->mLightsNumber; i++)
+  {
+    debug.mFrustum(app->mLightProjectionViewMatrixCombined[i], DebugDraw::mRgba(1.0f, 1.0f, 0.3f));
 
-  float refX = refBench.mOffset.x;
-  float refY = refBench.mOffset.y;
-  float refZ = refBench.mOffset.z;
+    LightVolume volume = app->mLights[i].mGetVolume();
+    debug.mSphere(volume.mPosition, 0.15f, DebugDraw::mRgba(1.0f, 1.0f, 1.0f));
+    float radius = volume.mRange * volume.mSinOuter / std::max(volume.mCosOuter, 0.01f);
+    debug.mCone(volume.mPosition, volume.mDirection, volume.mRange, radius, DebugDraw::mRgba(1.0f, 0.5f, 0.1f));
+  }
 
-  for (int i = 0; i < 25; i++)
+  const GpuScene& scene = app->mScene;
+  const float range = 12.0f;
+  uint32_t drawn = DebugDraw::mRgba(0.2f, 1.0f, 0.2f), culled = DebugDraw::mRgba(1.0f, 0.2f, 0.2f), unknown = DebugDraw::mRgba(0.6f, 0.6f, 0.6f);
+  bool flags = packet->mInstanceFlags && packet->mVisibility.size() == scene.mInstanceBoundsMin.size();
+  for (size_t i = 0; i < scene.mInstanceBoundsMin.size(); i++)
   {
-    // exceptions !! 
-    if (i == 0 || i == 5) continue; // these benches are no there in class
-    if (i / 5 == 2) // Column 2 and column 3 have less spacing then other
-      refX = 0.7f;
-
-    float newX = refX - (distbwBenchCol * (i / 5));
-    float newY = refY;
-    float newZ = refZ - (distbwBenchRow * (i % 5));
-    
-    refBench.mOffset = glm::vec3(newX, newY, newZ);
-    gApp.meshes["Bench " + std::to_string(i)] = refBench;
+    glm::vec3 center = (scene.mInstanceBoundsMin[i] + scene.mInstanceBoundsMax[i]) * 0.5f;
+    if (glm::length(center - packet->mViewPos) > range) continue;
+    debug.mAabb(scene.mInstanceBoundsMin[i], scene.mInstanceBoundsMax[i], !flags ? unknown : packet->mVisibility[i] ? drawn : culled);
   }
 }
 
 
-void LightPlacement()
+glm::mat4 ProjectionMatrix(App* app)
+{
+  return glm::perspective(glm::radians(45.0f), (float)app->mScreenWidth/app->mScreenHeight, 0.1f, 100.0f);
+}
+
+
+// Would this frame look any different from the last one [camera, switches, anything dirty
+// or still streaming]. The overlay prints times, it's never the same
+bool FrameChanged(App* app)
+{
+  FrameInputs inputs;
+  inputs.mView = app->mCamera.getViewMatrix();
+  inputs.mProjection = ProjectionMatrix(app);
+  inputs.mSwitches = (app->mIsPhong ? 1 : 0) | (app->mMeshletConeCulling ? 2 : 0) | (app->mOcclusionCulling ? 4 : 0) |
+                     (app->mPortalCulling ? 8 : 0) | (app->mHiZCulling ? 16 : 0) | (app->mDebugDraw.mEnabled ? 32 : 0);
+
+  bool changed = !(inputs == app->mLastInputs) || app->mOverlay || app->mBenchmark.mActive() ||
+                 app->mLightsDirty || app->mScene.mLightMasksDirty || app->mScene.mTransformsDirty() ||
+                 app->mTextureCache.mPendingUploads() > 0;
+  app->mLastInputs = inputs;
+  return changed;
+}
+
+
+void BuildPacket(App* app, RenderPacket* packet, std::chrono::steady_clock::time_point inputTime)
 {
-  Mesh3D refLight = gApp.meshes.at("Light"); 
+  packet->mFrame = app->mFrame++;
+  packet->mQuit = false;
+  packet->mPresentOnly = false;
+  packet->mInputTime = inputTime;
+
+  packet->mView = app->mCamera.getViewMatrix();
+  packet->mProjection = ProjectionMatrix(app);
+  packet->mProjectionView = packet->mProjection * packet->mView;
+  packet->mViewPos = app->mCamera.getViewPos();
+
+  packet->mIsPhong = app->mIsPhong;
+  packet->mConeCulling = app->mMeshletConeCulling;
+  packet->mHiZCulling = app->mHiZCulling;
+  packet->mOverlay = app->mOverlay;
+  packet->mFrameMs = app->mDeltaTime * 1000.0f;
+  packet->mInstanceFlags = app->mOcclusionCulling || app->mPortalCulling; // both go through the same per instance flags
+
+  // moved instances only, before anything reads their boxes
+  if (!app->mScene.mUpdateTransforms(packet->mMoved, packet->mMovedModels, packet->mMovedNormals)) packet->mMoved.clear();
+  UpdateLightMasks(app, packet);
+
+  if (packet->mInstanceFlags) OcclusionCulling(app, packet);
+  else
+  {
+    packet->mActiveLights = 0xFFFFFFFF;
+    app->mStats.mCpuCullMs = 0.0f;
+  }
 
-  float distbwLightRow = 4.0f;
-  float distbwLightCol = 4.12f;
+  packet->mCpuCullMs = app->mStats.mCpuCullMs;
+
+  app->mDebugDraw.mBegin(&packet->mDebugLines);
+  if (app->mDebugDraw.mEnabled) DebugOverlay(app, packet);
+}
 
-  float refX = refLight.mOffset.x;
-  float refY = refLight.mOffset.y;
-  float refZ = refLight.mOffset.z;
 
-  for (int i = 1; i < 9; i++)
+// ~~~~~~~ Render thread: everything GL, one packet a frame ~~~~~~~
+
+// I: the last frame's counters + times, top left
+void DrawOverlay(App* app, const RenderPacket& packet, const int64_t* counters)
+{
+  TextOverlay& text = app->mTextOverlay;
+  float x = text.mCharWidth(), y = text.mLineHeight();
+  char line[128];
+
+  const int columns = 2;
+  int rows = (CounterIdCount + columns - 1) / columns + 3;
+  text.mPanel(0.0f, 0.0f, text.mCharWidth() * 64, text.mLineHeight() * 1.5f * rows + y, DebugDraw::mRgba(0.0f, 0.0f, 0.0f, 0.6f));
+
+  uint32_t white = DebugDraw::mRgba(1.0f, 1.0f, 1.0f), yellow = DebugDraw::mRgba(1.0f, 0.9f, 0.3f);
+  snprintf(line, sizeof(line), "FRAME %.2f MS  CPU CULL %.2f  GPU CULL %.2f  HI-Z %.2f",
+           packet.mFrameMs, packet.mCpuCullMs, app->mCullTimer.mLastMs, app->mHiZTimer.mLastMs);
+  text.mPrint(x, y, line, yellow);
+  y += text.mLineHeight() * 1.5f;
+  const RenderTarget& target = app->mSceneTarget;
+  snprintf(line, sizeof(line), "GPU FRAME %.2f MS  SCALE %.2f  %dX%d%s",
+           app->mFrameTimer.mLastMs, app->mDynamicRes.mScale, target.mRenderWidth, target.mRenderHeight,
+           app->mDynamicRes.mEnabled ? "" : "  [FIXED]");
+  text.mPrint(x, y, line, yellow);
+  y += text.mLineHeight() * 1.5f;
+
+  for (int id = 0; id < CounterIdCount; id += columns)
   {
-    float newX = refX - (distbwLightCol * (i / 3));
-    float newY = refY;
-    float newZ = refZ - (distbwLightRow * (i % 3));
-    
-    refLight.mOffset = glm::vec3(newX, newY, newZ);
-    gApp.meshes["Light " + std::to_string(i)] = refLight;
+    for (int column = 0; column < columns && id + column < CounterIdCount; column++)
+    {
+      snprintf(line, sizeof(line), "%-10s %lld", Counters::mLabel(id + column), (long long)counters[id + column]);
+      text.mPrint(x + column * text.mCharWidth() * 30, y, line, white);
+    }
+    y += text.mLineHeight() * 1.5f;
   }
+
+  text.mFlush(app->mSceneTarget.mWidth, app->mSceneTarget.mHeight, &app->mStream);
 }
 
-void TilePlacement()
+
+void RenderFrame(App* app, const RenderPacket& packet)
 {
-  Mesh3D refTile = gApp.meshes.at("Tile"); 
+  AllocScope scope("render frame");
 
-  float distbwTileRow = 1.0f;
-  float distbwTileCol = 1.0f;
+  // idle: nothing was drawn since, the scene target still has the last frame
+  if (packet.mPresentOnly)
+  {
+    app->mSceneTarget.mPresent(app->mDynamicRes.mSharpness);
+    glfwSwapBuffers(app->mWindow);
+    return;
+  }
 
-  float refX = refTile.mOffset.x;
-  float refY = refTile.mOffset.y;
-  float refZ = refTile.mOffset.z;
+  // this frame's size from the GPU time of one a few frames back [dynamicResolution.hpp]
+  RenderTarget& target = app->mSceneTarget;
+  float scale = app->mDynamicRes.mUpdate(app->mFrameTimer.mLastMs);
+  int renderWidth, renderHeight;
+  app->mDynamicRes.mRenderSize(target.mWidth, target.mHeight, &renderWidth, &renderHeight);
+  target.mSetRenderSize(renderWidth, renderHeight);
+
+  app->mFrameTimer.mBegin();
+  app->mStream.mBeginFrame();
+  FinishTextureUploads(app);
+  if (!packet.mMoved.empty()) app->mScene.mSetTransforms(packet.mMoved, packet.mMovedModels, packet.mMovedNormals);
+  if (!packet.mLightMasks.empty()) app->mScene.mSetLightMasks(packet.mLightMasks);
+  if (packet.mInstanceFlags) app->mScene.mSetInstanceVisibility(packet.mVisibility);
+  PreDraw(app);
+
+  // 1. culling [compute], fills the indirect commands for this frame
+  app->mCullTimer.mBegin();
+  app->mScene.mCull(packet.mProjectionView, packet.mViewPos, packet.mConeCulling,
+                    packet.mInstanceFlags, packet.mHiZCulling ? &app->mDepthPyramid : nullptr);
+  app->mCullTimer.mEnd();
+
+  // shadow maps for all the meshes
+  for (int i = 0; i < app->mLightsNumber; i++)
+  {
+    glActiveTexture(GL_TEXTURE0 + i);
+    glBindTexture(GL_TEXTURE_2D, app->mLights[i].mShadowMap.mTextureObject);    
+  }
+  Counters::mAdd(CounterTextureBinds, app->mLightsNumber);
 
-  for (int i = 1; i < 150; i++)
+  // 2. everything that survived
+  app->mScenePipelineStats.mBegin();
+  DrawScene(app, packet);
+  app->mScenePipelineStats.mEnd();
+
+  // 3. Hi-Z: pyramid from this frame's depth [used by the next frame's cull], then
+  //    the clusters the old pyramid hid that show up in this one
+  if (packet.mHiZCulling)
   {
-    float newX = refX - (distbwTileCol * (i / 10));
-    float newY = refY;
-    float newZ = refZ - (distbwTileRow * (i % 10));
-    
-    refTile.mOffset = glm::vec3(newX, newY, newZ);
-    gApp.meshes["Tile " + std::to_string(i)] = refTile;
+    app->mHiZTimer.mBegin();
+    app->mSceneTarget.mResolveDepth();
+    app->mDepthPyramid.mBuild(target.mDepthTexture, target.mRenderWidth, target.mRenderHeight);
+    app->mScene.mCullDisoccluded(packet.mProjectionView, app->mDepthPyramid);
+    app->mHiZTimer.mEnd();
+
+    app->mRecoveryPipelineStats.mBegin();
+    DrawScene(app, packet, true);
+    app->mRecoveryPipelineStats.mEnd();
   }
+  else app->mDepthPyramid.mValid = false; // would be stale when it's turned back on
+
+  app->mDebugRenderer.mFlush(packet.mDebugLines, packet.mProjectionView, &app->mStream);
+
+  // the GPU's own numbers are a few frames old [query ring, stats read back]
+  CullStats& cullStats = app->mScene.mLastStats;
+  Counters::mAdd(CounterTriangles, cullStats.mVisibleTriangles);
+  Counters::mAdd(CounterSceneVertexInvocations, app->mScenePipelineStats.mLastVertexInvocations);
+  Counters::mAdd(CounterSceneFragmentInvocations, app->mScenePipelineStats.mLastFragmentInvocations);
+  if (packet.mHiZCulling)
+  {
+    Counters::mAdd(CounterRecoveryVertexInvocations, app->mRecoveryPipelineStats.mLastVertexInvocations);
+    Counters::mAdd(CounterRecoveryFragmentInvocations, app->mRecoveryPipelineStats.mLastFragmentInvocations);
+  }
+
+  // upscaled [or blitted] into the window, the overlay goes on top at its full size
+  target.mPresent(app->mDynamicRes.mSharpness);
+
+  int64_t counters[CounterIdCount];
+  Counters::mCollect(counters);
+  if (packet.mOverlay) DrawOverlay(app, packet, counters); // counted in the next frame
+
+  app->mFrameTimer.mEnd();
+  app->mStream.mEndFrame();
+  glfwSwapBuffers(app->mWindow);
+
+  // input read -> frame handed to the swap chain, what the hand on the mouse waits for
+  // [minus the scan out]
+  float latencyMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - packet.mInputTime).count();
+
+  std::lock_guard<std::mutex> lock(app->mStatsMutex);
+  app->mRenderStats.mSubmittedTriangles = cullStats.mVisibleTriangles;
+  app->mRenderStats.mCulledTriangles = cullStats.mCulledTriangles;
+  app->mRenderStats.mHiZOccludedClusters = cullStats.mOccludedClusters;
+  app->mRenderStats.mHiZRecoveredClusters = cullStats.mRecoveredClusters;
+  app->mRenderStats.mCullMs = app->mCullTimer.mLastMs;
+  app->mRenderStats.mHiZMs = app->mHiZTimer.mLastMs;
+  app->mRenderStats.mInputLatencyMs = latencyMs;
+  app->mRenderStats.mGpuFrameMs = app->mFrameTimer.mLastMs;
+  app->mRenderStats.mRenderScale = scale;
+  app->mRenderStats.mLightsPerInstance = app->mScene.mLightsPerInstance;
+  for (int id = 0; id < CounterIdCount; id++) app->mRenderStats.mCounters[id] = counters[id];
 }
 
-void SideTilePlacement()
+
+void SendLightInformation(App* app)
 {
-  Mesh3D refTile = gApp.meshes.at("Tile Side"); 
-  gApp.meshes.erase("Tile Side");
+  glUseProgram(app->mGraphicsPipelineShaderProgram);
+  LightInformation(app, app->mGraphicsPipelineShaderProgram);
 
-  float distbwTileRow = 1.0f;
-  float distbwTileCol = 1.0f;
+  glUseProgram(app->mNormalsGraphicsPipelineShaderProgram);
+  LightInformation(app, app->mNormalsGraphicsPipelineShaderProgram);
+
+  glUseProgram(app->mCeilingLightGraphicsPipelineShaderProgram);
+  LightInformation(app, app->mCeilingLightGraphicsPipelineShaderProgram);
+}
 
-  float refX = refTile.mOffset.x;
-  float refY = refTile.mOffset.y;
-  float refZ = refTile.mOffset.z;
-  float refR = refTile.mRotate;
-  int count = 0;
 
-  for (int i = 0; i < 10; i++)
+// Owns the context from here until the quit packet
+void RenderThread(App* app)
+{
+  glfwMakeContextCurrent(app->mWindow);
+  SendLightInformation(app);
+
+  while (true)
   {
-    if (i < 2)  continue; // door is there
-    float newX = refX;
-    float newY = refY;
-    float newZ = refZ - (distbwTileRow * (i % 10));
-    
-    refTile.mOffset = glm::vec3(newX, newY, newZ);
-    gApp.meshes["Tile Side " + std::to_string(count++)] = refTile;
+    const RenderPacket* packet = app->mPackets.mWaitRead();
+    bool quit = packet->mQuit;
+    if (!quit) RenderFrame(app, *packet);
+    app->mPackets.mEndRead();
+    if (quit) break;
   }
 
-  for (int i = 0; i < 15; i++)
+  glfwMakeContextCurrent(nullptr);
+}
+
+
+// Every new of both threads' frames and the jobs they ran, none once it's all loaded
+// [benchmark, built with -DTRACK_ALLOCATIONS]
+uint64_t FrameAllocations()
+{
+  return Allocations::mCount("frame") + Allocations::mCount("render frame") + Allocations::mCount("jobs");
+}
+
+
+// Frame N + 1 is made here while the render thread draws N [the queue holds two]. With
+// --render-thread 0 the packet is drawn right after it is made, the old single thread loop
+void mainLoop(App* app) 
+{
+  std::thread renderThread;
+  if (app->mRenderThread)
   {
-    float newX = refX - (distbwTileCol * (i % 15));
-    float newY = refY;
-    float newZ = refZ - 0.005f;
-    float newR = refR +  90.0f;
-    
-    refTile.mOffset = glm::vec3(newX, newY, newZ);
-    refTile.mRotate = newR;
-    gApp.meshes["Tile Side " + std::to_string(count++)] = refTile;
+    glfwMakeContextCurrent(nullptr);
+    renderThread = std::thread(RenderThread, app);
   }
+  else SendLightInformation(app);
 
-  for (int i = 0; i < 15; i++)
+  while (!glfwWindowShouldClose(app->mWindow))
   {
-    float newX = (refX - (distbwTileCol * (i % 15))) - 1.005f;
-    float newY = refY;
-    float newZ = refZ - 10.0f;
-    float newR = refR -  90.0f;
-    
-    refTile.mOffset = glm::vec3(newX, newY, newZ);
-    refTile.mRotate = newR;
-    gApp.meshes["Tile Side " + std::to_string(count++)] = refTile;
+    AllocScope scope("frame");
+
+    // input first, so the packet has the newest camera [idle: sleeps until there is some]
+    if (app->mIdle.mIdle()) glfwWaitEventsTimeout(app->mIdle.mWaitSeconds);
+    else glfwPollEvents(); 
+    auto inputTime = std::chrono::steady_clock::now();
+
+    // get fps [with the render thread, the queue paces this loop]
+    float currentTime = glfwGetTime();
+    app->mDeltaTime = currentTime - app->mLastFrame;
+    app->mLastFrame = currentTime;
+    if (app->mIdle.mIdle()) app->mDeltaTime = std::min(app->mDeltaTime, 1.0f / 60.0f); // the wait isn't a frame, keys move by it
+
+    if (app->mBenchmark.mActive())
+    {
+      // last frame's numbers, then where the camera is for this one
+      FrameStats stats = CurrentStats(app);
+      app->mBenchmark.mRecordCounters(stats.mCounters);
+      app->mBenchmark.mRecordAllocations(FrameAllocations());
+      app->mBenchmark.mRecordScale(stats.mRenderScale, stats.mGpuFrameMs);
+      if (!app->mBenchmark.mRecord(app->mDeltaTime * 1000.0f, stats.mCullMs, stats.mHiZMs, stats.mCpuCullMs, stats.mInputLatencyMs))
+      {
+        app->mBenchmark.mPrintReport(app->mSceneFile.mInstanceCount(), app->mSceneFile.mBuilding(), app->mTextureCache.mBytesUploaded, app->mJobs.mThreadCount());
+        if (app->mCountersJson) app->mBenchmark.mWriteCountersJson(app->mCountersJson);
+        break;
+      }
+      app->mBenchmark.mPose(app->mSceneFile.mBuilding(), &app->mCamera);
+    }
+  
+    Input(app);
+
+    // idle frames are skipped, unless the window wants the last one again
+    bool idle = app->mIdle.mUpdate(FrameChanged(app));
+    if (!idle || app->mNeedsPresent)
+    {
+      RenderPacket* packet = app->mPackets.mWaitWrite();
+      if (idle)
+      {
+        packet->mQuit = false;
+        packet->mPresentOnly = true;
+        app->mIdle.mCountPresent();
+      }
+      else BuildPacket(app, packet, inputTime);
+      app->mNeedsPresent = false;
+      app->mPackets.mEndWrite();
+
+      if (!app->mRenderThread)
+      {
+        RenderFrame(app, *app->mPackets.mBeginRead());
+        app->mPackets.mEndRead();
+      }
+    }
+
+    UpdateStats(app);
+    if (app->mDumpCounters)
+    {
+      DumpCounters(app);
+      app->mDumpCounters = false;
+    }
+    if (app->mPrintMemory)
+    {
+      gMemory.mPrintReport(MemorySortSize);
+      app->mPrintMemory = false;
+    }
   }
 
-  for (int i = 0; i < 10; i++)
+  if (renderThread.joinable())
   {
-    float newX = refX - 15.0f;
-    float newY = refY;
-    float newZ = (refZ - (distbwTileRow * (i % 10))) - 1.005f;
-    float newR = refR -  180.0f;
-    
-    refTile.mOffset = glm::vec3(newX, newY, newZ);
-    refTile.mRotate = newR;
-    gApp.meshes["Tile Side " + std::to_string(count++)] = refTile;
+    RenderPacket* packet = app->mPackets.mWaitWrite();
+    packet->mQuit = true;
+    app->mPackets.mEndWrite();
+    renderThread.join();
+    glfwMakeContextCurrent(app->mWindow);
   }
 }
 
-void CeilingPlacement()
+
+void cleanUp() 
 {
-  Mesh3D refTile = gApp.meshes.at("Ceiling"); 
+  gApp.mTextureStreamer.mStop();
+  gApp.mJobs.mStop();
+  gMemory.mPrintReport(MemorySortTag);
+  Allocations::mPrintReport("at exit");
+  gApp.mIdle.mPrintReport();
+  gApp.mStream.mPrintReport();
+  gApp.mStream.mDestroy();
+  glfwTerminate();
+  return;
+}
 
-  float distbwTileRow = 1.005f;
-  float distbwTileCol = 1.03f;
 
-  float refX = refTile.mOffset.x;
-  float refY = refTile.mOffset.y;
-  float refZ = refTile.mOffset.z;
+// One mesh per scene asset [same index as in the snapshot], ObjectFilling loads the model + texture into it
+void SceneAssets()
+{
+  AllocScope scope("startup: assets");
+  const SceneSnapshot& scene = gApp.mSceneFile;
+  GLuint pipelines[] = {0, gApp.mNormalsGraphicsPipelineShaderProgram, gApp.mCeilingLightGraphicsPipelineShaderProgram};
+  gApp.mStore.mAssets.reserve(scene.mAssetCount());
 
-  for (int i = 1; i < 150; i++)
+  for (uint32_t i = 0; i < scene.mAssetCount(); i++)
   {
-    float newX = refX - (distbwTileCol * (i / 10));
-    float newY = refY;
-    float newZ = refZ - (distbwTileRow * (i % 10));
-    
-    refTile.mOffset = glm::vec3(newX, newY, newZ);
-    gApp.meshes["Ceiling " + std::to_string(i)] = refTile;
+    const SceneAsset& asset = scene.mAsset(i);
+    Mesh3D mesh;
+
+    // strings point into the snapshot, it stays open as long as the app
+    mesh.name = scene.mString(asset.mName);
+    mesh.mModelPath = scene.mString(asset.mModelPath);
+    mesh.mTexturePath = scene.mString(asset.mTexturePath);
+    mesh.mGraphicsPipeline = pipelines[asset.mPipeline];
+    mesh.mScale = glm::vec3(asset.mScale[0], asset.mScale[1], asset.mScale[2]);
+    mesh.mColor = glm::vec3(asset.mColor[0], asset.mColor[1], asset.mColor[2]);
+    mesh.isLight = (asset.mFlags & SceneAssetLight) != 0;
+
+    mesh.mIsOccluder = (asset.mFlags & SceneAssetOccluder) != 0;
+    mesh.mOccluderBoxMin = glm::vec3(asset.mOccluderMin[0], asset.mOccluderMin[1], asset.mOccluderMin[2]);
+    mesh.mOccluderBoxMax = glm::vec3(asset.mOccluderMax[0], asset.mOccluderMax[1], asset.mOccluderMax[2]);
+    mesh.mIsPortal = (asset.mFlags & SceneAssetPortal) != 0;
+
+    gApp.mStore.mAssets.push_back(mesh);
   }
 }
 
 
-void CeilingGridPlacement()
+void ObjectFilling()
 {
-  Mesh3D refTile = gApp.meshes.at("Ceiling Grid"); 
+  AllocScope scope("startup: models + textures");
+  for (Mesh3D& mesh : gApp.mStore.mAssets) {
+    if(!meshCreate(mesh.mModelPath, &mesh))       // Loading position, UV, normals for vertices
+    {
+      std::cout << "Failed to load model for " << mesh.name << std::endl;
+    };
+  }
 
-  float distbwTileRow = 1.005f;
-  float distbwTileCol = 1.03f;
+  // How big every texture can ever get on screen, before anything is uploaded
+  // Scene instances use the asset's scale, so the assets are enough
+  gApp.mTextureBudget.mScreenHeight = gApp.mScreenHeight;
+  for (const Mesh3D& mesh : gApp.mStore.mAssets) gApp.mTextureBudget.mAddInstance(mesh);
+  gApp.mTextureBudget.mPlan();
+  for (const Mesh3D& mesh : gApp.mStore.mAssets)
+  {
+    const char* path = mesh.mTexturePath;
+    if (strcmp(path, "") != 0) gApp.mTextureCache.mSetHalvings(path, gApp.mTextureBudget.mHalvings(path));
+  }
 
-  float refX = refTile.mOffset.x;
-  float refY = refTile.mOffset.y;
-  float refZ = refTile.mOffset.z;
+  for (Mesh3D& mesh : gApp.mStore.mAssets) {
+    if(strcmp(mesh.mTexturePath, "") != 0)
+    {
+      if (!loadTexture(mesh.mTexturePath, &mesh)) // Loading texture for object [if avaliable] 
+      {
+        std::cout << "Failed to load texture for " << mesh.name << std::endl;
+      }
+    } 
+    else std::cout << "No texture allocated for " << mesh.name << std::endl;
 
-  for (int i = 1; i < 150; i++)
-  {
-    float newX = refX - (distbwTileCol * (i / 10));
-    float newY = refY;
-    float newZ = refZ - (distbwTileRow * (i % 10));
-    
-    refTile.mOffset = glm::vec3(newX, newY, newZ);
-    gApp.meshes["Ceiling Grid" + std::to_string(i)] = refTile;
   }
+
+  gApp.mTextureCache.mPrintReport();
 }
 
 
-void initializeObjects()
+// Instances are placement + what they draw with, the geometry stays in the assets
+// [GpuScene uploads it once per model file]
+void SceneInstances()
 {
-  ObjectCreation("Bench", 
-                 glm::vec3(0.077f, 0.07f, 0.06f),
-                 glm::vec3(-0.008f, 0.0f, -2.2f),
-                 0.0f,
-                 "Models/bench_1.obj",
-                 "Models/textures/combinedBenchTexture.png");
-
-  ObjectCreation("Board", 
-                 glm::vec3(0.07f, 0.07f, 0.07f),
-                 glm::vec3(-4.0f, 1.2f, 0.0f),
-                 180.0f,
-                 "Models/board_shaded.obj",
-                 "Models/textures/board/board_combined_texture_1.jpeg");
-
-  ObjectCreation("Ceiling", 
-                 glm::vec3(0.083f, 0.02f, 0.080f),
-                 glm::vec3(0.14f, 4.93f, 0.0f),
-                 180.0f,
-                 "Models/ceiling.obj",
-                 "Models/normals/corse_texture_edited.jpeg",
-                 gApp.mNormalsGraphicsPipelineShaderProgram,
-                 glm::vec3(171.0f, 171.0f, 196.0f));
-
-  ObjectCreation("Ceiling Grid", 
-                 glm::vec3(0.08035f, 0.04f, 0.0785f),
-                 glm::vec3(0.14f, 4.93f, 0.0f),
-                 180.0f,
-                 "Models/ceiling_grid.obj",
-                 "Models/normals/corse_texture_edited.jpeg",
-                 gApp.mNormalsGraphicsPipelineShaderProgram,
-                 glm::vec3(170.0f, 170.0f, 191.0f));
-
-  ObjectCreation("Clock", 
-                 glm::vec3(0.31f, 0.31f, 0.25f),
-                 glm::vec3(-15.0f, 4.4f, -5.2f),
-                 90.0f,
-                 "Models/clock.obj",
-                 "Models/textures/clock/combined_texture_clock.jpeg");
-
-  ObjectCreation("Door", 
-                 glm::vec3(0.07f, 0.07f, 0.06f),
-                 glm::vec3(-0.922f, 0.0f, -1.708f),
-                 300.0f,
-                 "Models/door_shaded.obj",
-                 "Models/textures/door/combined_texture.jpeg");
-
-  ObjectCreation("Door Frame", 
-                 glm::vec3(0.068f, 0.07f, 0.05f),
-                 glm::vec3(0.035f, 0.0f, -1.87f),
-                 270.0f,
-                 "Models/door_frame.obj",
-                 "Models/textures/door_frame/combined_texture_door_frame_2.jpeg");
-
-  ObjectCreation("Light", 
-                 glm::vec3(0.078f, 0.02f, 0.078f),
-                 glm::vec3(-4.0f, 4.93f, -2.0f),
-                 0.0f,
-                 "Models/light.obj",
-                 "Models/textures/light/texture.png",
-                 gApp.mCeilingLightGraphicsPipelineShaderProgram,
-                 glm::vec3(0.0f, 0.0f, 0.0f),
-                 true);
-
-
-  ObjectCreation("Podium", 
-                 glm::vec3(0.16f, 0.16f, 0.16f),
-                 glm::vec3(-2.2f, 0.0f, -1.05f),
-                 180.0f,
-                 "Models/podium_shaded.obj",
-                 "Models/textures/podium/podium_combined_texture_2.jpeg");
-
-  ObjectCreation("Projector Screen", 
-                 glm::vec3(0.07f, 0.07f, 0.07f),
-                 glm::vec3(-4.0f, 1.2f, 0.0f),
-                 180.0f,
-                 "Models/projector_screen_1.obj",
-                 "Models/textures/projector_screen/combined_projector_screen_texture.jpeg");
-
-  ObjectCreation("Remote", 
-                 glm::vec3(0.016f, 0.018f, 0.016f),
-                 glm::vec3(-3.86f, 2.27f, 0.005f),
-                 180.0f,
-                 "Models/remote_1_shaded.obj",
-                 "Models/textures/remote/remote_1_texture.jpeg");
-
-  ObjectCreation("Switch 1", 
-                 glm::vec3(0.085f, 0.075f, 0.085f),
-                 glm::vec3(0.0f, 0.7f, -3.6f),
-                 270.0f,
-                 "Models/switch_1.obj",
-                 "Models/textures/switch/combined_projector_screen_texture.jpeg");
-
-  ObjectCreation("Switch 2", 
-                 glm::vec3(0.6f, 0.6f, 0.7f),
-                 glm::vec3(-3.4f, 0.7f, 0.0f),
-                 180.0f,
-                 "Models/switch_2.obj",
-                 "Models/textures/switch/combined_projector_screen_texture.jpeg");
-
-  ObjectCreation("Switch 3", 
-                 glm::vec3(0.6f, 0.6f, 0.7f),
-                 glm::vec3(-12.5f, 0.7f, 0.0f),
-                 180.0f,
-                 "Models/switch_2.obj",
-                 "Models/textures/switch/combined_projector_screen_texture.jpeg");
-
-  ObjectCreation("Switch 4", 
-                 glm::vec3(0.4f, 0.36f, 0.4f),
-                 glm::vec3(0.0f, 2.0f, -8.4f),
-                 270.0f,
-                 "Models/switch_3.obj",
-                 "Models/textures/wire_cover/white_bluish.png");
-
-
-  ObjectCreation("Switch 5", 
-                 glm::vec3(0.4f, 0.36f, 0.4f),
-                 glm::vec3(0.0f, 2.0f, -3.2f),
-                 270.0f,
-                 "Models/switch_3.obj",
-                 "Models/textures/wire_cover/white_bluish.png");
-
-
-  ObjectCreation("Table", 
-                 glm::vec3(0.07f, 0.07f, 0.07f),
-                 glm::vec3(-5.6f, 0.0f, -3.6f),
-                 0.0f,
-                 "Models/table_shaded.obj",
-                 "Models/textures/table/table_combined_texture_new_new.jpeg");
-
-  ObjectCreation("Tile", 
-                 glm::vec3(0.078f, 0.02f, 0.078f),
-                 glm::vec3(0.0f, 0.0f, 0.0f),
-                 180.0f,
-                 "Models/tile.obj",
-                 "Models/textures/tile/tile_texture_combined_1.jpeg");
-
-  ObjectCreation("Tile Side", 
-                 glm::vec3(0.078f, 0.078f, 0.078f),
-                 glm::vec3(0.0f, 0.0f, 0.0f),
-                 180.0f,
-                 "Models/side_tile.obj",
-                 "Models/textures/tile/tile_texture_combined_1.jpeg");
-
-
-  ObjectCreation("Wall Back", 
-                 glm::vec3(0.07f, 0.07f, 0.07f),
-                 glm::vec3(-15.0f, 0.0f, -10.18f),
-                 0.0f,
-                 "Models/wall_back.obj",
-                 "Models/normals/corse_texture_edited.jpeg",
-                 gApp.mNormalsGraphicsPipelineShaderProgram,
-                 glm::vec3(230.0f, 226.0f, 209.0f));
-
-  ObjectCreation("Wall Front", 
-                 glm::vec3(0.07f, 0.07f, 0.07f),
-                 glm::vec3(-4.0f, 1.2f, -0.01f),
-                 180.0f,
-                 "Models/wall_front.obj",
-                 "Models/normals/corse_texture_edited.jpeg",
-                 gApp.mNormalsGraphicsPipelineShaderProgram,
-                 glm::vec3(230.0f, 226.0f, 209.0f));
-
-
-  ObjectCreation("Wall Left", 
-                 glm::vec3(0.07f, 0.07f, 0.07f),
-                 glm::vec3(0.0f, 0.0f, 0.01f),
-                 90.0f,
-                 "Models/wall_left.obj",
-                 "Models/normals/corse_texture_edited.jpeg",
-                 gApp.mNormalsGraphicsPipelineShaderProgram,
-                 glm::vec3(230.0f, 226.0f, 209.0f));
-
-
-  ObjectCreation("Wall Right", 
-                 glm::vec3(0.07f, 0.07f, 0.07f),
-                 glm::vec3(-15.337f, 0.0f, 0.01f),
-                 90.0f,
-                 "Models/wall_right.obj",
-                 "Models/normals/corse_texture_edited.jpeg",
-                 gApp.mNormalsGraphicsPipelineShaderProgram,
-                 glm::vec3(230.0f, 226.0f, 209.0f));
-
-
-  ObjectCreation("Window Panel 1", 
-                 glm::vec3(0.066f, 0.06f, 0.06f),
-                 glm::vec3(0.15f, 4.2f, -8.2f),
-                 270.0f,
-                 "Models/window_panel_1_shaded.obj",
-                 "Models/textures/window/combined_window_texture_1.jpeg");
-
-
-  ObjectCreation("Window Panel 2", 
-                 glm::vec3(0.0618f, 0.06f, 0.06f),
-                 glm::vec3(-15.05f, 4.2f, -10.11f),
-                 0.0f,
-                 "Models/window_panel_2.obj",
-                 "Models/textures/window/combined_window_texture_1.jpeg");
-
-  ObjectCreation("Window Panel 3", 
-                 glm::vec3(0.0605f, 0.06f, 0.06f),
-                 glm::vec3(0.0f, 4.2f, 0.06f),
-                 90.0f,
-                 "Models/window_panel_3.obj",
-                 "Models/textures/window/combined_window_texture_1.jpeg");
-
-  ObjectCreation("Window Panel 4", 
-                 glm::vec3(0.069f, 0.06f, 0.06f),
-                 glm::vec3(0.15f, 4.2f, -10.15f),
-                 270.0f,
-                 "Models/window_panel_4.obj",
-                 "Models/textures/window/combined_window_texture_1.jpeg");
-
-  ObjectCreation("Wire Cover 1", 
-                 glm::vec3(0.6f, 66.0f, 0.6f),
-                 glm::vec3(-3.4f, -11.65f, 0.0f),
-                 180.0f,
-                 "Models/wire_cover.obj",
-                 "Models/textures/wire_cover/white_bluish.png");
-
-  ObjectCreation("Wire Cover 2", 
-                 glm::vec3(148.0f, 0.7f, 0.5f),
-                 glm::vec3(45.3f, 0.675f, 0.0f),
-                 180.0f,
-                 "Models/wire_cover_2.obj",
-                 "Models/textures/wire_cover/white_bluish.png");
+  AllocScope scope("startup: instances");
+  const SceneSnapshot& scene = gApp.mSceneFile;
+  gApp.mStore.mReserve(scene.mInstanceCount());
+
+  for (uint32_t i = 0; i < scene.mInstanceCount(); i++)
+  {
+    const SceneInstance& instance = scene.mInstance(i);
+    gApp.mStore.mCreate(scene.mString(instance.mName), instance.mAsset,
+                        glm::vec3(instance.mOffset[0], instance.mOffset[1], instance.mOffset[2]), instance.mRotate);
+  }
 }
 
 
 void GetPoissionSamplingData()
 {
-  FILE* fp;
+  std::vector<unsigned char> scratch;
+  size_t size = 0;
+  const unsigned char* text = gAssets.mLoad("data.txt", &size, scratch);
+  if (!text)
+  {
+    std::cout << "Failed to read data.txt" << std::endl;
+    return;
+  }
 
-  fp = fopen("data.txt", "r");
+  FILE* fp = fmemopen((void*)text, size, "r");
   // as not able to declare this in src/app.hpp, the compiler thinks it was a function
   gApp.mPoissionSamplingPoints.resize(32);
   int count = 0;
@@ -1063,44 +1092,155 @@ void GetPoissionSamplingData()
 }
 
 
-int main()
+// --floors N --rooms M --jitter meters --jitter-rotate degrees --seed S over the scene's
+// "building" [sceneFile.hpp], --benchmark frames, --threads N for the job system
+// [1 = everything on the main thread, default is every hardware thread], --render-thread 0
+// draws on the main thread too, --counters-json path for the benchmark's counters,
+// --gpu-budget / --cpu-budget MB to be warned about [memoryRegistry.hpp], --idle 0 draws
+// every frame even when nothing changes [idleMonitor.hpp], --dynamic-res 1 scales the scene
+// to hold --gpu-budget-ms, between --min-scale and --max-scale with --res-gain p,i, upscaled
+// with --sharpness [dynamicResolution.hpp]
+bool ParseArguments(int argc, char** argv, SceneBuildingOverride* building)
 {
+  for (int i = 1; i < argc; i++)
+  {
+    std::string flag = argv[i];
+    if (i + 1 >= argc)
+    {
+      std::cout << "Missing value for " << flag << std::endl;
+      return false;
+    }
+    const char* value = argv[++i];
+
+    if (flag == "--floors") building->mFloors = atoi(value);
+    else if (flag == "--rooms") building->mRooms = atoi(value);
+    else if (flag == "--jitter") building->mJitter = (float)atof(value);
+    else if (flag == "--jitter-rotate") building->mJitterRotate = (float)atof(value);
+    else if (flag == "--seed") building->mSeed = atoll(value);
+    else if (flag == "--benchmark") gApp.mBenchmark.mFrames = atoi(value);
+    else if (flag == "--threads") gApp.mThreads = std::max(1, atoi(value));
+    else if (flag == "--render-thread") gApp.mRenderThread = atoi(value) != 0;
+    else if (flag == "--counters-json") gApp.mCountersJson = value;
+    else if (flag == "--gpu-budget") gMemory.mGpuBudget = (size_t)(atof(value) * 1024 * 1024);
+    else if (flag == "--cpu-budget") MemoryRegistry::mSetCpuBudget((size_t)(atof(value) * 1024 * 1024));
+    else if (flag == "--idle") gApp.mIdle.mEnabled = atoi(value) != 0;
+    else if (flag == "--dynamic-res") gApp.mDynamicRes.mEnabled = atoi(value) != 0;
+    else if (flag == "--gpu-budget-ms") gApp.mDynamicRes.mBudgetMs = std::max(0.5f, (float)atof(value));
+    else if (flag == "--min-scale") gApp.mDynamicRes.mMinScale = (float)atof(value);
+    else if (flag == "--max-scale") gApp.mDynamicRes.mMaxScale = (float)atof(value);
+    else if (flag == "--sharpness") gApp.mDynamicRes.mSharpness = std::min(std::max((float)atof(value), 0.0f), 1.0f);
+    else if (flag == "--res-gain")
+    {
+      if (sscanf(value, "%f,%f", &gApp.mDynamicRes.mGainP, &gApp.mDynamicRes.mGainI) != 2)
+      {
+        std::cout << "--res-gain wants p,i [e.g. 0.2,0.05]" << std::endl;
+        return false;
+      }
+    }
+    else
+    {
+      std::cout << "Unknown option " << flag << std::endl;
+      std::cout << "Usage: prog [--floors N] [--rooms M] [--jitter m] [--jitter-rotate deg] [--seed S] [--benchmark frames] [--threads N] [--render-thread 0|1] [--counters-json path] [--gpu-budget MB] [--cpu-budget MB] [--idle 0|1] [--dynamic-res 0|1] [--gpu-budget-ms ms] [--min-scale s] [--max-scale s] [--res-gain p,i] [--sharpness 0-1]" << std::endl;
+      return false;
+    }
+  }
+
+  // the scene target is the window's size, it can only shrink
+  DynamicResolution& dynamicRes = gApp.mDynamicRes;
+  dynamicRes.mMaxScale = std::min(std::max(dynamicRes.mMaxScale, 0.1f), 1.0f);
+  dynamicRes.mMinScale = std::min(std::max(dynamicRes.mMinScale, 0.1f), dynamicRes.mMaxScale);
+  dynamicRes.mScale = dynamicRes.mMaxScale;
+  if (dynamicRes.mEnabled) gApp.mBenchmark.mScaleBudgetMs = dynamicRes.mBudgetMs;
+  return true;
+}
+
+
+int main(int argc, char** argv)
+{
+  auto startup = std::chrono::steady_clock::now();
+
+  SceneBuildingOverride building;
+  if (!ParseArguments(argc, argv, &building)) return 1;
+
+  gAssets.mOpen("assets.pak"); // textureCooker/cook.cpp -pack, loose files without it
   initialization(&gApp);
   initializeGrid();
   
   // Pipline
-  Shader shader;
-  gApp.mGraphicsPipelineShaderProgram =  shader.mCreateGraphicsPipeline("shaders/vert.glsl", "shaders/frag.glsl");
-  gApp.mNormalsGraphicsPipelineShaderProgram = shader.mCreateGraphicsPipeline("shaders/normals/vert.glsl", "shaders/normals/frag.glsl");
-  gApp.mCeilingLightGraphicsPipelineShaderProgram = shader.mCreateGraphicsPipeline("shaders/ceilingLight/vert.glsl", "shaders/ceilingLight/frag.glsl");
+  {
+    AllocScope scope("startup: shaders + targets");
+    Shader shader;
+    gApp.mGraphicsPipelineShaderProgram =  shader.mCreateGraphicsPipeline("shaders/vert.glsl", "shaders/frag.glsl");
+    gApp.mNormalsGraphicsPipelineShaderProgram = shader.mCreateGraphicsPipeline("shaders/normals/vert.glsl", "shaders/normals/frag.glsl");
+    gApp.mCeilingLightGraphicsPipelineShaderProgram = shader.mCreateGraphicsPipeline("shaders/ceilingLight/vert.glsl", "shaders/ceilingLight/frag.glsl");
+
+    // Offscreen scene + its depth pyramid
+    gApp.mSceneTarget.mCreate(gApp.mScreenWidth, gApp.mScreenHeight, 8);
+    gApp.mDepthPyramid.mCreate(gApp.mScreenWidth, gApp.mScreenHeight);
+    gApp.mDebugRenderer.mCreate();
+    gApp.mTextOverlay.mCreate();
+  }
 
-  // Objects
-  initializeObjects();
+  // Objects [scenes/classroom.scene, compiled to a snapshot when it changed]
+  {
+    AllocScope scope("startup: scene file");
+    if (!gApp.mSceneFile.mOpen("scenes/classroom.scene", &building))
+    {
+      cleanUp();
+      return 1;
+    }
+  }
+  SceneAssets();
   ObjectFilling();
-  BenchPlacement();
-  SideTilePlacement();
-  LightPlacement();
-  TilePlacement();
-  CeilingPlacement(); 
-  CeilingGridPlacement();
+  SceneInstances();
+
+  // Every asset into one pool, every instance into one SSBO
+  {
+    AllocScope scope("startup: gpu scene");
+    gApp.mJobs.mStart(gApp.mThreads - 1);
+    gApp.mScene.mJobs = &gApp.mJobs;
+    gApp.mScene.mBuild(gApp.mStore, gApp.mGraphicsPipelineShaderProgram, gApp.mTextureCache.mPendingUploads() == 0);
+    AdoptTextureMoves(&gApp);
+
+    // Per frame uploads: the visibility flags + room for moved instances and debug lines
+    size_t debugBytes = gApp.mDebugDraw.mMaxVertices * sizeof(DebugVertex);
+    if (gApp.mStream.mCreate(std::max<size_t>(1 << 20, gApp.mStore.mCount() * sizeof(GLuint) + (256 << 10)) + debugBytes))
+      gApp.mScene.mStream = &gApp.mStream;
+
+    // Rooms as cells, doors and windows as portals between them
+    gApp.mPortals.mBuild(gApp.mSceneFile.mBuilding(), gApp.mScene.mPortalBoundsMin, gApp.mScene.mPortalBoundsMax);
+    gApp.mPortals.mAssignInstances(gApp.mScene.mInstanceBoundsMin, gApp.mScene.mInstanceBoundsMax);
+  }
 
   GetPoissionSamplingData();
 
   // Lights
-  glm::vec3 tempLightPos;
-  for (int i = 0; i < gApp.mLightsNumber; i++)
   {
-    tempLightPos.x = gApp.mRefLightPos.x - (gApp.mDistBwLightCol * (i / 3));
-    tempLightPos.y = gApp.mRefLightPos.y;
-    tempLightPos.z = gApp.mRefLightPos.z - (gApp.mDistBwLightRow * (i % 3));
-
-    gApp.mLights[i].mPosition = tempLightPos;
-    gApp.mLights[i].mGenShadowMap(gApp.meshes);
-    gApp.mLightProjectionViewMatrixCombined[i] = gApp.mLights[i].mGetProjectionMatrix() * gApp.mLights[i].mGetViewMatrix();
+    AllocScope scope("startup: shadow maps");
+    gApp.mLightsNumber = (int)gApp.mSceneFile.mLightCount();
+    for (int i = 0; i < gApp.mLightsNumber; i++)
+    {
+      const float* position = gApp.mSceneFile.mLight(i).mPosition;
+      gApp.mLights[i].mPosition = glm::vec3(position[0], position[1], position[2]);
+      gApp.mLights[i].mGenShadowMap(gApp.mScene);
+      gApp.mLightProjectionViewMatrixCombined[i] = gApp.mLights[i].mGetProjectionMatrix() * gApp.mLights[i].mGetViewMatrix();
+    }
   }
 
+  gAssets.mPrintReport();
+
+  gApp.mBenchmark.mStartupMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startup).count();
+  std::cout << "Startup: " << gApp.mBenchmark.mStartupMs << " ms, " << gApp.mSceneFile.mInstanceCount() << " instances" << std::endl;
+  Allocations::mPrintReport("at startup");
+
   mainLoop(&gApp);
   cleanUp();
 
+  // the zero allocation check of the timed frames, for scripts
+  if (!gApp.mBenchmark.mAllocationFree())
+  {
+    std::cout << "Benchmark: the timed frames allocated" << std::endl;
+    return 1;
+  }
   return 0;
 }
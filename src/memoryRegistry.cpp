@@ -0,0 +1,208 @@
+#include "../glad/glad.h"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+
+#include "memoryRegistry.hpp"
+#include "textureCompress.hpp"
+
+MemoryRegistry gMemory;
+
+static double toMB(size_t bytes)
+{
+  return bytes / (1024.0 * 1024.0);
+}
+
+
+void MemoryRegistry::mTrack(const Entry& entry)
+{
+  if (entry.mName == 0) return;
+
+  std::lock_guard<std::mutex> lock(mMutex);
+  uint64_t key = (uint64_t)entry.mKind << 32 | entry.mName;
+
+  // made again with a new size [glBufferData on the same name]
+  auto found = mEntries.find(key);
+  if (found != mEntries.end())
+  {
+    mTagBytes[found->second.mTag] -= found->second.mBytes;
+    mTotalBytes -= found->second.mBytes;
+  }
+
+  mEntries[key] = entry;
+  mTagBytes[entry.mTag] += entry.mBytes;
+  mTotalBytes += entry.mBytes;
+
+  if (mGpuBudget > 0 && mTotalBytes > mGpuBudget && !mGpuWarned)
+  {
+    mGpuWarned = true;
+    std::cout << "Memory: over the GPU budget, " << toMB(mTotalBytes) << " of " << toMB(mGpuBudget)
+              << " MB [last: " << entry.mOwner << ", " << mTagName(entry.mTag) << "]" << std::endl;
+  }
+}
+
+
+void MemoryRegistry::mRelease(GLenum kind, GLsizei count, const GLuint* names)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  for (GLsizei i = 0; i < count; i++)
+  {
+    auto found = mEntries.find((uint64_t)kind << 32 | names[i]);
+    if (found == mEntries.end()) continue; // views, never tracked
+
+    mTagBytes[found->second.mTag] -= found->second.mBytes;
+    mTotalBytes -= found->second.mBytes;
+    mEntries.erase(found);
+  }
+
+  if (mTotalBytes <= mGpuBudget) mGpuWarned = false;
+}
+
+
+void MemoryRegistry::mTrackBuffer(GLuint buffer, size_t bytes, MemoryTag tag, const char* owner)
+{
+  Entry entry;
+  entry.mKind = GL_BUFFER;
+  entry.mName = buffer;
+  entry.mBytes = bytes;
+  entry.mTag = tag;
+  entry.mOwner = owner;
+  mTrack(entry);
+}
+
+
+void MemoryRegistry::mTrackTexture(GLuint texture, GLenum format, int width, int height, int levels, int layers, MemoryTag tag, const char* owner)
+{
+  mTrackTexture(texture, textureBytes(format, width, height, levels, layers), format, width, height, tag, owner);
+}
+
+
+void MemoryRegistry::mTrackTexture(GLuint texture, size_t bytes, GLenum format, int width, int height, MemoryTag tag, const char* owner)
+{
+  Entry entry;
+  entry.mKind = GL_TEXTURE;
+  entry.mName = texture;
+  entry.mBytes = bytes;
+  entry.mFormat = format;
+  entry.mWidth = width;
+  entry.mHeight = height;
+  entry.mTag = tag;
+  entry.mOwner = owner;
+  mTrack(entry);
+}
+
+
+void MemoryRegistry::mTrackRenderbuffer(GLuint renderbuffer, GLenum format, int width, int height, int samples, MemoryTag tag, const char* owner)
+{
+  Entry entry;
+  entry.mKind = GL_RENDERBUFFER;
+  entry.mName = renderbuffer;
+  entry.mBytes = textureBytes(format, width, height, 1) * std::max(samples, 1);
+  entry.mFormat = format;
+  entry.mWidth = width;
+  entry.mHeight = height;
+  entry.mTag = tag;
+  entry.mOwner = owner;
+  mTrack(entry);
+}
+
+
+void MemoryRegistry::mDeleteBuffers(GLsizei count, const GLuint* buffers)
+{
+  mRelease(GL_BUFFER, count, buffers);
+  glDeleteBuffers(count, buffers);
+}
+
+
+void MemoryRegistry::mDeleteTextures(GLsizei count, const GLuint* textures)
+{
+  mRelease(GL_TEXTURE, count, textures);
+  glDeleteTextures(count, textures);
+}
+
+
+void MemoryRegistry::mDeleteRenderbuffers(GLsizei count, const GLuint* renderbuffers)
+{
+  mRelease(GL_RENDERBUFFER, count, renderbuffers);
+  glDeleteRenderbuffers(count, renderbuffers);
+}
+
+
+size_t MemoryRegistry::mGpuBytes()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mTotalBytes;
+}
+
+
+size_t MemoryRegistry::mGpuBytes(MemoryTag tag)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mTagBytes[tag];
+}
+
+
+void MemoryRegistry::mPrintReport(MemorySort sort, int largest)
+{
+  std::vector<Entry> entries;
+  size_t tagBytes[MemoryTagCount];
+  int tagObjects[MemoryTagCount] = {};
+  size_t total;
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    entries.reserve(mEntries.size());
+    for (const auto& pair : mEntries)
+    {
+      entries.push_back(pair.second);
+      tagObjects[pair.second.mTag]++;
+    }
+    for (int tag = 0; tag < MemoryTagCount; tag++) tagBytes[tag] = mTagBytes[tag];
+    total = mTotalBytes;
+  }
+
+  std::cout << std::fixed << std::setprecision(2)
+            << "Memory: GPU " << toMB(total) << " MB in " << entries.size() << " objects";
+  if (mGpuBudget) std::cout << " [budget " << toMB(mGpuBudget) << "]";
+  std::cout << ", CPU " << toMB(mCpuBytes()) << " MB tracked";
+  if (CpuMemory::mBudget()) std::cout << " [budget " << toMB(CpuMemory::mBudget()) << "]";
+  std::cout << std::endl;
+
+  // per tag, biggest first
+  int order[MemoryTagCount];
+  for (int tag = 0; tag < MemoryTagCount; tag++) order[tag] = tag;
+  std::sort(order, order + MemoryTagCount, [&](int a, int b)
+  {
+    return tagBytes[a] + mCpuBytes((MemoryTag)a) > tagBytes[b] + mCpuBytes((MemoryTag)b);
+  });
+  for (int tag : order)
+  {
+    if (tagBytes[tag] == 0 && mCpuBytes((MemoryTag)tag) == 0) continue;
+    std::cout << "  " << std::left << std::setw(16) << mTagName(tag) << std::right
+              << std::setw(10) << toMB(tagBytes[tag]) << " MB GPU [" << std::setw(4) << tagObjects[tag] << "]"
+              << std::setw(10) << toMB(mCpuBytes((MemoryTag)tag)) << " MB CPU" << std::endl;
+  }
+
+  std::sort(entries.begin(), entries.end(), [sort](const Entry& a, const Entry& b)
+  {
+    if (sort == MemorySortTag && a.mTag != b.mTag) return a.mTag < b.mTag;
+    if (sort == MemorySortOwner && a.mOwner != b.mOwner) return a.mOwner < b.mOwner;
+    return a.mBytes > b.mBytes;
+  });
+
+  const char* sortName = sort == MemorySortTag ? "tag" : sort == MemorySortOwner ? "owner" : "size";
+  int shown = std::min((int)entries.size(), largest);
+  std::cout << "  GPU objects by " << sortName << " [" << shown << " of " << entries.size() << "]" << std::endl;
+  for (int i = 0; i < shown; i++)
+  {
+    const Entry& entry = entries[i];
+    const char* kind = entry.mKind == GL_BUFFER ? "buffer" : entry.mKind == GL_TEXTURE ? "texture" : "renderbuffer";
+    std::cout << "    " << std::setw(9) << toMB(entry.mBytes) << " MB  " << std::left << std::setw(13) << kind
+              << std::setw(16) << mTagName(entry.mTag) << std::right;
+    if (entry.mWidth) std::cout << entry.mWidth << "x" << entry.mHeight << " 0x" << std::hex << entry.mFormat << std::dec << "  ";
+    std::cout << entry.mOwner << std::endl;
+  }
+  std::cout << std::defaultfloat << std::setprecision(6);
+}
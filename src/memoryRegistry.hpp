@@ -0,0 +1,81 @@
+#ifndef MEMORY_REGISTRY_HEADER
+#define MEMORY_REGISTRY_HEADER
+
+#include "../glad/glad.h"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+#include "cpuMemory.hpp"
+#include "textureCompress.hpp" // textureBytes
+
+enum MemorySort
+{
+  MemorySortSize,
+  MemorySortTag,
+  MemorySortOwner,
+};
+
+// Every GL buffer / texture / renderbuffer with its size, format and owner, plus CPU bytes per
+// tag from TrackedAllocator [cpuMemory.hpp]. GL objects are tracked where they're made and released with
+// mDeleteBuffers / mDeleteTextures / mDeleteRenderbuffers instead of glDelete*
+// Any thread [the texture streamer makes textures on its own]
+//
+// The GPU budget is a total in bytes, 0 = none; going over prints a warning once [until it is
+// back under]
+class MemoryRegistry
+{
+  public:
+    size_t mGpuBudget = 0;
+    static void mSetCpuBudget(size_t bytes) { CpuMemory::mSetBudget(bytes); }
+
+    void mTrackBuffer(GLuint buffer, size_t bytes, MemoryTag tag, const char* owner);
+    void mTrackTexture(GLuint texture, GLenum format, int width, int height, int levels, int layers, MemoryTag tag, const char* owner);
+    void mTrackTexture(GLuint texture, size_t bytes, GLenum format, int width, int height, MemoryTag tag, const char* owner); // size known already
+    void mTrackRenderbuffer(GLuint renderbuffer, GLenum format, int width, int height, int samples, MemoryTag tag, const char* owner);
+
+    void mDeleteBuffers(GLsizei count, const GLuint* buffers);
+    void mDeleteTextures(GLsizei count, const GLuint* textures);
+    void mDeleteRenderbuffers(GLsizei count, const GLuint* renderbuffers);
+
+    size_t mGpuBytes();
+    size_t mGpuBytes(MemoryTag tag);
+    static size_t mCpuBytes(MemoryTag tag) { return CpuMemory::mBytes(tag); }
+    static size_t mCpuBytes() { return CpuMemory::mBytes(); }
+
+    void mPrintReport(MemorySort sort, int largest = 15);
+
+    static const char* mTagName(int tag) { return CpuMemory::mTagName(tag); }
+
+  private:
+    struct Entry
+    {
+      GLenum mKind = 0; // GL_BUFFER, GL_TEXTURE, GL_RENDERBUFFER
+      GLuint mName = 0;
+      size_t mBytes = 0;
+      GLenum mFormat = 0;
+      int mWidth = 0;
+      int mHeight = 0;
+      MemoryTag mTag = MemoryScene;
+      std::string mOwner;
+    };
+
+    std::mutex mMutex;
+    std::unordered_map<uint64_t, Entry> mEntries; // kind << 32 | name
+    size_t mTagBytes[MemoryTagCount] = {};
+    size_t mTotalBytes = 0;
+    bool mGpuWarned = false;
+
+    void mTrack(const Entry& entry);
+    void mRelease(GLenum kind, GLsizei count, const GLuint* names);
+};
+
+extern MemoryRegistry gMemory;
+
+#endif
@@ -7,26 +7,42 @@
 
 #include <vector>
 
+#include "meshlet.hpp"
+#include "cpuMemory.hpp"
+
+// counted under MemoryMeshes
+typedef TrackedVector<float, MemoryMeshes> MeshFloats;
+typedef TrackedVector<GLuint, MemoryMeshes> MeshIndices;
+
 struct Mesh3D
 {
-  GLuint mVertexArrayObject = 0;
-
-  GLuint mPositionVertexBufferObject = 0;
-  GLuint mUvVertexBufferObject = 0;
-  GLuint mNormalVertexBufferObject = 0;
-  GLuint mTangentVertexBufferObject = 0;
-  GLuint mBitangentVertexBufferObject = 0;
+  // geometry itself is uploaded once per model file into the GpuScene pool
   GLuint mTextureObject = 0;
 
   GLuint mGraphicsPipeline = 0;
   bool isLight = false;
   glm::vec3 mColor = glm::vec3(1.0);
   
-  std::vector<float> mVertexData; 
-  std::vector<float> mUvData; 
-  std::vector<float> mNormalData;
-  std::vector<float> mTangentData;
-  std::vector<float> mBitangentData;
+  MeshFloats mVertexData;
+  MeshFloats mUvData;
+  MeshFloats mNormalData;
+  MeshFloats mTangentData;
+  MeshFloats mBitangentData;
+  MeshIndices mIndexData;
+  std::vector<Meshlet> mMeshlets; // empty for low poly meshes
+
+  // object space box around every vertex
+  glm::vec3 mBoundsMin = glm::vec3(0.0f);
+  glm::vec3 mBoundsMax = glm::vec3(0.0f);
+
+  // Occluder proxy for the CPU occlusion culler, as fractions of the bounds above
+  // [a solid box that is surely inside the mesh, e.g. just the slab of a wall]
+  bool mIsOccluder = false;
+  glm::vec3 mOccluderBoxMin = glm::vec3(0.0f);
+  glm::vec3 mOccluderBoxMax = glm::vec3(1.0f);
+
+  // a door / window, its box joins the rooms on both sides [PortalVisibility]
+  bool mIsPortal = false;
 
   glm::vec3 mOffset = glm::vec3(0.0f);
   GLfloat mRotate = 0.0f; // it will rotate long y-axis
@@ -35,5 +51,12 @@ struct Mesh3D
   const char* name = "";
   const char* mModelPath = "";
   const char* mTexturePath = "";
+
+  glm::mat4 mGetModelMatrix() const
+  {
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), mOffset);
+    model = glm::rotate(model, glm::radians(mRotate), glm::vec3(0.0f, 1.0f, 0.0f));
+    return glm::scale(model, mScale);
+  }
 };
 #endif
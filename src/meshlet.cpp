@@ -0,0 +1,237 @@
+#include "../glad/glad.h"
+#include "../glm/ext/matrix_transform.hpp"
+#include "../glm/geometric.hpp"
+
+#include <vector>
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+#include "meshlet.hpp"
+#include "mesh.hpp"
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ INDEXING ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// loadObj gives us 3 separate vertices for every triangle, most of them are shared
+// so first we weld the exact duplicates [position, uv, normal, tangent, bitangent]
+
+struct VertexKey
+{
+  float mData[14];
+};
+
+struct VertexKeyHash
+{
+  size_t operator()(const VertexKey& key) const
+  {
+    // FNV-1a over the raw bytes
+    const unsigned char* bytes = (const unsigned char*)key.mData;
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(key.mData); i++)
+    {
+      hash ^= bytes[i];
+      hash *= 1099511628211ull;
+    }
+    return (size_t)hash;
+  }
+};
+
+struct VertexKeyEqual
+{
+  bool operator()(const VertexKey& a, const VertexKey& b) const
+  {
+    return memcmp(a.mData, b.mData, sizeof(a.mData)) == 0;
+  }
+};
+
+
+void buildIndexedMesh(Mesh3D* mesh)
+{
+  size_t vertexCount = mesh->mVertexData.size() / 3;
+
+  MeshFloats vertexData, uvData, normalData, tangentData, bitangentData;
+  MeshIndices indexData;
+  std::unordered_map<VertexKey, GLuint, VertexKeyHash, VertexKeyEqual> unique;
+
+  vertexData.reserve(mesh->mVertexData.size());
+  uvData.reserve(mesh->mUvData.size());
+  normalData.reserve(mesh->mNormalData.size());
+  tangentData.reserve(mesh->mTangentData.size());
+  bitangentData.reserve(mesh->mBitangentData.size());
+  indexData.reserve(vertexCount);
+  unique.reserve(vertexCount);
+
+  for (size_t i = 0; i < vertexCount; i++)
+  {
+    VertexKey key;
+    memcpy(&key.mData[0],  &mesh->mVertexData[i * 3],    3 * sizeof(float));
+    memcpy(&key.mData[3],  &mesh->mUvData[i * 2],        2 * sizeof(float));
+    memcpy(&key.mData[5],  &mesh->mNormalData[i * 3],    3 * sizeof(float));
+    memcpy(&key.mData[8],  &mesh->mTangentData[i * 3],   3 * sizeof(float));
+    memcpy(&key.mData[11], &mesh->mBitangentData[i * 3], 3 * sizeof(float));
+
+    auto found = unique.find(key);
+    if (found != unique.end())
+    {
+      indexData.push_back(found->second);
+      continue;
+    }
+
+    GLuint newIndex = (GLuint)(vertexData.size() / 3);
+    unique.emplace(key, newIndex);
+    indexData.push_back(newIndex);
+
+    vertexData.insert(vertexData.end(), &key.mData[0], &key.mData[3]);
+    uvData.insert(uvData.end(), &key.mData[3], &key.mData[5]);
+    normalData.insert(normalData.end(), &key.mData[5], &key.mData[8]);
+    tangentData.insert(tangentData.end(), &key.mData[8], &key.mData[11]);
+    bitangentData.insert(bitangentData.end(), &key.mData[11], &key.mData[14]);
+  }
+
+  mesh->mVertexData.swap(vertexData);
+  mesh->mUvData.swap(uvData);
+  mesh->mNormalData.swap(normalData);
+  mesh->mTangentData.swap(tangentData);
+  mesh->mBitangentData.swap(bitangentData);
+  mesh->mIndexData.swap(indexData);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ MESHLETS ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static glm::vec3 getPosition(const Mesh3D* mesh, GLuint index)
+{
+  return glm::vec3(mesh->mVertexData[index * 3],
+                   mesh->mVertexData[index * 3 + 1],
+                   mesh->mVertexData[index * 3 + 2]);
+}
+
+
+static void computeMeshletBounds(const Mesh3D* mesh, Meshlet* meshlet)
+{
+  const GLuint* indices = &mesh->mIndexData[meshlet->mIndexOffset];
+  GLuint indexCount = meshlet->mTriangleCount * 3;
+
+  // 1. sphere: box center + furthest vertex
+  glm::vec3 minCorner = getPosition(mesh, indices[0]);
+  glm::vec3 maxCorner = minCorner;
+  for (GLuint i = 1; i < indexCount; i++)
+  {
+    glm::vec3 p = getPosition(mesh, indices[i]);
+    minCorner = glm::min(minCorner, p);
+    maxCorner = glm::max(maxCorner, p);
+  }
+
+  meshlet->mCenter = (minCorner + maxCorner) * 0.5f;
+  meshlet->mRadius = 0.0f;
+  for (GLuint i = 0; i < indexCount; i++)
+  {
+    float distance = glm::length(getPosition(mesh, indices[i]) - meshlet->mCenter);
+    if (distance > meshlet->mRadius) meshlet->mRadius = distance;
+  }
+
+  // 2. normal cone from the winding of the triangles [that is what makes a face back facing]
+  std::vector<glm::vec3> normals;
+  normals.reserve(meshlet->mTriangleCount);
+  glm::vec3 axis = glm::vec3(0.0f);
+
+  for (GLuint i = 0; i < indexCount; i += 3)
+  {
+    glm::vec3 p0 = getPosition(mesh, indices[i]);
+    glm::vec3 p1 = getPosition(mesh, indices[i + 1]);
+    glm::vec3 p2 = getPosition(mesh, indices[i + 2]);
+    glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+
+    float length = glm::length(normal);
+    if (length < 1e-12f) continue; // degenerate triangle, can't face anywhere
+
+    normal /= length;
+    normals.push_back(normal);
+    axis += normal;
+  }
+
+  meshlet->mConeCutoff = 1.0f;
+  float axisLength = glm::length(axis);
+  if (normals.empty() || axisLength < 1e-6f) return;
+
+  axis /= axisLength;
+  float minDot = 1.0f;
+  for (const glm::vec3& normal : normals)
+  {
+    minDot = std::fmin(minDot, glm::dot(normal, axis));
+  }
+
+  meshlet->mConeAxis = axis;
+  // wider than 90 degrees means some triangle always faces the viewer
+  if (minDot > 0.0f) meshlet->mConeCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+
+// Greedy: keep adding triangles in file order until the vertex or triangle limit
+// is hit. Obj files are mostly exported in connected strips, so this stays local
+void buildMeshlets(Mesh3D* mesh)
+{
+  mesh->mMeshlets.clear();
+
+  GLuint triangleCount = (GLuint)(mesh->mIndexData.size() / 3);
+  if (triangleCount < (GLuint)MESHLET_MIN_MESH_TRIANGLES) return;
+
+  std::vector<int> vertexOwner(mesh->mVertexData.size() / 3, -1);
+  int currentId = 0;
+  Meshlet current;
+
+  for (GLuint t = 0; t < triangleCount; t++)
+  {
+    const GLuint* tri = &mesh->mIndexData[t * 3];
+
+    int newVertices = 0;
+    for (int k = 0; k < 3; k++)
+    {
+      bool repeated = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+      if (!repeated && vertexOwner[tri[k]] != currentId) newVertices++;
+    }
+
+    if (current.mTriangleCount > 0 &&
+        (current.mVertexCount + newVertices > (GLuint)MESHLET_MAX_VERTICES ||
+         current.mTriangleCount + 1 > (GLuint)MESHLET_MAX_TRIANGLES))
+    {
+      computeMeshletBounds(mesh, &current);
+      mesh->mMeshlets.push_back(current);
+
+      currentId++;
+      current = Meshlet();
+      current.mIndexOffset = t * 3;
+    }
+
+    for (int k = 0; k < 3; k++)
+    {
+      if (vertexOwner[tri[k]] != currentId)
+      {
+        vertexOwner[tri[k]] = currentId;
+        current.mVertexCount++;
+      }
+    }
+    current.mTriangleCount++;
+  }
+
+  if (current.mTriangleCount > 0)
+  {
+    computeMeshletBounds(mesh, &current);
+    mesh->mMeshlets.push_back(current);
+  }
+}
+
+
+Meshlet buildWholeMeshlet(const Mesh3D* mesh)
+{
+  Meshlet meshlet;
+  meshlet.mIndexOffset = 0;
+  meshlet.mTriangleCount = mesh->mIndexData.size() / 3;
+  meshlet.mVertexCount = mesh->mVertexData.size() / 3;
+  if (meshlet.mTriangleCount == 0) return meshlet;
+
+  computeMeshletBounds(mesh, &meshlet);
+  meshlet.mConeCutoff = 1.0f;
+  return meshlet;
+}
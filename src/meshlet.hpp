@@ -0,0 +1,38 @@
+#ifndef MESHLET_HEADER
+#define MESHLET_HEADER
+
+#include "../glad/glad.h"
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+
+struct Mesh3D;
+
+const int MESHLET_MAX_VERTICES = 64;
+const int MESHLET_MAX_TRIANGLES = 124;
+const int MESHLET_MIN_MESH_TRIANGLES = 1024; // smaller meshes are drawn in one go
+
+// A small cluster of triangles, stored as a contiguous range of the mesh index buffer
+struct Meshlet
+{
+  GLuint mIndexOffset = 0;
+  GLuint mTriangleCount = 0;
+  GLuint mVertexCount = 0;
+
+  // bounding sphere [object space]
+  glm::vec3 mCenter = glm::vec3(0.0f);
+  float mRadius = 0.0f;
+
+  // normal cone, all the triangle normals are within it
+  // mConeCutoff = sin(cone angle), 1.0 means the cone is too wide to ever cull
+  glm::vec3 mConeAxis = glm::vec3(0.0f, 1.0f, 0.0f);
+  float mConeCutoff = 1.0f;
+};
+
+void buildIndexedMesh(Mesh3D* mesh);
+void buildMeshlets(Mesh3D* mesh);
+
+// Low poly meshes are culled as one cluster, the cone is left open on purpose:
+// walls and planes are seen from both sides [GL_CULL_FACE is off]
+Meshlet buildWholeMeshlet(const Mesh3D* mesh);
+#endif
@@ -0,0 +1,277 @@
+#include "../glm/ext/matrix_transform.hpp"
+#include "../glm/geometric.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "occlusionCuller.hpp"
+
+
+// corners are numbered by bits: x = bit 0, y = bit 1, z = bit 2
+static const int gBoxTriangles[12][3] =
+{
+  {0, 2, 3}, {0, 3, 1}, // -z
+  {4, 5, 7}, {4, 7, 6}, // +z
+  {0, 4, 6}, {0, 6, 2}, // -x
+  {1, 3, 7}, {1, 7, 5}, // +x
+  {0, 1, 5}, {0, 5, 4}, // -y
+  {2, 6, 7}, {2, 7, 3}  // +y
+};
+
+
+static glm::vec3 boxCorner(glm::vec3 minCorner, glm::vec3 maxCorner, int i)
+{
+  return glm::vec3((i & 1) ? maxCorner.x : minCorner.x,
+                   (i & 2) ? maxCorner.y : minCorner.y,
+                   (i & 4) ? maxCorner.z : minCorner.z);
+}
+
+
+OcclusionCuller::OcclusionCuller()
+{
+  mDepth.assign(mWidth * mHeight, 1.0f);
+  mTileMaxDepth.assign(mTilesX * mTilesY, 1.0f);
+  mProjectionView = glm::mat4(1.0f);
+}
+
+
+void OcclusionCuller::mBeginFrame(const glm::mat4& projectionView)
+{
+  mProjectionView = projectionView;
+  std::fill(mDepth.begin(), mDepth.end(), 1.0f);
+  std::fill(mTileMaxDepth.begin(), mTileMaxDepth.end(), 1.0f);
+  mTestedObjects = 0;
+  mOccludedObjects = 0;
+}
+
+
+glm::vec3 OcclusionCuller::mToScreen(glm::vec4 clip) const
+{
+  glm::vec3 ndc = glm::vec3(clip) / clip.w;
+  return glm::vec3((ndc.x * 0.5f + 0.5f) * mWidth,
+                   (ndc.y * 0.5f + 0.5f) * mHeight,
+                   ndc.z * 0.5f + 0.5f);
+}
+
+
+void OcclusionCuller::mRenderOccluder(const glm::mat4& model, glm::vec3 localMin, glm::vec3 localMax, int rowBegin, int rowEnd)
+{
+  glm::mat4 toClip = mProjectionView * model;
+
+  glm::vec4 corners[8];
+  for (int i = 0; i < 8; i++)
+  {
+    corners[i] = toClip * glm::vec4(boxCorner(localMin, localMax, i), 1.0f);
+  }
+
+  for (int i = 0; i < 12; i++)
+  {
+    mRasterizeClipTriangle(corners[gBoxTriangles[i][0]], corners[gBoxTriangles[i][1]], corners[gBoxTriangles[i][2]], rowBegin, rowEnd);
+  }
+}
+
+
+// Clips against the near plane [z >= -w], the rest of the frustum is handled by the
+// screen bounding box. A triangle becomes at most a quad, drawn as a fan
+void OcclusionCuller::mRasterizeClipTriangle(glm::vec4 a, glm::vec4 b, glm::vec4 c, int rowBegin, int rowEnd)
+{
+  glm::vec4 input[3] = {a, b, c};
+  glm::vec4 output[4];
+  int outputCount = 0;
+
+  for (int i = 0; i < 3; i++)
+  {
+    glm::vec4 current = input[i];
+    glm::vec4 next = input[(i + 1) % 3];
+    float currentDistance = current.z + current.w;
+    float nextDistance = next.z + next.w;
+
+    if (currentDistance >= 0.0f) output[outputCount++] = current;
+    if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+    {
+      float t = currentDistance / (currentDistance - nextDistance);
+      output[outputCount++] = current + (next - current) * t;
+    }
+  }
+
+  if (outputCount < 3) return;
+
+  glm::vec3 screen[4];
+  for (int i = 0; i < outputCount; i++)
+  {
+    if (output[i].w <= 1e-6f) return;
+    screen[i] = mToScreen(output[i]);
+  }
+
+  for (int i = 1; i + 1 < outputCount; i++)
+  {
+    mRasterizeScreenTriangle(screen[0], screen[i], screen[i + 1], rowBegin, rowEnd);
+  }
+}
+
+
+// Edge functions evaluated at pixel centers, depth interpolated with the same weights
+// [z / w is linear in screen space]. Depth test keeps the nearest value, rows outside
+// [rowBegin, rowEnd) are someone else's band
+void OcclusionCuller::mRasterizeScreenTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, int rowBegin, int rowEnd)
+{
+  float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+  if (std::fabs(area) < 1e-8f) return;
+  if (area < 0.0f)
+  {
+    std::swap(b, c);
+    area = -area;
+  }
+  float invArea = 1.0f / area;
+
+  int minX = std::max(0, (int)std::floor(std::min(a.x, std::min(b.x, c.x))));
+  int maxX = std::min(mWidth - 1, (int)std::ceil(std::max(a.x, std::max(b.x, c.x))));
+  int minY = std::max(rowBegin, (int)std::floor(std::min(a.y, std::min(b.y, c.y))));
+  int maxY = std::min(rowEnd - 1, (int)std::ceil(std::max(a.y, std::max(b.y, c.y))));
+  if (minX > maxX || minY > maxY) return;
+  minX &= ~3; // 4 pixel aligned, so whole SSE lanes stay inside the row
+
+  // w0 is the weight of a [opposite edge b -> c], and so on
+  float w0dx = -(c.y - b.y), w0dy = (c.x - b.x);
+  float w1dx = -(a.y - c.y), w1dy = (a.x - c.x);
+  float w2dx = -(b.y - a.y), w2dy = (b.x - a.x);
+
+  // premultiplied depth gradients, depth = w0 * z0 + w1 * z1 + w2 * z2
+  float z0 = a.z * invArea, z1 = b.z * invArea, z2 = c.z * invArea;
+
+  float px = minX + 0.5f;
+  for (int y = minY; y <= maxY; y++)
+  {
+    float py = y + 0.5f;
+    float w0Row = w0dx * (px - b.x) + w0dy * (py - b.y);
+    float w1Row = w1dx * (px - c.x) + w1dy * (py - c.y);
+    float w2Row = w2dx * (px - a.x) + w2dy * (py - a.y);
+    float* row = &mDepth[y * mWidth];
+
+#if defined(__SSE2__)
+    const __m128 laneOffsets = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+    __m128 w0 = _mm_add_ps(_mm_set1_ps(w0Row), _mm_mul_ps(laneOffsets, _mm_set1_ps(w0dx)));
+    __m128 w1 = _mm_add_ps(_mm_set1_ps(w1Row), _mm_mul_ps(laneOffsets, _mm_set1_ps(w1dx)));
+    __m128 w2 = _mm_add_ps(_mm_set1_ps(w2Row), _mm_mul_ps(laneOffsets, _mm_set1_ps(w2dx)));
+    const __m128 w0Step = _mm_set1_ps(4.0f * w0dx);
+    const __m128 w1Step = _mm_set1_ps(4.0f * w1dx);
+    const __m128 w2Step = _mm_set1_ps(4.0f * w2dx);
+    const __m128 vz0 = _mm_set1_ps(z0), vz1 = _mm_set1_ps(z1), vz2 = _mm_set1_ps(z2);
+    const __m128 zero = _mm_setzero_ps();
+
+    for (int x = minX; x <= maxX; x += 4)
+    {
+      __m128 inside = _mm_and_ps(_mm_cmpge_ps(w0, zero), _mm_and_ps(_mm_cmpge_ps(w1, zero), _mm_cmpge_ps(w2, zero)));
+      if (_mm_movemask_ps(inside) != 0)
+      {
+        __m128 depth = _mm_add_ps(_mm_mul_ps(w0, vz0), _mm_add_ps(_mm_mul_ps(w1, vz1), _mm_mul_ps(w2, vz2)));
+        __m128 old = _mm_loadu_ps(row + x);
+        __m128 nearest = _mm_min_ps(old, depth);
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, old)));
+      }
+      w0 = _mm_add_ps(w0, w0Step);
+      w1 = _mm_add_ps(w1, w1Step);
+      w2 = _mm_add_ps(w2, w2Step);
+    }
+#else
+    for (int x = minX; x <= maxX; x++)
+    {
+      float dx = (float)(x - minX);
+      float w0 = w0Row + w0dx * dx;
+      float w1 = w1Row + w1dx * dx;
+      float w2 = w2Row + w2dx * dx;
+      if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) continue;
+
+      float depth = w0 * z0 + w1 * z1 + w2 * z2;
+      if (depth < row[x]) row[x] = depth;
+    }
+#endif
+  }
+}
+
+
+// Coarse level of the hierarchy: farthest depth of every tile
+void OcclusionCuller::mFinalize(int tileRowBegin, int tileRowEnd)
+{
+  for (int ty = tileRowBegin; ty < tileRowEnd; ty++)
+  {
+    for (int tx = 0; tx < mTilesX; tx++)
+    {
+      float tileMax = 0.0f;
+      for (int y = 0; y < mTileSize; y++)
+      {
+        const float* row = &mDepth[(ty * mTileSize + y) * mWidth + tx * mTileSize];
+#if defined(__SSE2__)
+        __m128 rowMax = _mm_max_ps(_mm_loadu_ps(row), _mm_loadu_ps(row + 4));
+        rowMax = _mm_max_ps(rowMax, _mm_shuffle_ps(rowMax, rowMax, _MM_SHUFFLE(1, 0, 3, 2)));
+        rowMax = _mm_max_ps(rowMax, _mm_shuffle_ps(rowMax, rowMax, _MM_SHUFFLE(2, 3, 0, 1)));
+        tileMax = std::max(tileMax, _mm_cvtss_f32(rowMax));
+#else
+        for (int x = 0; x < mTileSize; x++) tileMax = std::max(tileMax, row[x]);
+#endif
+      }
+      mTileMaxDepth[ty * mTilesX + tx] = tileMax;
+    }
+  }
+}
+
+
+bool OcclusionCuller::mIsVisible(glm::vec3 worldMin, glm::vec3 worldMax) const
+{
+  float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f;
+  float nearestDepth = 1.0f;
+
+  for (int i = 0; i < 8; i++)
+  {
+    glm::vec4 clip = mProjectionView * glm::vec4(boxCorner(worldMin, worldMax, i), 1.0f);
+    // box goes through the near plane, we are basically inside it
+    if (clip.z + clip.w < 0.0f || clip.w <= 1e-6f) return true;
+
+    glm::vec3 screen = mToScreen(clip);
+    minX = std::min(minX, screen.x);
+    maxX = std::max(maxX, screen.x);
+    minY = std::min(minY, screen.y);
+    maxY = std::max(maxY, screen.y);
+    nearestDepth = std::min(nearestDepth, screen.z);
+  }
+
+  int x0 = std::max(0, (int)std::floor(minX));
+  int x1 = std::min(mWidth - 1, (int)std::ceil(maxX));
+  int y0 = std::max(0, (int)std::floor(minY));
+  int y1 = std::min(mHeight - 1, (int)std::ceil(maxY));
+  if (x0 > x1 || y0 > y1) return true; // off screen, frustum culling deals with it
+
+  for (int ty = y0 / mTileSize; ty <= y1 / mTileSize; ty++)
+  {
+    for (int tx = x0 / mTileSize; tx <= x1 / mTileSize; tx++)
+    {
+      // whole tile is in front of the object
+      if (nearestDepth > mTileMaxDepth[ty * mTilesX + tx]) continue;
+
+      // tile is not conclusive, look at the pixels the rectangle covers
+      int py0 = std::max(y0, ty * mTileSize), py1 = std::min(y1, ty * mTileSize + mTileSize - 1);
+      int px0 = std::max(x0, tx * mTileSize), px1 = std::min(x1, tx * mTileSize + mTileSize - 1);
+      for (int y = py0; y <= py1; y++)
+      {
+        for (int x = px0; x <= px1; x++)
+        {
+          if (nearestDepth <= mDepth[y * mWidth + x]) return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+
+float OcclusionCuller::mGetOcclusionRatio() const
+{
+  if (mTestedObjects == 0) return 0.0f;
+  return (float)mOccludedObjects / mTestedObjects;
+}
@@ -0,0 +1,52 @@
+#ifndef OCCLUSION_CULLER_HEADER
+#define OCCLUSION_CULLER_HEADER
+
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+#include <atomic>
+
+// Software occlusion culling, fully on the CPU [no GL in here, so it can run headless]
+//
+// 1. A few big solid boxes [walls, board, podium, bench panels] are rasterized into a
+//    small depth buffer, 4 pixels at a time with SSE
+// 2. Every 8x8 tile keeps the farthest depth written into it
+// 3. An object is hidden when its nearest depth is behind everything in all the
+//    tiles [and pixels] its screen rectangle touches
+//
+// Depth is NDC z mapped to [0, 1], 1.0 is the far plane [nothing drawn there yet]
+//
+// Threads: occluders can be drawn into horizontal bands [rowBegin, rowEnd) at the same
+// time, each band finalizing its own tile rows; mIsVisible only reads, the caller adds
+// up the counts
+class OcclusionCuller
+{
+  public:
+    static const int mWidth = 256;
+    static const int mHeight = 144;
+    static const int mTileSize = 8;
+    static const int mTilesX = mWidth / mTileSize;
+    static const int mTilesY = mHeight / mTileSize;
+
+    std::atomic<int> mTestedObjects{0};
+    std::atomic<int> mOccludedObjects{0};
+
+    OcclusionCuller();
+    void mBeginFrame(const glm::mat4& projectionView);
+    void mRenderOccluder(const glm::mat4& model, glm::vec3 localMin, glm::vec3 localMax, int rowBegin = 0, int rowEnd = mHeight);
+    void mFinalize(int tileRowBegin = 0, int tileRowEnd = mTilesY);
+    bool mIsVisible(glm::vec3 worldMin, glm::vec3 worldMax) const;
+    float mGetOcclusionRatio() const;
+
+    const std::vector<float>& mGetDepth() const { return mDepth; }
+
+  private:
+    glm::mat4 mProjectionView;
+    std::vector<float> mDepth;
+    std::vector<float> mTileMaxDepth;
+
+    void mRasterizeClipTriangle(glm::vec4 a, glm::vec4 b, glm::vec4 c, int rowBegin, int rowEnd);
+    void mRasterizeScreenTriangle(glm::vec3 a, glm::vec3 b, glm::vec3 c, int rowBegin, int rowEnd);
+    glm::vec3 mToScreen(glm::vec4 clip) const;
+};
+#endif
@@ -0,0 +1,46 @@
+#include "../glad/glad.h"
+
+#include "pipelineStats.hpp"
+
+
+void PipelineStats::mBegin()
+{
+  if (!mChecked)
+  {
+    mChecked = true;
+    mSupported = GLAD_GL_VERSION_4_6 || GLAD_GL_ARB_pipeline_statistics_query;
+  }
+  if (!mSupported) return;
+
+  if (mVertexQueries[0] == 0)
+  {
+    glGenQueries(mQueryCount, mVertexQueries);
+    glGenQueries(mQueryCount, mFragmentQueries);
+  }
+
+  // this slot was used mQueryCount frames ago, both results are usually in by now
+  if (mIssued[mCurrent])
+  {
+    GLint available = 0;
+    glGetQueryObjectiv(mFragmentQueries[mCurrent], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available)
+    {
+      glGetQueryObjectui64v(mVertexQueries[mCurrent], GL_QUERY_RESULT, &mLastVertexInvocations);
+      glGetQueryObjectui64v(mFragmentQueries[mCurrent], GL_QUERY_RESULT, &mLastFragmentInvocations);
+    }
+  }
+
+  glBeginQuery(GL_VERTEX_SHADER_INVOCATIONS, mVertexQueries[mCurrent]);
+  glBeginQuery(GL_FRAGMENT_SHADER_INVOCATIONS, mFragmentQueries[mCurrent]);
+}
+
+
+void PipelineStats::mEnd()
+{
+  if (!mSupported) return;
+
+  glEndQuery(GL_FRAGMENT_SHADER_INVOCATIONS);
+  glEndQuery(GL_VERTEX_SHADER_INVOCATIONS);
+  mIssued[mCurrent] = true;
+  mCurrent = (mCurrent + 1) % mQueryCount;
+}
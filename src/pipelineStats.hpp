@@ -0,0 +1,28 @@
+#ifndef PIPELINE_STATS_HEADER
+#define PIPELINE_STATS_HEADER
+
+#include "../glad/glad.h"
+
+// Vertex / fragment shader invocations around a pass [GL 4.6 pipeline statistics queries]
+// Same ring as GpuTimer: results are picked up frames later, the CPU never waits
+// One pass at a time, GL allows one active query per target
+// Without GL 4.6 or ARB_pipeline_statistics_query nothing is queried and both stay 0
+class PipelineStats
+{
+  public:
+    GLuint64 mLastVertexInvocations = 0;
+    GLuint64 mLastFragmentInvocations = 0;
+    bool mSupported = false; // set on the first mBegin
+
+    void mBegin();
+    void mEnd();
+
+  private:
+    static const int mQueryCount = 3;
+    GLuint mVertexQueries[mQueryCount] = {};
+    GLuint mFragmentQueries[mQueryCount] = {};
+    bool mIssued[mQueryCount] = {};
+    int mCurrent = 0;
+    bool mChecked = false;
+};
+#endif
@@ -0,0 +1,240 @@
+#include "../glm/ext/matrix_transform.hpp"
+#include "../glm/geometric.hpp"
+#include "../glm/vector_relational.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "portalVisibility.hpp"
+#include "frustum.hpp"
+
+
+void PortalVisibility::mBuild(const SceneBuilding& building, const std::vector<glm::vec3>& portalMin, const std::vector<glm::vec3>& portalMax)
+{
+  mCellMin.assign(1, glm::vec3(0.0f)); // the outside, never hit by mCellAt's boxes
+  mCellMax.assign(1, glm::vec3(0.0f));
+  mPortals.clear();
+
+  glm::vec3 roomMin = glm::vec3(building.mRoomMin[0], building.mRoomMin[1], building.mRoomMin[2]);
+  glm::vec3 roomMax = glm::vec3(building.mRoomMax[0], building.mRoomMax[1], building.mRoomMax[2]);
+  glm::vec3 roomStep = glm::vec3(building.mRoomStep[0], building.mRoomStep[1], building.mRoomStep[2]);
+  glm::vec3 floorStep = glm::vec3(building.mFloorStep[0], building.mFloorStep[1], building.mFloorStep[2]);
+
+  bool haveRooms = roomMin.x < roomMax.x && roomMin.y < roomMax.y && roomMin.z < roomMax.z;
+  if (haveRooms)
+  {
+    for (uint32_t floor = 0; floor < building.mFloors; floor++)
+    {
+      for (uint32_t room = 0; room < building.mRooms; room++)
+      {
+        glm::vec3 offset = (float)floor * floorStep + (float)room * roomStep;
+        mCellMin.push_back(roomMin + offset);
+        mCellMax.push_back(roomMax + offset);
+      }
+    }
+  }
+
+  // a portal is as thin as its wall: the rectangle goes through the middle of the thin
+  // axis [x or z]. Its own room holds the center, the other cell is just past the face
+  // of that room's box the portal is closest to
+  int unconnected = 0;
+  for (size_t i = 0; haveRooms && i < portalMin.size(); i++)
+  {
+    glm::vec3 minCorner = portalMin[i];
+    glm::vec3 maxCorner = portalMax[i];
+    glm::vec3 size = maxCorner - minCorner;
+    glm::vec3 center = (minCorner + maxCorner) * 0.5f;
+
+    int thin = size.x < size.z ? 0 : 2;
+    int wide = thin == 0 ? 2 : 0;
+    glm::vec3 axis = glm::vec3(0.0f);
+    axis[thin] = 1.0f;
+
+    int room = mCellAt(center);
+    if (room == mOutside)
+    {
+      unconnected++;
+      continue;
+    }
+
+    bool towardMax = mCellMax[room][thin] - center[thin] < center[thin] - mCellMin[room][thin];
+    glm::vec3 past = center;
+    past[thin] = towardMax ? mCellMax[room][thin] + 0.01f : mCellMin[room][thin] - 0.01f;
+
+    Portal portal;
+    portal.mCells[0] = towardMax ? room : mCellAt(past);
+    portal.mCells[1] = towardMax ? mCellAt(past) : room;
+
+    for (int k = 0; k < 4; k++)
+    {
+      glm::vec3 corner;
+      corner[thin] = center[thin];
+      corner[wide] = (k == 1 || k == 2) ? maxCorner[wide] : minCorner[wide];
+      corner.y = k >= 2 ? maxCorner.y : minCorner.y;
+      portal.mCorners[k] = corner;
+    }
+    portal.mPlane = glm::vec4(axis, -center[thin]);
+    mPortals.push_back(portal);
+  }
+
+  mCellPortals.assign(mCellMin.size(), std::vector<int>());
+  for (size_t i = 0; i < mPortals.size(); i++)
+  {
+    mCellPortals[mPortals[i].mCells[0]].push_back(i);
+    mCellPortals[mPortals[i].mCells[1]].push_back(i);
+  }
+
+  mVisible.assign(mCellMin.size(), 1);
+  mOnPath.assign(mCellMin.size(), 0);
+
+  std::cout << "Portals: " << mCellMin.size() - 1 << " rooms + outside, " << mPortals.size() << " portals";
+  if (unconnected) std::cout << ", " << unconnected << " outside every room [ignored]";
+  std::cout << std::endl;
+}
+
+
+// by the center of the box, an instance on a wall goes with the room the box holds
+void PortalVisibility::mAssignInstances(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax)
+{
+  mInstanceCell.resize(boundsMin.size());
+  for (size_t i = 0; i < boundsMin.size(); i++) mInstanceCell[i] = mCellAt((boundsMin[i] + boundsMax[i]) * 0.5f);
+}
+
+
+int PortalVisibility::mCellAt(glm::vec3 point) const
+{
+  for (size_t i = 1; i < mCellMin.size(); i++)
+  {
+    if (point.x >= mCellMin[i].x && point.y >= mCellMin[i].y && point.z >= mCellMin[i].z &&
+        point.x <= mCellMax[i].x && point.y <= mCellMax[i].y && point.z <= mCellMax[i].z) return (int)i;
+  }
+  return mOutside;
+}
+
+
+void PortalVisibility::mUpdate(const glm::mat4& projectionView, glm::vec3 eye)
+{
+  mVisitedCells = 0;
+  mTestedPortals = 0;
+  if (!mHasCells()) return; // everything stays visible
+
+  std::fill(mVisible.begin(), mVisible.end(), 0);
+
+  Frustum view(projectionView);
+  Planes frustum;
+  for (int i = 0; i < 6; i++) frustum.mPlane[frustum.mCount++] = view.mPlanes[i];
+  mFarPlane = view.mPlanes[5];
+  mEye = eye;
+
+  mVisit(mCellAt(eye), frustum, 0);
+}
+
+
+void PortalVisibility::mVisit(int cell, const Planes& frustum, int depth)
+{
+  if (!mVisible[cell]) mVisitedCells++;
+  mVisible[cell] = 1;
+  if (depth >= mMaxDepth) return;
+
+  mOnPath[cell] = 1; // no going back the way we came
+  for (int index : mCellPortals[cell])
+  {
+    const Portal& portal = mPortals[index];
+    int next = portal.mCells[0] == cell ? portal.mCells[1] : portal.mCells[0];
+    if (mOnPath[next]) continue;
+    mTestedPortals++;
+
+    // negative: the eye is on this cell's side, looking through it is possible
+    float distance = glm::dot(glm::vec3(portal.mPlane), mEye) + portal.mPlane.w;
+    if (portal.mCells[1] == cell) distance = -distance;
+    if (distance > 0.05f) continue;
+
+    // standing in the doorway, planes through the eye and the portal would be flat [and
+    // the near plane clips it all away]
+    glm::vec3 low = glm::min(portal.mCorners[0], portal.mCorners[2]) - glm::vec3(0.05f);
+    glm::vec3 high = glm::max(portal.mCorners[0], portal.mCorners[2]) + glm::vec3(0.05f);
+    bool inside = glm::all(glm::greaterThanEqual(mEye, low)) && glm::all(glm::lessThanEqual(mEye, high));
+    if (inside)
+    {
+      mVisit(next, frustum, depth + 1);
+      continue;
+    }
+
+    glm::vec3 points[mMaxPoints];
+    int count = mClip(portal, frustum, points);
+    if (count < 3) continue;
+
+    glm::vec3 centroid = glm::vec3(0.0f);
+    for (int i = 0; i < count; i++) centroid += points[i];
+    centroid /= (float)count;
+
+    Planes narrowed;
+    for (int i = 0; i < count; i++)
+    {
+      glm::vec3 normal = glm::cross(points[i] - mEye, points[(i + 1) % count] - mEye);
+      float length = glm::length(normal);
+      if (length < 1e-6f) continue; // edge seen end on, leaving it out only widens the frustum
+
+      normal /= length;
+      if (glm::dot(normal, centroid - mEye) < 0.0f) normal = -normal;
+      narrowed.mPlane[narrowed.mCount++] = glm::vec4(normal, -glm::dot(normal, mEye));
+    }
+    narrowed.mPlane[narrowed.mCount++] = portal.mCells[0] == cell ? portal.mPlane : -portal.mPlane; // only past the portal
+    narrowed.mPlane[narrowed.mCount++] = mFarPlane;
+
+    mVisit(next, narrowed, depth + 1);
+  }
+  mOnPath[cell] = 0;
+}
+
+
+// Sutherland-Hodgman, the portal rectangle against every plane of the frustum
+int PortalVisibility::mClip(const Portal& portal, const Planes& frustum, glm::vec3* points) const
+{
+  glm::vec3 buffer[mMaxPoints];
+  glm::vec3* in = points;
+  glm::vec3* out = buffer;
+
+  int count = 4;
+  for (int i = 0; i < 4; i++) in[i] = portal.mCorners[i];
+
+  for (int p = 0; p < frustum.mCount && count >= 3; p++)
+  {
+    // a plane can add one point, past the buffer the polygon is just left bigger
+    if (count + 1 > mMaxPoints) break;
+
+    const glm::vec4& plane = frustum.mPlane[p];
+    int outCount = 0;
+    for (int i = 0; i < count; i++)
+    {
+      glm::vec3 a = in[i];
+      glm::vec3 b = in[(i + 1) % count];
+      float da = glm::dot(glm::vec3(plane), a) + plane.w;
+      float db = glm::dot(glm::vec3(plane), b) + plane.w;
+
+      if (da >= 0.0f) out[outCount++] = a;
+      if ((da >= 0.0f) != (db >= 0.0f)) out[outCount++] = a + (b - a) * (da / (da - db));
+    }
+
+    std::swap(in, out);
+    count = outCount;
+  }
+
+  if (in != points) std::copy(in, in + count, points);
+  return count;
+}
+
+
+uint32_t PortalVisibility::mLightMask(const glm::vec3* positions, int count) const
+{
+  if (!mHasCells()) return 0xFFFFFFFF;
+
+  uint32_t mask = 0;
+  for (int i = 0; i < count && i < 32; i++)
+  {
+    if (mVisible[mCellAt(positions[i])]) mask |= 1u << i;
+  }
+  return mask;
+}
@@ -0,0 +1,74 @@
+#ifndef PORTAL_VISIBILITY_HEADER
+#define PORTAL_VISIBILITY_HEADER
+
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+#include <cstdint>
+
+#include "sceneFile.hpp"
+
+// Cell and portal visibility, on the CPU [no GL, like the occlusion culler]
+//
+// Cells: every room of the building [the scene's "room" box, tiled like the instances]
+// plus cell 0, the outside. Portals: the "portal" instances [door frame, windows], each
+// one a rectangle in the middle of its wall, joining whatever cells are on either side
+//
+// Every frame the camera's cell is visited with the view frustum, a portal in front of the
+// eye is clipped by the frustum and, when something is left, the cell behind it is visited
+// with a frustum made of the eye and the clipped polygon. Instances [and lights] of cells
+// never visited are dropped before the GPU cull
+class PortalVisibility
+{
+  public:
+    static const int mOutside = 0;
+    int mMaxDepth = 8; // portals in a row
+
+    // last mUpdate
+    int mVisitedCells = 0;
+    int mTestedPortals = 0;
+
+    void mBuild(const SceneBuilding& building, const std::vector<glm::vec3>& portalMin, const std::vector<glm::vec3>& portalMax);
+    void mAssignInstances(const std::vector<glm::vec3>& boundsMin, const std::vector<glm::vec3>& boundsMax);
+    bool mHasCells() const { return mCellMin.size() > 1; }
+    int mCellCount() const { return (int)mCellMin.size(); }
+    int mPortalCount() const { return (int)mPortals.size(); }
+    int mCellAt(glm::vec3 point) const;
+
+    void mUpdate(const glm::mat4& projectionView, glm::vec3 eye);
+    bool mIsCellVisible(int cell) const { return mVisible[cell] != 0; }
+    bool mIsInstanceVisible(size_t instance) const { return mVisible[mInstanceCell[instance]] != 0; }
+    uint32_t mLightMask(const glm::vec3* positions, int count) const; // bit i = light i's cell was visited
+
+  private:
+    static const int mMaxPoints = 24;
+    static const int mMaxPlanes = mMaxPoints + 2; // an edge each + the portal + the far plane
+
+    struct Portal
+    {
+      glm::vec3 mCorners[4];
+      glm::vec4 mPlane; // normal goes from mCells[0] into mCells[1]
+      int mCells[2];
+    };
+
+    struct Planes
+    {
+      glm::vec4 mPlane[mMaxPlanes]; // pointing inside
+      int mCount = 0;
+    };
+
+    std::vector<glm::vec3> mCellMin;
+    std::vector<glm::vec3> mCellMax;
+    std::vector<Portal> mPortals;
+    std::vector<std::vector<int>> mCellPortals;
+    std::vector<uint32_t> mInstanceCell;
+
+    std::vector<unsigned char> mVisible;
+    std::vector<unsigned char> mOnPath;
+    glm::vec3 mEye;
+    glm::vec4 mFarPlane;
+
+    void mVisit(int cell, const Planes& frustum, int depth);
+    int mClip(const Portal& portal, const Planes& frustum, glm::vec3* points) const;
+};
+#endif
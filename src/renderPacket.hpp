@@ -0,0 +1,60 @@
+#ifndef RENDER_PACKET_HEADER
+#define RENDER_PACKET_HEADER
+
+#include "../glad/glad.h"
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#include "spscRing.hpp"
+#include "debugDraw.hpp"
+
+// Everything the render thread needs for one frame, made by the simulation thread
+// [main.cpp, BuildPacket] and not touched by it again until the render thread is done
+// with it. Slots are reused, the vectors only grow
+struct RenderPacket
+{
+  uint64_t mFrame = 0;
+  bool mQuit = false; // last one, the render thread lets go of the context
+  bool mPresentOnly = false; // idle, nothing below is set: the scene target is shown again
+
+  // camera
+  glm::mat4 mView = glm::mat4(1.0f);
+  glm::mat4 mProjection = glm::mat4(1.0f);
+  glm::mat4 mProjectionView = glm::mat4(1.0f);
+  glm::vec3 mViewPos = glm::vec3(0.0f);
+
+  // switches as they were for this frame
+  int mIsPhong = 1;
+  bool mConeCulling = true;
+  bool mInstanceFlags = false; // mVisibility is filled [portal and / or CPU occlusion]
+  bool mHiZCulling = true;
+  bool mOverlay = false;
+
+  // simulation side timings, for the overlay
+  float mFrameMs = 0.0f;
+  float mCpuCullMs = 0.0f;
+
+  // visibility + lights
+  std::vector<GLuint> mVisibility; // one flag per instance
+  GLuint mActiveLights = 0xFFFFFFFF;
+  std::vector<GLuint> mLightMasks; // empty unless they were redone
+
+  // instances that moved since the last packet
+  std::vector<GLuint> mMoved;
+  std::vector<glm::mat4> mMovedModels;
+  std::vector<glm::mat3> mMovedNormals;
+
+  // DebugDraw's lines, empty when it is off
+  std::vector<DebugVertex> mDebugLines;
+
+  // input for this frame was read then [glfwPollEvents], for the input -> swap latency
+  std::chrono::steady_clock::time_point mInputTime;
+};
+
+// Double buffered: frame N is drawn while N + 1 is made. 3 would ride out render spikes
+// better, at one more frame of input latency
+typedef SpscRing<RenderPacket, 2> RenderPacketQueue;
+#endif
@@ -0,0 +1,164 @@
+#include "../glad/glad.h"
+
+#include <iostream>
+#include <algorithm>
+
+#include "renderTarget.hpp"
+#include "shader.hpp"
+#include "counters.hpp"
+#include "memoryRegistry.hpp"
+
+
+bool RenderTarget::mCreate(int width, int height, int samples)
+{
+  GLint maxSamples = 1;
+  glGetIntegerv(GL_MAX_SAMPLES, &maxSamples);
+
+  mWidth = width;
+  mHeight = height;
+  mSamples = std::max(1, std::min(samples, (int)maxSamples));
+  mRenderWidth = width;
+  mRenderHeight = height;
+
+  // 1. multisampled scene
+  glGenRenderbuffers(1, &mColorRenderBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, mColorRenderBuffer);
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, mSamples, GL_RGBA8, mWidth, mHeight);
+  gMemory.mTrackRenderbuffer(mColorRenderBuffer, GL_RGBA8, mWidth, mHeight, mSamples, MemoryRenderTargets, "scene color");
+
+  glGenRenderbuffers(1, &mDepthRenderBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, mDepthRenderBuffer);
+  glRenderbufferStorageMultisample(GL_RENDERBUFFER, mSamples, GL_DEPTH_COMPONENT32F, mWidth, mHeight);
+  gMemory.mTrackRenderbuffer(mDepthRenderBuffer, GL_DEPTH_COMPONENT32F, mWidth, mHeight, mSamples, MemoryRenderTargets, "scene depth");
+  glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+  glGenFramebuffers(1, &mFrameBufferObject);
+  glBindFramebuffer(GL_FRAMEBUFFER, mFrameBufferObject);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, mColorRenderBuffer);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, mDepthRenderBuffer);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+  {
+    std::cout << "Scene framebuffer is not complete" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return false;
+  }
+
+  // 2. resolved depth, same format so the blit is a plain copy of one sample
+  glGenTextures(1, &mDepthTexture);
+  glBindTexture(GL_TEXTURE_2D, mDepthTexture);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT32F, mWidth, mHeight);
+  gMemory.mTrackTexture(mDepthTexture, GL_DEPTH_COMPONENT32F, mWidth, mHeight, 1, 1, MemoryRenderTargets, "resolved depth");
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenFramebuffers(1, &mResolveFrameBufferObject);
+  glBindFramebuffer(GL_FRAMEBUFFER, mResolveFrameBufferObject);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, mDepthTexture, 0);
+  glDrawBuffer(GL_NONE);
+  glReadBuffer(GL_NONE);
+
+  bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+  if (!complete) std::cout << "Depth resolve framebuffer is not complete" << std::endl;
+
+  // 3. resolved color for the upscale, filtered, the edge texels repeat outside
+  glGenTextures(1, &mColorTexture);
+  glBindTexture(GL_TEXTURE_2D, mColorTexture);
+  glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, mWidth, mHeight);
+  gMemory.mTrackTexture(mColorTexture, GL_RGBA8, mWidth, mHeight, 1, 1, MemoryRenderTargets, "resolved color");
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenFramebuffers(1, &mColorFrameBufferObject);
+  glBindFramebuffer(GL_FRAMEBUFFER, mColorFrameBufferObject);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, mColorTexture, 0);
+
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+  {
+    std::cout << "Color resolve framebuffer is not complete" << std::endl;
+    complete = false;
+  }
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+  Shader shader;
+  mUpscaleProgram = shader.mCreateGraphicsPipeline("shaders/upscale/vert.glsl", "shaders/upscale/frag.glsl");
+  glGenVertexArrays(1, &mEmptyVertexArray);
+
+  return complete && mUpscaleProgram != 0;
+}
+
+
+void RenderTarget::mSetRenderSize(int width, int height)
+{
+  mRenderWidth = std::min(std::max(width, 1), mWidth);
+  mRenderHeight = std::min(std::max(height, 1), mHeight);
+}
+
+
+void RenderTarget::mBind()
+{
+  glBindFramebuffer(GL_FRAMEBUFFER, mFrameBufferObject);
+  glViewport(0, 0, mRenderWidth, mRenderHeight);
+}
+
+
+// Only the drawn corner, the rest of mDepthTexture is whatever an earlier bigger frame left
+// there. The pyramid never reads it [DepthPyramid::mBuild gets the same size]
+void RenderTarget::mResolveDepth()
+{
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, mFrameBufferObject);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mResolveFrameBufferObject);
+  glBlitFramebuffer(0, 0, mRenderWidth, mRenderHeight, 0, 0, mRenderWidth, mRenderHeight, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+
+  // back to drawing the scene
+  glBindFramebuffer(GL_FRAMEBUFFER, mFrameBufferObject);
+}
+
+
+void RenderTarget::mPresent(float sharpness)
+{
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, mFrameBufferObject);
+
+  if (mRenderWidth == mWidth && mRenderHeight == mHeight)
+  {
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+    glBlitFramebuffer(0, 0, mWidth, mHeight, 0, 0, mWidth, mHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glViewport(0, 0, mWidth, mHeight);
+    return;
+  }
+
+  // a multisampled blit can't scale, so resolve at the render size first
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, mColorFrameBufferObject);
+  glBlitFramebuffer(0, 0, mRenderWidth, mRenderHeight, 0, 0, mRenderWidth, mRenderHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glViewport(0, 0, mWidth, mHeight);
+  glDisable(GL_DEPTH_TEST);
+
+  glUseProgram(mUpscaleProgram);
+  GLint location = glGetUniformLocation(mUpscaleProgram, "u_renderSize");
+  glUniform2f(location, (float)mRenderWidth, (float)mRenderHeight);
+  location = glGetUniformLocation(mUpscaleProgram, "u_sharpness");
+  glUniform1f(location, sharpness);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, mColorTexture);
+  location = glGetUniformLocation(mUpscaleProgram, "u_source");
+  glUniform1i(location, 0);
+
+  glBindVertexArray(mEmptyVertexArray);
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+  glBindVertexArray(0);
+  glEnable(GL_DEPTH_TEST);
+
+  Counters::mAdd(CounterVertexArrayBinds);
+  Counters::mAdd(CounterProgramBinds);
+  Counters::mAdd(CounterTextureBinds);
+  Counters::mAdd(CounterDrawCalls);
+}
@@ -0,0 +1,45 @@
+#ifndef RENDER_TARGET_HEADER
+#define RENDER_TARGET_HEADER
+
+#include "../glad/glad.h"
+
+// Offscreen multisampled framebuffer the scene is drawn into
+// [the window itself has no samples, so its depth can't be read back in a known format]
+//
+// mResolveDepth copies one depth sample per pixel into mDepthTexture [input of the Hi-Z pyramid]
+// mPresent resolves the color into the window
+//
+// Dynamic resolution draws into the bottom left mRenderWidth x mRenderHeight of it
+// [mSetRenderSize, nothing is reallocated], mPresent then resolves that corner into
+// mColorTexture and stretches it over the window with a sharpening pass
+// [shaders/upscale]. At full size it is the plain blit
+class RenderTarget
+{
+  public:
+    int mWidth = 0;
+    int mHeight = 0;
+    int mSamples = 0;
+    int mRenderWidth = 0;  // what this frame draws into, <= mWidth x mHeight
+    int mRenderHeight = 0;
+
+    GLuint mFrameBufferObject = 0;
+    GLuint mColorRenderBuffer = 0;
+    GLuint mDepthRenderBuffer = 0;
+
+    GLuint mResolveFrameBufferObject = 0;
+    GLuint mDepthTexture = 0; // GL_DEPTH_COMPONENT32F, single sample
+
+    GLuint mColorFrameBufferObject = 0;
+    GLuint mColorTexture = 0; // GL_RGBA8, single sample, the upscale pass reads it
+
+    bool mCreate(int width, int height, int samples);
+    void mSetRenderSize(int width, int height);
+    void mBind();
+    void mResolveDepth();
+    void mPresent(float sharpness = 0.0f); // leaves the window bound with its full viewport
+
+  private:
+    GLuint mUpscaleProgram = 0;
+    GLuint mEmptyVertexArray = 0; // the fullscreen triangle comes from gl_VertexID
+};
+#endif
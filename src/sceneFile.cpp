@@ -0,0 +1,666 @@
+#include <iostream>
+#include <string>
+#include <map>
+#include <set>
+#include <utility>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "sceneFile.hpp"
+#include "assetArchive.hpp"
+
+static const char gMagic[4] = {'S', 'C', 'N', 'E'};
+static const uint32_t gVersion = 3;
+static const uint32_t gMaxLights = 9; // one shadow map sampler each in the shaders
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ JSON ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// Just enough JSON for scene files: no escapes beyond \" and \\, // comments and
+// trailing commas are fine
+struct JsonValue
+{
+  enum Type { Null, Bool, Number, String, Array, Object } mType = Null;
+  bool mBool = false;
+  double mNumber = 0.0;
+  std::string mString;
+  std::vector<JsonValue> mItems;
+  std::vector<std::pair<std::string, JsonValue>> mMembers;
+  int mLine = 0;
+
+  const JsonValue* mGet(const char* key) const
+  {
+    for (const auto& member : mMembers) if (member.first == key) return &member.second;
+    return nullptr;
+  }
+};
+
+
+class JsonParser
+{
+  public:
+    JsonParser(const char* text, size_t size) : mAt(text), mEnd(text + size) {}
+
+    bool mParse(JsonValue* value)
+    {
+      if (!mValue(value)) return false;
+      mSkip();
+      return mAt == mEnd || mFail("text after the end");
+    }
+
+    std::string mError;
+
+  private:
+    const char* mAt;
+    const char* mEnd;
+    int mLine = 1;
+
+    bool mFail(const char* what)
+    {
+      mError = "line " + std::to_string(mLine) + ": " + what;
+      return false;
+    }
+
+    void mSkip()
+    {
+      while (mAt < mEnd)
+      {
+        if (*mAt == '\n') mLine++;
+        if (*mAt == ' ' || *mAt == '\t' || *mAt == '\r' || *mAt == '\n') mAt++;
+        else if (*mAt == '/' && mAt + 1 < mEnd && mAt[1] == '/') while (mAt < mEnd && *mAt != '\n') mAt++;
+        else break;
+      }
+    }
+
+    bool mWord(const char* word)
+    {
+      size_t length = strlen(word);
+      if ((size_t)(mEnd - mAt) < length || strncmp(mAt, word, length) != 0) return false;
+      mAt += length;
+      return true;
+    }
+
+    bool mStringValue(std::string* out)
+    {
+      mAt++; // "
+      while (mAt < mEnd && *mAt != '"')
+      {
+        if (*mAt == '\n') return mFail("string not closed");
+        if (*mAt == '\\' && mAt + 1 < mEnd) mAt++;
+        out->push_back(*mAt++);
+      }
+      if (mAt == mEnd) return mFail("string not closed");
+      mAt++;
+      return true;
+    }
+
+    bool mValue(JsonValue* value)
+    {
+      mSkip();
+      value->mLine = mLine;
+      if (mAt == mEnd) return mFail("unexpected end");
+
+      if (*mAt == '{')
+      {
+        value->mType = JsonValue::Object;
+        mAt++;
+        while (true)
+        {
+          mSkip();
+          if (mAt < mEnd && *mAt == '}') { mAt++; return true; }
+          if (mAt == mEnd || *mAt != '"') return mFail("expected a \"key\"");
+
+          std::string key;
+          if (!mStringValue(&key)) return false;
+          mSkip();
+          if (mAt == mEnd || *mAt != ':') return mFail("expected ':'");
+          mAt++;
+
+          value->mMembers.emplace_back(key, JsonValue());
+          if (!mValue(&value->mMembers.back().second)) return false;
+
+          mSkip();
+          if (mAt < mEnd && *mAt == ',') mAt++;
+          else if (mAt == mEnd || *mAt != '}') return mFail("expected ',' or '}'");
+        }
+      }
+
+      if (*mAt == '[')
+      {
+        value->mType = JsonValue::Array;
+        mAt++;
+        while (true)
+        {
+          mSkip();
+          if (mAt < mEnd && *mAt == ']') { mAt++; return true; }
+
+          value->mItems.emplace_back();
+          if (!mValue(&value->mItems.back())) return false;
+
+          mSkip();
+          if (mAt < mEnd && *mAt == ',') mAt++;
+          else if (mAt == mEnd || *mAt != ']') return mFail("expected ',' or ']'");
+        }
+      }
+
+      if (*mAt == '"')
+      {
+        value->mType = JsonValue::String;
+        return mStringValue(&value->mString);
+      }
+
+      if (mWord("true"))
+      {
+        value->mType = JsonValue::Bool;
+        value->mBool = true;
+        return true;
+      }
+      if (mWord("false"))
+      {
+        value->mType = JsonValue::Bool;
+        return true;
+      }
+      if (mWord("null")) return true;
+
+      // strtod wants a terminated string, numbers are short
+      char number[64];
+      size_t length = 0;
+      while (mAt + length < mEnd && length < sizeof(number) - 1 && strchr("+-.0123456789eE", mAt[length])) length++;
+      memcpy(number, mAt, length);
+      number[length] = '\0';
+
+      char* parsedEnd = nullptr;
+      value->mNumber = strtod(number, &parsedEnd);
+      if (length == 0 || parsedEnd != number + length) return mFail("expected a value");
+      value->mType = JsonValue::Number;
+      mAt += length;
+      return true;
+    }
+};
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ COMPILER ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+struct SceneCompiler
+{
+  std::string mError;
+  std::vector<SceneAsset> mAssets;
+  std::vector<SceneInstance> mInstances;
+  std::vector<SceneLight> mLights;
+  std::string mStrings;
+  std::map<std::string, uint32_t> mStringOffsets;
+  std::map<std::string, uint32_t> mAssetIndex;
+  SceneBuilding mBuilding = {1, 1, {-16.0f, 0.0f, 0.0f}, {0.0f, 5.2f, 0.0f}, 0.0f, 0.0f, 1, {0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+
+  bool mFail(const JsonValue& at, const std::string& what)
+  {
+    mError = "line " + std::to_string(at.mLine) + ": " + what;
+    return false;
+  }
+
+  uint32_t mAddString(const std::string& text)
+  {
+    auto found = mStringOffsets.find(text);
+    if (found != mStringOffsets.end()) return found->second;
+
+    uint32_t offset = (uint32_t)mStrings.size();
+    mStrings += text;
+    mStrings.push_back('\0');
+    mStringOffsets[text] = offset;
+    return offset;
+  }
+
+  bool mVec3(const JsonValue& object, const char* key, float* out, bool required)
+  {
+    const JsonValue* value = object.mGet(key);
+    if (!value) return !required || mFail(object, std::string("missing \"") + key + "\"");
+
+    if (value->mType != JsonValue::Array || value->mItems.size() != 3) return mFail(*value, std::string(key) + " wants [x, y, z]");
+    for (int i = 0; i < 3; i++)
+    {
+      if (value->mItems[i].mType != JsonValue::Number) return mFail(*value, std::string(key) + " wants numbers");
+      out[i] = (float)value->mItems[i].mNumber;
+    }
+    return true;
+  }
+
+  bool mNumber(const JsonValue& object, const char* key, double* out)
+  {
+    const JsonValue* value = object.mGet(key);
+    if (!value) return true; // keeps the default
+    if (value->mType != JsonValue::Number) return mFail(*value, std::string(key) + " wants a number");
+    *out = value->mNumber;
+    return true;
+  }
+
+  bool mText(const JsonValue& object, const char* key, std::string* out, bool required)
+  {
+    const JsonValue* value = object.mGet(key);
+    if (!value) return !required || mFail(object, std::string("missing \"") + key + "\"");
+    if (value->mType != JsonValue::String) return mFail(*value, std::string(key) + " wants a string");
+    *out = value->mString;
+    return true;
+  }
+
+  bool mAsset(const JsonValue& object)
+  {
+    if (object.mType != JsonValue::Object) return mFail(object, "an asset is an object");
+
+    std::string name, model, texture, pipeline = "default";
+    SceneAsset asset = {};
+    asset.mOccluderMax[0] = asset.mOccluderMax[1] = asset.mOccluderMax[2] = 1.0f;
+
+    if (!mText(object, "name", &name, true) || !mText(object, "model", &model, true) ||
+        !mText(object, "texture", &texture, false) || !mText(object, "pipeline", &pipeline, false) ||
+        !mVec3(object, "scale", asset.mScale, true) || !mVec3(object, "color", asset.mColor, false))
+      return false;
+
+    if (mAssetIndex.count(name)) return mFail(object, "asset \"" + name + "\" is there twice");
+
+    if (pipeline == "default") asset.mPipeline = ScenePipelineDefault;
+    else if (pipeline == "normals") asset.mPipeline = ScenePipelineNormals;
+    else if (pipeline == "ceilingLight") asset.mPipeline = ScenePipelineCeilingLight;
+    else return mFail(object, "pipeline is default, normals or ceilingLight");
+
+    const JsonValue* light = object.mGet("light");
+    if (light && light->mType == JsonValue::Bool && light->mBool) asset.mFlags |= SceneAssetLight;
+    const JsonValue* jitter = object.mGet("jitter");
+    if (jitter && jitter->mType == JsonValue::Bool && jitter->mBool) asset.mFlags |= SceneAssetJitter;
+    const JsonValue* portal = object.mGet("portal");
+    if (portal && portal->mType == JsonValue::Bool && portal->mBool) asset.mFlags |= SceneAssetPortal;
+
+    const JsonValue* occluder = object.mGet("occluder");
+    if (occluder)
+    {
+      if (!mVec3(*occluder, "min", asset.mOccluderMin, true) || !mVec3(*occluder, "max", asset.mOccluderMax, true)) return false;
+      asset.mFlags |= SceneAssetOccluder;
+    }
+
+    asset.mName = mAddString(name);
+    asset.mModelPath = mAddString(model);
+    asset.mTexturePath = mAddString(texture);
+
+    mAssetIndex[name] = (uint32_t)mAssets.size();
+    mAssets.push_back(asset);
+    return true;
+  }
+
+  // at + column * column_step + row * row_step, columns outside, rows inside
+  bool mGrid(const JsonValue& object, std::vector<std::pair<int, int>>* cells, float* at, float* columnStep, float* rowStep)
+  {
+    double columns = 1, rows = 1;
+    columnStep[0] = columnStep[1] = columnStep[2] = 0.0f;
+    rowStep[0] = rowStep[1] = rowStep[2] = 0.0f;
+
+    if (!mVec3(object, "at", at, true) || !mNumber(object, "columns", &columns) || !mNumber(object, "rows", &rows) ||
+        !mVec3(object, "column_step", columnStep, false) || !mVec3(object, "row_step", rowStep, false))
+      return false;
+    if (columns < 1 || rows < 1) return mFail(object, "columns and rows start at 1");
+
+    std::set<std::pair<int, int>> skipped;
+    const JsonValue* skip = object.mGet("skip");
+    if (skip)
+    {
+      if (skip->mType != JsonValue::Array) return mFail(*skip, "skip wants [[column, row], ...]");
+      for (const JsonValue& cell : skip->mItems)
+      {
+        if (cell.mType != JsonValue::Array || cell.mItems.size() != 2) return mFail(cell, "skip wants [[column, row], ...]");
+        skipped.insert(std::make_pair((int)cell.mItems[0].mNumber, (int)cell.mItems[1].mNumber));
+      }
+    }
+
+    for (int column = 0; column < (int)columns; column++)
+    {
+      for (int row = 0; row < (int)rows; row++)
+      {
+        if (!skipped.count(std::make_pair(column, row))) cells->push_back(std::make_pair(column, row));
+      }
+    }
+    return true;
+  }
+
+  bool mInstance(const JsonValue& object, std::map<uint32_t, int>& counts)
+  {
+    if (object.mType != JsonValue::Object) return mFail(object, "an instance is an object");
+
+    std::string assetName;
+    if (!mText(object, "asset", &assetName, true)) return false;
+    auto asset = mAssetIndex.find(assetName);
+    if (asset == mAssetIndex.end()) return mFail(object, "no asset \"" + assetName + "\"");
+
+    double rotate = 0.0;
+    if (!mNumber(object, "rotate", &rotate)) return false;
+
+    std::vector<std::pair<int, int>> cells;
+    float at[3], columnStep[3], rowStep[3];
+    if (!mGrid(object, &cells, at, columnStep, rowStep)) return false;
+
+    for (const auto& cell : cells)
+    {
+      SceneInstance instance = {};
+      instance.mAsset = asset->second;
+      instance.mName = mAddString(assetName + " " + std::to_string(counts[asset->second]++));
+      instance.mRotate = (float)rotate;
+      for (int i = 0; i < 3; i++) instance.mOffset[i] = at[i] + cell.first * columnStep[i] + cell.second * rowStep[i];
+      mInstances.push_back(instance);
+    }
+    return true;
+  }
+
+  bool mLight(const JsonValue& object)
+  {
+    if (object.mType != JsonValue::Object) return mFail(object, "a light is an object");
+
+    std::vector<std::pair<int, int>> cells;
+    float at[3], columnStep[3], rowStep[3];
+    if (!mGrid(object, &cells, at, columnStep, rowStep)) return false;
+
+    for (const auto& cell : cells)
+    {
+      SceneLight light = {};
+      for (int i = 0; i < 3; i++) light.mPosition[i] = at[i] + cell.first * columnStep[i] + cell.second * rowStep[i];
+      mLights.push_back(light);
+    }
+    return mLights.size() <= gMaxLights || mFail(object, "more than 9 lights");
+  }
+
+  bool mReadBuilding(const JsonValue& object)
+  {
+    if (object.mType != JsonValue::Object) return mFail(object, "building is an object");
+
+    double floors = mBuilding.mFloors, rooms = mBuilding.mRooms, seed = mBuilding.mSeed;
+    double jitter = mBuilding.mJitter, jitterRotate = mBuilding.mJitterRotate;
+    if (!mNumber(object, "floors", &floors) || !mNumber(object, "rooms", &rooms) || !mNumber(object, "seed", &seed) ||
+        !mNumber(object, "jitter", &jitter) || !mNumber(object, "jitter_rotate", &jitterRotate) ||
+        !mVec3(object, "room_step", mBuilding.mRoomStep, false) || !mVec3(object, "floor_step", mBuilding.mFloorStep, false))
+      return false;
+    if (floors < 1 || rooms < 1) return mFail(object, "floors and rooms start at 1");
+    if (jitter < 0 || jitterRotate < 0 || seed < 0) return mFail(object, "jitter and seed can't be negative");
+
+    const JsonValue* room = object.mGet("room");
+    if (room)
+    {
+      if (!mVec3(*room, "min", mBuilding.mRoomMin, true) || !mVec3(*room, "max", mBuilding.mRoomMax, true)) return false;
+      for (int i = 0; i < 3; i++) if (mBuilding.mRoomMin[i] >= mBuilding.mRoomMax[i]) return mFail(*room, "room min has to be below max");
+    }
+
+    mBuilding.mFloors = (uint32_t)floors;
+    mBuilding.mRooms = (uint32_t)rooms;
+    mBuilding.mSeed = (uint32_t)seed;
+    mBuilding.mJitter = (float)jitter;
+    mBuilding.mJitterRotate = (float)jitterRotate;
+    return true;
+  }
+
+  void mOverride(const SceneBuildingOverride& building)
+  {
+    if (building.mFloors >= 0) mBuilding.mFloors = building.mFloors > 0 ? building.mFloors : 1;
+    if (building.mRooms >= 0) mBuilding.mRooms = building.mRooms > 0 ? building.mRooms : 1;
+    if (building.mJitter >= 0.0f) mBuilding.mJitter = building.mJitter;
+    if (building.mJitterRotate >= 0.0f) mBuilding.mJitterRotate = building.mJitterRotate;
+    if (building.mSeed >= 0) mBuilding.mSeed = (uint32_t)building.mSeed;
+  }
+
+  // splitmix64 of seed + instance index, so an instance's nudge doesn't depend on
+  // anything compiled before it [-1, 1)
+  static float mRandom(uint64_t seed, uint64_t index, int which)
+  {
+    uint64_t z = (seed << 32) + index * 4 + which + 0x9E3779B97F4A7C15ull;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    z ^= z >> 31;
+    return (float)((z >> 40) * (1.0 / 8388608.0)) - 1.0f;
+  }
+
+  // the instances so far are room 0 of floor 0, copies go room by room, floor by floor
+  void mBuild(std::map<uint32_t, int>& counts)
+  {
+    size_t roomSize = mInstances.size();
+    mInstances.reserve(roomSize * mBuilding.mFloors * mBuilding.mRooms);
+
+    for (uint32_t floor = 0; floor < mBuilding.mFloors; floor++)
+    {
+      for (uint32_t room = 0; room < mBuilding.mRooms; room++)
+      {
+        if (floor == 0 && room == 0) continue;
+        for (size_t i = 0; i < roomSize; i++)
+        {
+          SceneInstance instance = mInstances[i];
+          const std::string assetName = mStrings.c_str() + mAssets[instance.mAsset].mName;
+          instance.mName = mAddString(assetName + " " + std::to_string(counts[instance.mAsset]++));
+          for (int k = 0; k < 3; k++) instance.mOffset[k] += floor * mBuilding.mFloorStep[k] + room * mBuilding.mRoomStep[k];
+          mInstances.push_back(instance);
+        }
+      }
+    }
+
+    if (mBuilding.mJitter <= 0.0f && mBuilding.mJitterRotate <= 0.0f) return;
+    for (size_t i = 0; i < mInstances.size(); i++)
+    {
+      SceneInstance& instance = mInstances[i];
+      if (!(mAssets[instance.mAsset].mFlags & SceneAssetJitter)) continue;
+      instance.mOffset[0] += mBuilding.mJitter * mRandom(mBuilding.mSeed, i, 0);
+      instance.mOffset[2] += mBuilding.mJitter * mRandom(mBuilding.mSeed, i, 1);
+      instance.mRotate += mBuilding.mJitterRotate * mRandom(mBuilding.mSeed, i, 2);
+    }
+  }
+
+  bool mCompile(const JsonValue& root, const SceneBuildingOverride* building)
+  {
+    if (root.mType != JsonValue::Object) return mFail(root, "the scene is an object");
+
+    const char* sections[] = {"assets", "instances", "lights"};
+    for (const char* section : sections)
+    {
+      const JsonValue* list = root.mGet(section);
+      if (list && list->mType != JsonValue::Array) return mFail(*list, std::string(section) + " is a list");
+    }
+
+    const JsonValue* assets = root.mGet("assets");
+    if (assets) for (const JsonValue& asset : assets->mItems) if (!mAsset(asset)) return false;
+
+    std::map<uint32_t, int> counts;
+    const JsonValue* instances = root.mGet("instances");
+    if (instances) for (const JsonValue& instance : instances->mItems) if (!mInstance(instance, counts)) return false;
+
+    const JsonValue* lights = root.mGet("lights");
+    if (lights) for (const JsonValue& light : lights->mItems) if (!mLight(light)) return false;
+
+    const JsonValue* section = root.mGet("building");
+    if (section && !mReadBuilding(*section)) return false;
+    if (building) mOverride(*building);
+    mBuild(counts);
+
+    while (mStrings.size() % 4) mStrings.push_back('\0'); // keeps the file a multiple of 4
+    return true;
+  }
+};
+
+
+bool compileScene(const char* scenePath, const char* snapshotPath, const SceneBuildingOverride* building)
+{
+  std::vector<unsigned char> scratch;
+  size_t size = 0;
+  const unsigned char* text = gAssets.mLoad(scenePath, &size, scratch);
+  if (!text)
+  {
+    std::cout << "Failed to read scene: " << scenePath << std::endl;
+    return false;
+  }
+
+  JsonValue root;
+  JsonParser parser((const char*)text, size);
+  if (!parser.mParse(&root))
+  {
+    std::cout << "Scene " << scenePath << ", " << parser.mError << std::endl;
+    return false;
+  }
+
+  SceneCompiler compiler;
+  if (!compiler.mCompile(root, building))
+  {
+    std::cout << "Scene " << scenePath << ", " << compiler.mError << std::endl;
+    return false;
+  }
+
+  SceneSnapshot::Header header = {};
+  memcpy(header.mMagic, gMagic, 4);
+  header.mVersion = gVersion;
+  header.mAssetCount = (uint32_t)compiler.mAssets.size();
+  header.mInstanceCount = (uint32_t)compiler.mInstances.size();
+  header.mLightCount = (uint32_t)compiler.mLights.size();
+  header.mStringBytes = (uint32_t)compiler.mStrings.size();
+  header.mBuilding = compiler.mBuilding;
+
+  FILE* fp = fopen(snapshotPath, "wb");
+  if (!fp)
+  {
+    std::cout << "Failed to write scene snapshot: " << snapshotPath << std::endl;
+    return false;
+  }
+  fwrite(&header, sizeof(header), 1, fp);
+  fwrite(compiler.mAssets.data(), sizeof(SceneAsset), compiler.mAssets.size(), fp);
+  fwrite(compiler.mInstances.data(), sizeof(SceneInstance), compiler.mInstances.size(), fp);
+  fwrite(compiler.mLights.data(), sizeof(SceneLight), compiler.mLights.size(), fp);
+  fwrite(compiler.mStrings.data(), 1, compiler.mStrings.size(), fp);
+  bool ok = !ferror(fp);
+  ok = fclose(fp) == 0 && ok;
+
+  std::cout << "Scene compiled: " << scenePath << " -> " << snapshotPath << ", "
+            << header.mAssetCount << " assets, " << header.mInstanceCount << " instances, "
+            << header.mLightCount << " lights";
+  if (header.mBuilding.mFloors * header.mBuilding.mRooms > 1)
+    std::cout << ", " << header.mBuilding.mFloors << " floors x " << header.mBuilding.mRooms << " rooms";
+  std::cout << std::endl;
+  return ok;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ SNAPSHOT ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+bool SceneSnapshot::mAttach(const unsigned char* bytes, size_t size)
+{
+  if (size < sizeof(Header)) return false;
+
+  const Header* header = (const Header*)bytes;
+  if (memcmp(header->mMagic, gMagic, 4) != 0 || header->mVersion != gVersion) return false;
+
+  size_t expected = sizeof(Header) + (size_t)header->mAssetCount * sizeof(SceneAsset) +
+                    (size_t)header->mInstanceCount * sizeof(SceneInstance) +
+                    (size_t)header->mLightCount * sizeof(SceneLight) + header->mStringBytes;
+  if (expected != size || header->mLightCount > gMaxLights) return false;
+  if (header->mBuilding.mFloors == 0 || header->mBuilding.mRooms == 0) return false;
+
+  const SceneAsset* assets = (const SceneAsset*)(bytes + sizeof(Header));
+  const SceneInstance* instances = (const SceneInstance*)(assets + header->mAssetCount);
+  const SceneLight* lights = (const SceneLight*)(instances + header->mInstanceCount);
+  const char* strings = (const char*)(lights + header->mLightCount);
+
+  // every reference inside the file, so nothing later has to check
+  if (header->mStringBytes == 0 || strings[header->mStringBytes - 1] != '\0') return false;
+  for (uint32_t i = 0; i < header->mAssetCount; i++)
+  {
+    const SceneAsset& asset = assets[i];
+    if (asset.mName >= header->mStringBytes || asset.mModelPath >= header->mStringBytes ||
+        asset.mTexturePath >= header->mStringBytes || asset.mPipeline > ScenePipelineCeilingLight) return false;
+  }
+  for (uint32_t i = 0; i < header->mInstanceCount; i++)
+  {
+    if (instances[i].mAsset >= header->mAssetCount || instances[i].mName >= header->mStringBytes) return false;
+  }
+
+  mHeader = header;
+  mAssets = assets;
+  mInstances = instances;
+  mLights = lights;
+  mStrings = strings;
+  return true;
+}
+
+
+bool SceneSnapshot::mOpen(const char* scenePath, const SceneBuildingOverride* building)
+{
+  mClose();
+  if (building && !building->mAny()) building = nullptr;
+  std::string snapshotPath = std::string(scenePath) + (building ? ".generated.bin" : ".bin");
+
+  // only loose files can be stale, a packed snapshot is taken as it is
+  struct stat scene, snapshot;
+  bool haveScene = stat(scenePath, &scene) == 0;
+  bool haveSnapshot = stat(snapshotPath.c_str(), &snapshot) == 0;
+  if (building)
+  {
+    if (!compileScene(scenePath, snapshotPath.c_str(), building)) return false;
+  }
+  else if (haveScene && (!haveSnapshot || snapshot.st_mtime < scene.st_mtime))
+  {
+    if (!compileScene(scenePath, snapshotPath.c_str())) return false;
+  }
+
+  bool loaded = mLoad(snapshotPath);
+
+  // a loose snapshot as new as the scene but written by an older version [gVersion went up],
+  // compiled again once
+  if (!loaded && mMapping && haveScene)
+  {
+    mClose();
+    std::cout << "Scene snapshot is out of date, compiling it again: " << snapshotPath << std::endl;
+    loaded = compileScene(scenePath, snapshotPath.c_str(), building) && mLoad(snapshotPath);
+  }
+
+  if (!loaded)
+  {
+    std::cout << "Failed to load scene snapshot: " << snapshotPath << std::endl;
+    mClose();
+    return false;
+  }
+
+  std::cout << "Scene: " << snapshotPath << ", " << mAssetCount() << " assets, "
+            << mInstanceCount() << " instances, " << mLightCount() << " lights" << std::endl;
+  return true;
+}
+
+
+bool SceneSnapshot::mLoad(const std::string& snapshotPath)
+{
+  int fd = open(snapshotPath.c_str(), O_RDONLY);
+  if (fd >= 0)
+  {
+    struct stat info;
+    void* mapping = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) mapping = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping != MAP_FAILED)
+    {
+      mMapping = (const unsigned char*)mapping;
+      mMappingSize = info.st_size;
+    }
+  }
+
+  const unsigned char* bytes = mMapping;
+  size_t size = mMappingSize;
+  if (!bytes) bytes = gAssets.mLoad(snapshotPath.c_str(), &size, mOwned);
+
+  return bytes && mAttach(bytes, size);
+}
+
+
+void SceneSnapshot::mClose()
+{
+  if (mMapping) munmap((void*)mMapping, mMappingSize);
+  mMapping = nullptr;
+  mMappingSize = 0;
+  mOwned.clear();
+  mHeader = nullptr;
+  mAssets = nullptr;
+  mInstances = nullptr;
+  mLights = nullptr;
+  mStrings = nullptr;
+}
@@ -0,0 +1,141 @@
+#ifndef SCENE_FILE_HEADER
+#define SCENE_FILE_HEADER
+
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+// Scene description [scenes/*.scene, JSON with // comments] -> flat binary snapshot
+//
+//   "assets"     model + texture + scale + pipeline + color [+ light, occluder box]
+//   "instances"  of an asset, one or a grid: column i / row j sits at
+//                at + i * column_step + j * row_step, "skip" drops [i, j] cells
+//   "lights"     same grid rule, one shadow casting spot light per cell [9 at most]
+//   "building"   optional: the instances above are one room, tiled into floors x rooms
+//                [room_step / floor_step apart], assets with "jitter" get a random nudge.
+//                "room" is the box of one room, every copy of it is a cell for the portal
+//                visibility [portalVisibility.hpp], "portal" assets are the openings
+//
+// The building is for scaling tests [100k+ instances], the command line can override it
+// [--floors, --rooms, --jitter, --seed], see main.cpp. Lights stay the first room's, there
+// are only 9 shadow maps
+//
+// The compiler expands every grid, so the snapshot is just arrays of fixed size records
+// plus a string table: mapped as is, nothing to parse or allocate at startup.
+// mOpen recompiles by itself when the text is newer than the snapshot
+
+enum ScenePipeline : uint32_t
+{
+  ScenePipelineDefault = 0,
+  ScenePipelineNormals = 1,
+  ScenePipelineCeilingLight = 2,
+};
+
+enum SceneAssetFlags : uint32_t
+{
+  SceneAssetLight = 1,
+  SceneAssetOccluder = 2,
+  SceneAssetJitter = 4,   // moved / turned a bit in every room when the building has jitter
+  SceneAssetPortal = 8,   // an opening in a room's wall [door, window], see through to the next cell
+};
+
+// strings are offsets into the string table
+struct SceneAsset
+{
+  uint32_t mName;
+  uint32_t mModelPath;
+  uint32_t mTexturePath;
+  uint32_t mPipeline;
+  uint32_t mFlags;
+  float mScale[3];
+  float mColor[3];
+  float mOccluderMin[3]; // fractions of the mesh box, like Mesh3D
+  float mOccluderMax[3];
+};
+
+struct SceneInstance
+{
+  uint32_t mAsset;
+  uint32_t mName; // "<asset> <n>", unique
+  float mOffset[3];
+  float mRotate;  // degrees around y
+};
+
+struct SceneLight
+{
+  float mPosition[3];
+};
+
+// "building" as compiled, 1 x 1 for a plain scene
+struct SceneBuilding
+{
+  uint32_t mFloors;
+  uint32_t mRooms;
+  float mRoomStep[3];
+  float mFloorStep[3];
+  float mJitter;       // meters, x and z
+  float mJitterRotate; // degrees
+  uint32_t mSeed;
+  float mRoomMin[3];   // room 0's box, all zero when the scene has no cells
+  float mRoomMax[3];
+};
+
+// Command line over the file's "building", negative keeps what the file says
+struct SceneBuildingOverride
+{
+  int mFloors = -1;
+  int mRooms = -1;
+  float mJitter = -1.0f;
+  float mJitterRotate = -1.0f;
+  long long mSeed = -1;
+
+  bool mAny() const { return mFloors >= 0 || mRooms >= 0 || mJitter >= 0.0f || mJitterRotate >= 0.0f || mSeed >= 0; }
+};
+
+bool compileScene(const char* scenePath, const char* snapshotPath, const SceneBuildingOverride* building = nullptr);
+
+class SceneSnapshot
+{
+  public:
+    // <scenePath>.bin, compiled first when stale. With overrides it is always compiled,
+    // to <scenePath>.generated.bin so the plain snapshot stays as it is
+    bool mOpen(const char* scenePath, const SceneBuildingOverride* building = nullptr);
+    void mClose();
+
+    uint32_t mAssetCount() const { return mHeader ? mHeader->mAssetCount : 0; }
+    uint32_t mInstanceCount() const { return mHeader ? mHeader->mInstanceCount : 0; }
+    uint32_t mLightCount() const { return mHeader ? mHeader->mLightCount : 0; }
+
+    const SceneAsset& mAsset(uint32_t i) const { return mAssets[i]; }
+    const SceneInstance& mInstance(uint32_t i) const { return mInstances[i]; }
+    const SceneLight& mLight(uint32_t i) const { return mLights[i]; }
+    const char* mString(uint32_t offset) const { return mStrings + offset; }
+    const SceneBuilding& mBuilding() const { return mHeader->mBuilding; }
+
+    struct Header
+    {
+      char mMagic[4];
+      uint32_t mVersion;
+      uint32_t mAssetCount;
+      uint32_t mInstanceCount;
+      uint32_t mLightCount;
+      uint32_t mStringBytes;
+      SceneBuilding mBuilding;
+    };
+
+  private:
+    const unsigned char* mMapping = nullptr; // mmap'd loose file
+    size_t mMappingSize = 0;
+    std::vector<unsigned char> mOwned;       // or read out of assets.pak
+
+    const Header* mHeader = nullptr;
+    const SceneAsset* mAssets = nullptr;
+    const SceneInstance* mInstances = nullptr;
+    const SceneLight* mLights = nullptr;
+    const char* mStrings = nullptr;
+
+    bool mAttach(const unsigned char* bytes, size_t size);
+    bool mLoad(const std::string& snapshotPath); // loose file mapped, or from assets.pak, then mAttach
+};
+#endif
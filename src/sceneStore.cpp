@@ -0,0 +1,163 @@
+#include "../glad/glad.h"
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+#include <string>
+#include <iostream>
+#include <utility>
+
+#include "sceneStore.hpp"
+#include "sceneFile.hpp"
+
+static const uint32_t gNone = 0xFFFFFFFF;
+
+
+SceneHandle SceneStore::mCreate(const char* name, uint32_t asset, glm::vec3 offset, float rotate)
+{
+  // one string for the lookup and the key [a const char* makes a new one for each]
+  std::string key = name;
+  if (asset >= mAssets.size() || mByName.count(key))
+  {
+    std::cout << "Scene store: can't add " << name << std::endl;
+    return SceneHandle();
+  }
+
+  uint32_t sparse;
+  if (!mFreeSparse.empty())
+  {
+    sparse = mFreeSparse.back();
+    mFreeSparse.pop_back();
+  }
+  else
+  {
+    sparse = mSparse.size();
+    mSparse.push_back(gNone);
+    mGenerations.push_back(0);
+  }
+
+  const Mesh3D& mesh = mAssets[asset];
+  uint32_t flags = 0;
+  if (mesh.isLight) flags |= SceneAssetLight;
+  if (mesh.mIsOccluder) flags |= SceneAssetOccluder;
+  if (mesh.mIsPortal) flags |= SceneAssetPortal;
+
+  mSparse[sparse] = mAsset.size();
+  mDenseToSparse.push_back(sparse);
+  mAsset.push_back(asset);
+  mOffset.push_back(offset);
+  mRotate.push_back(rotate);
+  mScale.push_back(mesh.mScale);
+  mBoundsMin.push_back(mesh.mBoundsMin);
+  mBoundsMax.push_back(mesh.mBoundsMax);
+  mPipeline.push_back(mesh.mGraphicsPipeline);
+  mTexture.push_back(mesh.mTextureObject);
+  mColor.push_back(mesh.mColor);
+  mFlags.push_back(flags);
+  mNames.push_back(&mByName.emplace(std::move(key), sparse).first->first);
+
+  return {sparse, mGenerations[sparse]};
+}
+
+
+// The last one moves into the hole, only its dense index changes [its handle doesn't]
+bool SceneStore::mDestroy(SceneHandle handle)
+{
+  uint32_t dense = mDense(handle);
+  if (dense == gNone) return false;
+
+  uint32_t last = mAsset.size() - 1;
+  mByName.erase(*mNames[dense]);
+  if (dense != last)
+  {
+    mAsset[dense] = mAsset[last];
+    mOffset[dense] = mOffset[last];
+    mRotate[dense] = mRotate[last];
+    mScale[dense] = mScale[last];
+    mBoundsMin[dense] = mBoundsMin[last];
+    mBoundsMax[dense] = mBoundsMax[last];
+    mPipeline[dense] = mPipeline[last];
+    mTexture[dense] = mTexture[last];
+    mColor[dense] = mColor[last];
+    mFlags[dense] = mFlags[last];
+    mNames[dense] = mNames[last];
+    mDenseToSparse[dense] = mDenseToSparse[last];
+    mSparse[mDenseToSparse[dense]] = dense;
+  }
+
+  mAsset.pop_back();
+  mOffset.pop_back();
+  mRotate.pop_back();
+  mScale.pop_back();
+  mBoundsMin.pop_back();
+  mBoundsMax.pop_back();
+  mPipeline.pop_back();
+  mTexture.pop_back();
+  mColor.pop_back();
+  mFlags.pop_back();
+  mNames.pop_back();
+  mDenseToSparse.pop_back();
+
+  mSparse[handle.mIndex] = gNone;
+  mGenerations[handle.mIndex]++;
+  mFreeSparse.push_back(handle.mIndex);
+  return true;
+}
+
+
+void SceneStore::mClear()
+{
+  while (mCount() > 0) mDestroy(mHandle(mCount() - 1));
+}
+
+
+void SceneStore::mReserve(size_t count)
+{
+  mSparse.reserve(count);
+  mGenerations.reserve(count);
+  mDenseToSparse.reserve(count);
+  mAsset.reserve(count);
+  mOffset.reserve(count);
+  mRotate.reserve(count);
+  mScale.reserve(count);
+  mBoundsMin.reserve(count);
+  mBoundsMax.reserve(count);
+  mPipeline.reserve(count);
+  mTexture.reserve(count);
+  mColor.reserve(count);
+  mFlags.reserve(count);
+  mNames.reserve(count);
+  mByName.reserve(count);
+}
+
+
+bool SceneStore::mValid(SceneHandle handle) const
+{
+  return handle.mIndex < mSparse.size() && mGenerations[handle.mIndex] == handle.mGeneration && mSparse[handle.mIndex] != gNone;
+}
+
+
+uint32_t SceneStore::mDense(SceneHandle handle) const
+{
+  return mValid(handle) ? mSparse[handle.mIndex] : gNone;
+}
+
+
+SceneHandle SceneStore::mFind(const std::string& name) const
+{
+  auto found = mByName.find(name);
+  if (found == mByName.end()) return SceneHandle();
+  return {found->second, mGenerations[found->second]};
+}
+
+
+void SceneStore::mReplaceTexture(GLuint oldTexture, GLuint newTexture)
+{
+  for (Mesh3D& mesh : mAssets)
+  {
+    if (mesh.mTextureObject == oldTexture) mesh.mTextureObject = newTexture;
+  }
+  for (GLuint& texture : mTexture)
+  {
+    if (texture == oldTexture) texture = newTexture;
+  }
+}
@@ -0,0 +1,79 @@
+#ifndef SCENE_STORE_HEADER
+#define SCENE_STORE_HEADER
+
+#include "../glad/glad.h"
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cstdint>
+
+#include "mesh.hpp"
+
+// Generational handle, stays valid [or is known to be stale] however the store is reshuffled
+struct SceneHandle
+{
+  uint32_t mIndex = 0xFFFFFFFF; // into the sparse table
+  uint32_t mGeneration = 0;
+
+  bool operator==(const SceneHandle& other) const { return mIndex == other.mIndex && mGeneration == other.mGeneration; }
+  bool operator!=(const SceneHandle& other) const { return !(*this == other); }
+};
+
+// Every instance of the scene, slot map style
+//
+//   assets      the loaded meshes [geometry, texture, bounds], one per scene asset, the only
+//               place the vectors live
+//   instances   dense component arrays, index 0..mCount()-1, no holes: mDestroy moves the
+//               last instance into the freed slot. Walking them is a linear pass over each
+//               array, what the per instance loops want
+//   handles     sparse index -> dense index + a generation bumped on destroy, so an old
+//               handle of a destroyed instance is caught instead of pointing at whoever
+//               moved in
+//   names       interned, by name lookups and printing only, nothing per frame uses them
+//
+// SceneAssetFlags [sceneFile.hpp] are the per instance flags
+class SceneStore
+{
+  public:
+    std::vector<Mesh3D> mAssets;
+
+    // dense components
+    std::vector<uint32_t> mAsset;    // index into mAssets
+    std::vector<glm::vec3> mOffset;  // transform
+    std::vector<float> mRotate;      // degrees around y
+    std::vector<glm::vec3> mScale;
+    std::vector<glm::vec3> mBoundsMin; // object space, the asset's
+    std::vector<glm::vec3> mBoundsMax;
+    std::vector<GLuint> mPipeline;   // render info, 0 is the default pipeline
+    std::vector<GLuint> mTexture;
+    std::vector<glm::vec3> mColor;
+    std::vector<uint32_t> mFlags;
+
+    // instance of an asset at its scale, placed at offset
+    SceneHandle mCreate(const char* name, uint32_t asset, glm::vec3 offset, float rotate);
+    bool mDestroy(SceneHandle handle);
+    void mClear(); // assets stay
+    void mReserve(size_t count); // instances, before a lot of mCreate
+
+    size_t mCount() const { return mAsset.size(); }
+    bool mValid(SceneHandle handle) const;
+    uint32_t mDense(SceneHandle handle) const; // 0xFFFFFFFF when stale
+    SceneHandle mHandle(uint32_t dense) const { return {mDenseToSparse[dense], mGenerations[mDenseToSparse[dense]]}; }
+
+    SceneHandle mFind(const std::string& name) const; // invalid handle when there is none
+    const char* mName(uint32_t dense) const { return mNames[dense]->c_str(); }
+
+    void mReplaceTexture(GLuint oldTexture, GLuint newTexture); // assets and instances
+
+  private:
+    std::vector<uint32_t> mSparse;        // sparse index -> dense index
+    std::vector<uint32_t> mGenerations;
+    std::vector<uint32_t> mFreeSparse;
+    std::vector<uint32_t> mDenseToSparse;
+
+    std::unordered_map<std::string, uint32_t> mByName; // -> sparse index, keys are the interned names
+    std::vector<const std::string*> mNames;              // dense, points at the keys above
+};
+#endif
@@ -3,9 +3,11 @@
 #include "shader.hpp"
 
 #include <iostream>
-#include <fstream>
+#include <vector>
 #include <cstring>
 
+#include "assetArchive.hpp"
+
 
 GLuint Shader::mCreateGraphicsPipeline(std::string vertexSourcePath, std::string fragSourcePath)
 {
@@ -16,22 +18,33 @@ GLuint Shader::mCreateGraphicsPipeline(std::string vertexSourcePath, std::string
 }
 
 
+GLuint Shader::mCreateComputePipeline(std::string computeSourcePath)
+{
+  std::string computeShaderSource = Shader::mLoadShaderAsString(computeSourcePath);
+
+  GLuint programObject = glCreateProgram();
+  GLuint computeShader = Shader::mCompileShader(GL_COMPUTE_SHADER, computeShaderSource);
+  Shader::mCheckErrors(computeShader);
+
+  glAttachShader(programObject, computeShader);
+  glLinkProgram(programObject);
+  return programObject;
+}
+
+
 std::string Shader::mLoadShaderAsString(const std::string& filename)
 {
-  std::string result = "";
-  std::string line = "";
-  std::ifstream glslFile(filename.c_str());
+  std::vector<unsigned char> scratch;
+  size_t size = 0;
+  const unsigned char* text = gAssets.mLoad(filename.c_str(), &size, scratch);
 
-  if (glslFile.is_open())
+  if (!text)
   {
-    while (std::getline(glslFile, line))
-    {
-      result += line + '\n';
-    }
-    glslFile.close();
+    std::cout << "Failed to read shader: " << filename << std::endl;
+    return "";
   }
 
-  return result;
+  return std::string((const char*)text, size);
 }
 
 GLuint Shader::mCreateShaderProgram(const std::string& vertexShaderSource, const std::string& fragmentShaderSource)
@@ -20,6 +20,7 @@ class Shader
 
   public:
     GLuint mCreateGraphicsPipeline(std::string vertexSourcePath, std::string fragSourcePath);
+    GLuint mCreateComputePipeline(std::string computeSourcePath);
 
 };
 #endif
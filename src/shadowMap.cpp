@@ -7,6 +7,8 @@
 
 #include "shadowMap.hpp"
 #include "mesh.hpp"
+#include "gpuScene.hpp"
+#include "memoryRegistry.hpp"
 
 
 void ShadowMap::SetLightPosition(glm::vec3 lightPos)
@@ -36,6 +38,7 @@ void ShadowMap::CreateShadowMapTextureObject()
   glBindTexture(GL_TEXTURE_2D, mTextureObject);
 
   glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, mShadowMapWidth, mShadowMapHeight, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+  gMemory.mTrackTexture(mTextureObject, GL_DEPTH_COMPONENT, mShadowMapWidth, mShadowMapHeight, 1, 1, MemoryShadowMaps, "shadow map");
 
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
@@ -55,8 +58,12 @@ void ShadowMap::BindShadowMapFrameBufferTextureObject()
 } 
 
 
-void ShadowMap::GenShadowMap(const std::map<std::string, Mesh3D>& meshes, glm::mat4 lightViewMatrix, glm::mat4 lightProjectionMatrix)
+void ShadowMap::GenShadowMap(GpuScene& scene, glm::mat4 lightViewMatrix, glm::mat4 lightProjectionMatrix)
 {
+  // culling runs first, it needs its own program bound
+  // meshlets outside the light cone can't cast a shadow into this map [no cone test, both faces write depth]
+  scene.mCull(lightProjectionMatrix * lightViewMatrix, mLightPos, false);
+
   glEnable(GL_DEPTH_TEST);  
   glCullFace(GL_FRONT);
 
@@ -66,36 +73,24 @@ void ShadowMap::GenShadowMap(const std::map<std::string, Mesh3D>& meshes, glm::m
 
   glUseProgram(mGraphicsPipelineShaderProgram);
 
-  ShadowMap::RenderOnFrameBuffer(meshes, lightViewMatrix, lightProjectionMatrix);
+  ShadowMap::RenderOnFrameBuffer(scene, lightViewMatrix, lightProjectionMatrix);
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
 }
 
 
-void ShadowMap::RenderOnFrameBuffer(const std::map<std::string, Mesh3D>& meshes, glm::mat4 lightViewMatrix, glm::mat4 lightProjectionMatrix)
+void ShadowMap::RenderOnFrameBuffer(GpuScene& scene, glm::mat4 lightViewMatrix, glm::mat4 lightProjectionMatrix)
 {
-  for (const auto& pair: meshes)
-  {
-    Mesh3D mesh = pair.second;
-    ShadowMap::TransformObjects_N_SendUniformData(&mesh, lightViewMatrix, lightProjectionMatrix);  
-    glBindVertexArray(mesh.mVertexArrayObject);
-    glDrawArrays(GL_TRIANGLES, 0, mesh.mVertexData.size() / 3);
-  }
-  glBindVertexArray(0);
+  ShadowMap::SendUniformData(lightViewMatrix, lightProjectionMatrix);
+  scene.mDrawAll();
 }
 
 
-void ShadowMap::TransformObjects_N_SendUniformData(Mesh3D* mesh, glm::mat4 lightViewMatrix, glm::mat4 lightProjectionMatrix)
+void ShadowMap::SendUniformData(glm::mat4 lightViewMatrix, glm::mat4 lightProjectionMatrix)
 {
-  // Local to world
-  GLint location = glGetUniformLocation(mGraphicsPipelineShaderProgram, "u_model");
-  glm::mat4 model = glm::translate(glm::mat4(1.0f), mesh->mOffset);
-  model = glm::rotate(model, glm::radians(mesh->mRotate), glm::vec3(0.0f, 1.0f, 0.0f));
-  model = glm::scale(model, mesh->mScale);
-  glUniformMatrix4fv(location, 1, GL_FALSE, &model[0][0]);
-
+  // Local to world comes from the instance SSBO
 
   // World to LIGHT
-  location = glGetUniformLocation(mGraphicsPipelineShaderProgram, "u_view");
+  GLint location = glGetUniformLocation(mGraphicsPipelineShaderProgram, "u_view");
   glUniformMatrix4fv(location, 1, GL_FALSE, &lightViewMatrix[0][0]);    
 
 
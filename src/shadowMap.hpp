@@ -8,6 +8,7 @@
 #include <map>
 
 #include "mesh.hpp"
+#include "gpuScene.hpp"
 
 class ShadowMap
 {
@@ -15,8 +16,8 @@ class ShadowMap
     GLuint mFrameBufferObject = 0;
     GLuint mGraphicsPipelineShaderProgram = 0;
 
-    void RenderOnFrameBuffer(const std::map<std::string, Mesh3D>& meshes, glm::mat4, glm::mat4);
-    void TransformObjects_N_SendUniformData(Mesh3D*, glm::mat4, glm::mat4);
+    void RenderOnFrameBuffer(GpuScene& scene, glm::mat4, glm::mat4);
+    void SendUniformData(glm::mat4, glm::mat4);
  
  public:
    float mShadowMapWidth = 4096.0f;
@@ -28,7 +29,7 @@ class ShadowMap
    void CreateShadowMapFrameBufferObject();
    void CreateShadowMapTextureObject();
    void BindShadowMapFrameBufferTextureObject();
-   void GenShadowMap(const std::map<std::string, Mesh3D>& meshes, glm::mat4, glm::mat4);
+   void GenShadowMap(GpuScene& scene, glm::mat4, glm::mat4);
 
 };
 #endif
@@ -0,0 +1,59 @@
+#ifndef SPSC_RING_HEADER
+#define SPSC_RING_HEADER
+
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+
+// Single producer, single consumer ring of N slots that are written in place and reused
+// [nothing is copied in or out, vectors in a slot keep their capacity]
+//
+//   producer: T* slot = mBeginWrite(); fill it; mEndWrite();
+//   consumer: T* slot = mBeginRead();  use it;  mEndRead();
+//
+// mBegin* return nullptr when there is nothing to do, the mWait* versions back off
+// [yield, then short sleeps] until there is. Only the two counters are shared
+template <typename T, uint32_t N>
+class SpscRing
+{
+  public:
+    T* mBeginWrite()
+    {
+      uint32_t head = mHead.load(std::memory_order_relaxed);
+      if (head - mTail.load(std::memory_order_acquire) >= N) return nullptr;
+      return &mSlots[head % N];
+    }
+    void mEndWrite() { mHead.store(mHead.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    T* mBeginRead()
+    {
+      uint32_t tail = mTail.load(std::memory_order_relaxed);
+      if (mHead.load(std::memory_order_acquire) == tail) return nullptr;
+      return &mSlots[tail % N];
+    }
+    void mEndRead() { mTail.store(mTail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+    T* mWaitWrite() { return mWait([this]() { return mBeginWrite(); }); }
+    T* mWaitRead() { return mWait([this]() { return mBeginRead(); }); }
+
+    uint32_t mQueued() const { return mHead.load(std::memory_order_acquire) - mTail.load(std::memory_order_acquire); }
+
+  private:
+    T mSlots[N];
+    alignas(64) std::atomic<uint32_t> mHead{0}; // next slot to write
+    alignas(64) std::atomic<uint32_t> mTail{0}; // next slot to read
+
+    template <typename Try>
+    static T* mWait(const Try& attempt)
+    {
+      for (int spins = 0;; spins++)
+      {
+        T* slot = attempt();
+        if (slot) return slot;
+        if (spins < 64) std::this_thread::yield();
+        else std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+    }
+};
+#endif
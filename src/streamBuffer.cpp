@@ -0,0 +1,132 @@
+#include "../glad/glad.h"
+
+#include <iostream>
+#include <chrono>
+#include <algorithm>
+
+#include "streamBuffer.hpp"
+#include "counters.hpp"
+#include "memoryRegistry.hpp"
+
+
+bool StreamBuffer::mCreate(size_t frameBytes)
+{
+  mDestroy();
+
+  GLint ssboAlignment = 256, uboAlignment = 256;
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &ssboAlignment);
+  glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+  mBindAlignment = (size_t)std::max(std::max(ssboAlignment, uboAlignment), 16);
+
+  // regions start aligned too
+  mRegionBytes = (frameBytes + mBindAlignment - 1) / mBindAlignment * mBindAlignment;
+
+  // coherent: a memcpy into it is all it takes, no flushes [same as the texture streamer]
+  GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glGenBuffers(1, &mBuffer);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+  glBufferStorage(GL_COPY_WRITE_BUFFER, mRegionBytes * mFramesInFlight, nullptr, flags);
+  mMapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, mRegionBytes * mFramesInFlight, flags);
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  gMemory.mTrackBuffer(mBuffer, mRegionBytes * mFramesInFlight, MemoryStreaming, "stream buffer");
+
+  if (!mMapped)
+  {
+    std::cout << "Failed to map the stream buffer" << std::endl;
+    gMemory.mDeleteBuffers(1, &mBuffer);
+    mBuffer = 0;
+    return false;
+  }
+
+  mRegion = 0;
+  mHead = 0;
+  return true;
+}
+
+
+void StreamBuffer::mDestroy()
+{
+  for (GLsync& fence : mFences)
+  {
+    if (fence) glDeleteSync(fence);
+    fence = 0;
+  }
+
+  if (mBuffer)
+  {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, mBuffer);
+    if (mMapped) glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    gMemory.mDeleteBuffers(1, &mBuffer);
+  }
+  mBuffer = 0;
+  mMapped = nullptr;
+}
+
+
+void StreamBuffer::mBeginFrame()
+{
+  if (!mMapped) return;
+
+  mRegion = (mRegion + 1) % mFramesInFlight;
+  mHead = 0;
+
+  GLsync& fence = mFences[mRegion];
+  if (!fence) return;
+
+  // the GPU is normally frames ahead of this, only a real wait counts
+  GLenum result = glClientWaitSync(fence, 0, 0);
+  if (result == GL_TIMEOUT_EXPIRED)
+  {
+    auto start = std::chrono::steady_clock::now();
+    while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+    mStallMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    mStalls++;
+  }
+
+  glDeleteSync(fence);
+  fence = 0;
+}
+
+
+void StreamBuffer::mEndFrame()
+{
+  if (!mMapped) return;
+
+  mFences[mRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  mPeakBytes = std::max(mPeakBytes, mHead);
+  mFrames++;
+}
+
+
+StreamAllocation StreamBuffer::mAllocate(size_t bytes, size_t alignment)
+{
+  StreamAllocation allocation;
+  if (!mMapped || bytes == 0) return allocation;
+
+  if (alignment == 0) alignment = mBindAlignment;
+  size_t offset = (mHead + alignment - 1) / alignment * alignment;
+  if (offset + bytes > mRegionBytes)
+  {
+    mOverflows++;
+    return allocation;
+  }
+  mHead = offset + bytes;
+
+  allocation.mBuffer = mBuffer;
+  allocation.mOffset = (GLintptr)(mRegion * mRegionBytes + offset);
+  allocation.mSize = (GLsizeiptr)bytes;
+  allocation.mData = mMapped + allocation.mOffset;
+  Counters::mAdd(CounterUploadBytes, bytes); // the caller fills it
+  return allocation;
+}
+
+
+void StreamBuffer::mPrintReport() const
+{
+  if (!mMapped) return;
+
+  std::cout << "Stream buffer: " << mFramesInFlight << " x " << mRegionBytes / 1024 << " KB, peak "
+            << mPeakBytes / 1024 << " KB a frame, " << mStalls << " fence stalls [" << mStallMs << " ms] in "
+            << mFrames << " frames, " << mOverflows << " overflows" << std::endl;
+}
@@ -0,0 +1,60 @@
+#ifndef STREAM_BUFFER_HEADER
+#define STREAM_BUFFER_HEADER
+
+#include "../glad/glad.h"
+
+#include <cstddef>
+
+// Where a mAllocate landed: write through mData, bind mBuffer at mOffset
+// mData is null when this frame's region is full [the caller falls back to glBufferSubData]
+struct StreamAllocation
+{
+  GLuint mBuffer = 0;
+  GLintptr mOffset = 0;
+  GLsizeiptr mSize = 0;
+  void* mData = nullptr;
+};
+
+// Per frame dynamic data [visibility flags, moved instances, debug lines] without driver copies
+//
+// One buffer, persistently and coherently mapped, split in mFramesInFlight regions. A frame
+// bump allocates from its region, mEndFrame fences it, and mBeginFrame waits on the fence of
+// the region it is about to reuse [three frames back, normally long signaled]. A wait that
+// actually blocks is a stall, counted and timed for mPrintReport
+//
+// Render thread only, like everything else GL
+class StreamBuffer
+{
+  public:
+    static const int mFramesInFlight = 3;
+
+    // counters since mCreate
+    long mFrames = 0;
+    long mStalls = 0;
+    double mStallMs = 0.0;
+    long mOverflows = 0;     // allocations that didn't fit
+    size_t mPeakBytes = 0;   // most used by one frame
+
+    bool mCreate(size_t frameBytes);
+    void mDestroy();
+    bool mValid() const { return mMapped != nullptr; }
+    size_t mFrameBytes() const { return mRegionBytes; }
+
+    void mBeginFrame();
+    void mEndFrame();
+
+    // alignment 0: the SSBO / UBO offset alignment, enough for glBindBufferRange
+    StreamAllocation mAllocate(size_t bytes, size_t alignment = 0);
+
+    void mPrintReport() const;
+
+  private:
+    GLuint mBuffer = 0;
+    unsigned char* mMapped = nullptr;
+    size_t mRegionBytes = 0;
+    size_t mBindAlignment = 256;
+    GLsync mFences[mFramesInFlight] = {};
+    int mRegion = 0;
+    size_t mHead = 0; // into the current region
+};
+#endif
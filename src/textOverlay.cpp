@@ -0,0 +1,166 @@
+#include "../glad/glad.h"
+
+#include <vector>
+#include <cstddef>
+#include <cstring>
+
+#include "textOverlay.hpp"
+#include "shader.hpp"
+#include "counters.hpp"
+#include "memoryRegistry.hpp"
+
+// One octal digit per row, top to bottom, 3 bits a row [4 = left column]
+// ' ' to '_', then a solid cell for panels
+static const int gGlyphCount = 65;
+static const int gSolidGlyph = 64;
+static const uint16_t gGlyphs[gGlyphCount] =
+{
+  000000, 022202, 055000, 057575, 036236, 051245, 025253, 022000, // space ! " # $ % & '
+  012221, 042224, 005250, 002720, 000024, 000700, 000002, 011244, // ( ) * + , - . /
+  075557, 026227, 071747, 071717, 055711, 074717, 074757, 071111, // 0 - 7
+  075757, 075717, 002020, 002024, 012421, 007070, 042124, 071202, // 8 9 : ; < = > ?
+  025743, 025755, 065656, 034443, 065556, 074647, 074644, 034553, // @ A - G
+  055755, 072227, 011152, 055655, 044447, 057755, 065555, 025552, // H - O
+  065644, 025563, 065655, 034216, 072222, 055557, 055552, 055775, // P - W
+  055255, 055222, 071247, 064446, 044211, 031113, 025000, 000007, // X Y Z [ \ ] ^ _
+  077777,
+};
+
+// a glyph is a 4 x 6 cell in the atlas, the spacing is part of it
+static const int gCellWidth = 4;
+static const int gCellHeight = 6;
+
+
+void TextOverlay::mCreate()
+{
+  Shader shader;
+  mProgram = shader.mCreateGraphicsPipeline("shaders/text/vert.glsl", "shaders/text/frag.glsl");
+
+  // bake the atlas, one row of cells
+  int width = gGlyphCount * gCellWidth;
+  std::vector<unsigned char> pixels(width * gCellHeight, 0);
+  for (int glyph = 0; glyph < gGlyphCount; glyph++)
+  {
+    for (int row = 0; row < gCellHeight; row++)
+    {
+      for (int column = 0; column < gCellWidth; column++)
+      {
+        bool set = glyph == gSolidGlyph;
+        if (!set && row < 5 && column < 3) set = (gGlyphs[glyph] >> ((4 - row) * 3 + (2 - column))) & 1;
+        pixels[row * width + glyph * gCellWidth + column] = set ? 255 : 0;
+      }
+    }
+  }
+
+  glGenTextures(1, &mFontTexture);
+  glBindTexture(GL_TEXTURE_2D, mFontTexture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, gCellHeight, 0, GL_RED, GL_UNSIGNED_BYTE, pixels.data());
+  gMemory.mTrackTexture(mFontTexture, GL_R8, width, gCellHeight, 1, 1, MemoryOverlay, "font atlas");
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  glGenVertexArrays(1, &mVertexArrayObject);
+  glBindVertexArray(mVertexArrayObject);
+  glEnableVertexAttribArray(0); // position
+  glVertexAttribFormat(0, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, mPosition));
+  glVertexAttribBinding(0, 0);
+  glEnableVertexAttribArray(1); // uv
+  glVertexAttribFormat(1, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, mUv));
+  glVertexAttribBinding(1, 0);
+  glEnableVertexAttribArray(2); // color
+  glVertexAttribFormat(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, offsetof(Vertex, mColor));
+  glVertexAttribBinding(2, 0);
+  glBindVertexArray(0);
+
+  glGenBuffers(1, &mFallbackBuffer);
+}
+
+
+void TextOverlay::mQuad(float x, float y, float width, float height, int glyph, uint32_t color)
+{
+  float u0 = (float)glyph / gGlyphCount, u1 = (float)(glyph + 1) / gGlyphCount;
+  Vertex topLeft = {{x, y}, {u0, 0.0f}, color};
+  Vertex topRight = {{x + width, y}, {u1, 0.0f}, color};
+  Vertex bottomLeft = {{x, y + height}, {u0, 1.0f}, color};
+  Vertex bottomRight = {{x + width, y + height}, {u1, 1.0f}, color};
+
+  mVertices.push_back(topLeft);
+  mVertices.push_back(bottomLeft);
+  mVertices.push_back(topRight);
+  mVertices.push_back(topRight);
+  mVertices.push_back(bottomLeft);
+  mVertices.push_back(bottomRight);
+}
+
+
+void TextOverlay::mPrint(float x, float y, const char* text, uint32_t color)
+{
+  for (const char* c = text; *c; c++, x += mCharWidth())
+  {
+    int code = *c;
+    if (code >= 'a' && code <= 'z') code -= 'a' - 'A';
+    if (code <= ' ' || code > '_') continue; // space and everything the font doesn't have
+    mQuad(x, y, mCharWidth(), mLineHeight(), code - ' ', color);
+  }
+}
+
+
+void TextOverlay::mPanel(float x, float y, float width, float height, uint32_t color)
+{
+  mQuad(x, y, width, height, gSolidGlyph, color);
+}
+
+
+void TextOverlay::mFlush(int screenWidth, int screenHeight, StreamBuffer* stream)
+{
+  if (mVertices.empty() || !mProgram) return;
+
+  size_t bytes = mVertices.size() * sizeof(Vertex);
+  StreamAllocation allocation;
+  if (stream) allocation = stream->mAllocate(bytes, sizeof(Vertex));
+
+  glBindVertexArray(mVertexArrayObject);
+  if (allocation.mData)
+  {
+    memcpy(allocation.mData, mVertices.data(), bytes);
+    glBindVertexBuffer(0, allocation.mBuffer, allocation.mOffset, sizeof(Vertex));
+  }
+  else
+  {
+    glBindBuffer(GL_ARRAY_BUFFER, mFallbackBuffer);
+    glBufferData(GL_ARRAY_BUFFER, bytes, mVertices.data(), GL_STREAM_DRAW);
+    gMemory.mTrackBuffer(mFallbackBuffer, bytes, MemoryOverlay, "text fallback");
+    Counters::mAdd(CounterUploadBytes, bytes);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexBuffer(0, mFallbackBuffer, 0, sizeof(Vertex));
+  }
+
+  glUseProgram(mProgram);
+  GLint location = glGetUniformLocation(mProgram, "u_screenSize");
+  glUniform2f(location, (float)screenWidth, (float)screenHeight);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, mFontTexture);
+  location = glGetUniformLocation(mProgram, "u_font");
+  glUniform1i(location, 0);
+
+  glDisable(GL_DEPTH_TEST);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDrawArrays(GL_TRIANGLES, 0, (GLsizei)mVertices.size());
+  glDisable(GL_BLEND);
+  glEnable(GL_DEPTH_TEST);
+
+  Counters::mAdd(CounterVertexArrayBinds);
+  Counters::mAdd(CounterProgramBinds);
+  Counters::mAdd(CounterTextureBinds);
+  Counters::mAdd(CounterDrawCalls);
+
+  glBindVertexArray(0);
+  mVertices.clear(); // keeps its capacity
+}
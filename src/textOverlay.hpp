@@ -0,0 +1,47 @@
+#ifndef TEXT_OVERLAY_HEADER
+#define TEXT_OVERLAY_HEADER
+
+#include "../glad/glad.h"
+
+#include <vector>
+#include <cstdint>
+
+#include "streamBuffer.hpp"
+
+// Screen space text out of a baked 3x5 bitmap font [ASCII 32-95, lower case is drawn as
+// upper case], one quad per character, everything a frame printed in one draw
+//
+// mPrint only appends to a CPU vector, mFlush puts it into the stream buffer and draws it
+// over the scene. Render thread
+class TextOverlay
+{
+  public:
+    int mScale = 3; // screen pixels per font pixel
+
+    void mCreate();
+
+    // x, y: top left in pixels, a line is 6 font pixels high
+    void mPrint(float x, float y, const char* text, uint32_t color);
+    void mPanel(float x, float y, float width, float height, uint32_t color); // solid box, behind the text printed after it
+    float mLineHeight() const { return 6.0f * mScale; }
+    float mCharWidth() const { return 4.0f * mScale; }
+
+    void mFlush(int screenWidth, int screenHeight, StreamBuffer* stream);
+
+  private:
+    struct Vertex
+    {
+      float mPosition[2]; // pixels
+      float mUv[2];
+      uint32_t mColor;    // RGBA8
+    };
+
+    GLuint mProgram = 0;
+    GLuint mVertexArrayObject = 0;
+    GLuint mFontTexture = 0;
+    GLuint mFallbackBuffer = 0;
+    std::vector<Vertex> mVertices;
+
+    void mQuad(float x, float y, float width, float height, int glyph, uint32_t color);
+};
+#endif
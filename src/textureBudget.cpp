@@ -0,0 +1,160 @@
+#include "../glm/ext/matrix_transform.hpp"
+#include "../glm/geometric.hpp"
+#include "../glm/trigonometric.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "textureBudget.hpp"
+#include "textureCompress.hpp"
+#include "assetArchive.hpp"
+#include "stb_image.h"
+
+
+bool TextureBudget::mDescribe(const std::string& path, Demand* demand)
+{
+  std::vector<unsigned char> scratch;
+  size_t size = 0;
+  const unsigned char* image = gAssets.mLoad(path.c_str(), &size, scratch);
+
+  int nChannels;
+  if (!image || !stbi_info_from_memory(image, (int)size, &demand->mWidth, &demand->mHeight, &nChannels)) return false;
+
+  // the cooked file is what ends up in VRAM when it's there
+  const unsigned char* cooked = gAssets.mLoad((path + ".ctex").c_str(), &size, scratch);
+  if (cooked)
+  {
+    GLenum format = readCookedTextureFormat(cooked, size);
+    if (format == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) demand->mBytesPerTexel = 0.5f;
+    else if (format != 0) demand->mBytesPerTexel = 1.0f;
+  }
+  return true;
+}
+
+
+void TextureBudget::mAddInstance(const Mesh3D& mesh)
+{
+  if (mesh.mTexturePath[0] == '\0') return;
+
+  // both areas over the same triangles, the ratio is the average stretch of the UVs
+  glm::mat4 model = mesh.mGetModelMatrix();
+  double worldArea = 0.0, uvArea = 0.0;
+  for (size_t i = 0; i + 2 < mesh.mIndexData.size(); i += 3)
+  {
+    glm::vec3 p[3];
+    glm::vec2 uv[3];
+    for (int j = 0; j < 3; j++)
+    {
+      GLuint v = mesh.mIndexData[i + j];
+      p[j] = glm::vec3(model * glm::vec4(mesh.mVertexData[v * 3], mesh.mVertexData[v * 3 + 1], mesh.mVertexData[v * 3 + 2], 1.0f));
+      uv[j] = glm::vec2(mesh.mUvData[v * 2], mesh.mUvData[v * 2 + 1]);
+    }
+
+    worldArea += 0.5 * glm::length(glm::cross(p[1] - p[0], p[2] - p[0]));
+    glm::vec2 a = uv[1] - uv[0], b = uv[2] - uv[0];
+    uvArea += 0.5 * std::fabs(a.x * b.y - a.y * b.x);
+  }
+  if (worldArea <= 0.0 || uvArea <= 0.0) return;
+
+  auto found = mDemands.find(mesh.mTexturePath);
+  if (found == mDemands.end())
+  {
+    Demand demand;
+    if (!mDescribe(mesh.mTexturePath, &demand)) return;
+    found = mDemands.emplace(mesh.mTexturePath, demand).first;
+  }
+
+  Demand& demand = found->second;
+  float density = (float)std::sqrt(uvArea * demand.mWidth * demand.mHeight / worldArea);
+  demand.mTexelsPerMeter = std::max(demand.mTexelsPerMeter, density);
+}
+
+
+double TextureBudget::mBytes(const Demand& demand, int halvings)
+{
+  double width = std::max(1, demand.mWidth >> halvings);
+  double height = std::max(1, demand.mHeight >> halvings);
+  return width * height * demand.mBytesPerTexel * 4.0 / 3.0;
+}
+
+
+float TextureBudget::mNeededScale(const Demand& demand) const
+{
+  // a surface facing the camera at the nearest distance
+  float pixelsPerMeter = mScreenHeight / (2.0f * mNearestViewDistance * std::tan(glm::radians(mFovY) * 0.5f));
+  return std::min(1.0f, pixelsPerMeter / demand.mTexelsPerMeter);
+}
+
+
+void TextureBudget::mPlan()
+{
+  auto canHalve = [this](const Demand& demand)
+  {
+    return (std::min(demand.mWidth, demand.mHeight) >> (demand.mHalvings + 1)) >= mMinSize;
+  };
+
+  // 1. detail nobody can see
+  double total = 0.0, original = 0.0;
+  for (auto& pair : mDemands)
+  {
+    Demand& demand = pair.second;
+    int wanted = (int)std::floor(std::log2(1.0f / mNeededScale(demand)));
+    while (demand.mHalvings < wanted && canHalve(demand)) demand.mHalvings++;
+    demand.mFootprintHalvings = demand.mHalvings;
+
+    original += mBytes(demand, 0);
+    total += mBytes(demand, demand.mHalvings);
+  }
+
+  // 2. still too much, take from whoever has the most to spare
+  double budget = mBudgetMB * 1024.0 * 1024.0;
+  while (total > budget)
+  {
+    Demand* victim = nullptr;
+    float victimExcess = 0.0f;
+    for (auto& pair : mDemands)
+    {
+      Demand& demand = pair.second;
+      if (!canHalve(demand)) continue;
+
+      float excess = std::ldexp(1.0f, -demand.mHalvings) / mNeededScale(demand);
+      if (!victim || excess > victimExcess ||
+          (excess == victimExcess && mBytes(demand, demand.mHalvings) > mBytes(*victim, victim->mHalvings)))
+      {
+        victim = &demand;
+        victimExcess = excess;
+      }
+    }
+    if (!victim) break; // everything is at mMinSize
+
+    total -= mBytes(*victim, victim->mHalvings) - mBytes(*victim, victim->mHalvings + 1);
+    victim->mHalvings++;
+  }
+
+  const double mb = 1024.0 * 1024.0;
+  std::cout << "Texture budget: " << mBudgetMB << " MB, nearest view " << mNearestViewDistance << " m" << std::endl;
+  for (const auto& pair : mDemands)
+  {
+    const Demand& demand = pair.second;
+    std::cout << "  " << pair.first << "  "
+              << demand.mWidth << "x" << demand.mHeight << " -> "
+              << std::max(1, demand.mWidth >> demand.mHalvings) << "x" << std::max(1, demand.mHeight >> demand.mHalvings)
+              << std::fixed << std::setprecision(1)
+              << "  reclaimed " << (mBytes(demand, 0) - mBytes(demand, demand.mHalvings)) / mb << " MB"
+              << " [footprint " << demand.mFootprintHalvings << ", budget " << demand.mHalvings - demand.mFootprintHalvings << "]"
+              << std::defaultfloat << std::setprecision(6) << std::endl;
+  }
+  std::cout << "  total " << std::fixed << std::setprecision(1) << original / mb << " MB -> " << total / mb << " MB"
+            << (total > budget ? " [over budget, everything is at the minimum size]" : "")
+            << std::defaultfloat << std::setprecision(6) << std::endl;
+}
+
+
+int TextureBudget::mHalvings(const std::string& path) const
+{
+  auto found = mDemands.find(path);
+  return found != mDemands.end() ? found->second.mHalvings : 0;
+}
@@ -0,0 +1,48 @@
+#ifndef TEXTURE_BUDGET_HEADER
+#define TEXTURE_BUDGET_HEADER
+
+#include <map>
+#include <string>
+
+#include "mesh.hpp"
+
+// How many times every texture gets halved before it is uploaded
+//
+// 1. footprint: the densest instance of a texture [texels per meter, from its UV area over
+//    its scaled world area] against the pixels per meter of a surface mNearestViewDistance
+//    away. Halvings the screen can never show are free
+// 2. budget: while the total is over mBudgetMB, halve the one with the most detail left
+//    over its need [ties go to the bigger one]
+//
+// The halving itself is done by TextureCache [Lanczos resample, or skipping cooked mips]
+class TextureBudget
+{
+  public:
+    float mBudgetMB = 128.0f;
+    float mNearestViewDistance = 0.5f; // meters, the camera can't get closer to a surface
+    float mFovY = 45.0f;               // degrees
+    int mScreenHeight = 1080;
+    int mMinSize = 64;                 // never halved below this on the short side
+
+    void mAddInstance(const Mesh3D& mesh);
+    void mPlan(); // prints the report
+    int mHalvings(const std::string& path) const;
+
+  private:
+    struct Demand
+    {
+      int mWidth = 0;
+      int mHeight = 0;
+      float mBytesPerTexel = 4.0f;  // RGBA8, less when a cooked .ctex is there
+      float mTexelsPerMeter = 0.0f; // densest instance at full size
+      int mHalvings = 0;
+      int mFootprintHalvings = 0;
+    };
+
+    std::map<std::string, Demand> mDemands;
+
+    static bool mDescribe(const std::string& path, Demand* demand);
+    static double mBytes(const Demand& demand, int halvings); // with the mips
+    float mNeededScale(const Demand& demand) const;            // of full size, <= 1
+};
+#endif
@@ -0,0 +1,345 @@
+#include "../glad/glad.h"
+
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+
+#include "textureCache.hpp"
+#include "textureCompress.hpp"
+#include "imageResample.hpp"
+#include "assetArchive.hpp"
+#include "memoryRegistry.hpp"
+#include "stb_image.h"
+
+
+// the bytes get hashed and may move to the streamer, so mapped ones are copied out
+bool TextureCache::mReadFile(const char* path, std::vector<unsigned char>& bytes)
+{
+  size_t size = 0;
+  const unsigned char* data = gAssets.mLoad(path, &size, bytes);
+  if (!data) return false;
+
+  if (data != bytes.data()) bytes.assign(data, data + size);
+  return true;
+}
+
+
+// FNV-1a, same as the vertex welding in meshlet.cpp
+uint64_t TextureCache::mHashBytes(const std::vector<unsigned char>& bytes)
+{
+  uint64_t hash = 14695981039346656037ull;
+  for (unsigned char byte : bytes)
+  {
+    hash ^= byte;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+
+GLuint TextureCache::mUpload(const std::vector<unsigned char>& bytes, const char* path, int halvings, size_t* uploadedBytes)
+{
+  auto start = std::chrono::steady_clock::now();
+
+  stbi_set_flip_vertically_on_load(true); // This line fixed a bug which was so annoying  
+
+  // always 3 channels, that is what the texture is created as
+  int width, height, nChannels;
+  unsigned char* data = stbi_load_from_memory(bytes.data(), (int)bytes.size(), &width, &height, &nChannels, 3);
+
+  mDecodeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  mDecodes++;
+
+  if (!data)
+  {
+    std::cout << "Failed to decode texture: " << path << std::endl;
+    return 0;
+  }
+
+  std::vector<unsigned char> resampled;
+  if (halvings > 0)
+  {
+    int newWidth = std::max(1, width >> halvings), newHeight = std::max(1, height >> halvings);
+    resampled.resize((size_t)newWidth * newHeight * 3);
+    resampleImage(data, width, height, 3, resampled.data(), newWidth, newHeight);
+    width = newWidth;
+    height = newHeight;
+    mDownscaled++;
+  }
+
+  GLuint textureObject = 0;
+  glGenTextures(1, &textureObject);
+  glBindTexture(GL_TEXTURE_2D, textureObject);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // rows of 3 byte pixels aren't 4 byte aligned
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB8, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, resampled.empty() ? data : resampled.data());
+  glGenerateMipmap(GL_TEXTURE_2D);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+  stbi_image_free(data);
+
+  // drivers keep RGB8 as RGBA8, the mips add another third
+  *uploadedBytes = (size_t)width * height * 4 * 4 / 3;
+  gMemory.mTrackTexture(textureObject, *uploadedBytes, GL_RGB8, width, height, MemoryTextures, path);
+  return textureObject;
+}
+
+
+bool TextureCache::mCookedFormatSupported(GLenum internalFormat)
+{
+  if (internalFormat == GL_COMPRESSED_RGBA_BPTC_UNORM) return true; // core since 4.2
+  if (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT || internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT)
+    return GLAD_GL_EXT_texture_compression_s3tc;
+  return false;
+}
+
+
+GLuint TextureCache::mUploadCooked(const std::vector<unsigned char>& bytes, const char* path, int halvings, size_t* uploadedBytes)
+{
+  CookedTexture cooked;
+  if (!readCookedTexture(bytes.data(), bytes.size(), &cooked))
+  {
+    std::cout << "Broken cooked texture: " << path << std::endl;
+    return 0;
+  }
+
+  // the smaller sizes are already in there
+  if (halvings > 0)
+  {
+    dropCookedLevels(&cooked, halvings);
+    mDownscaled++;
+  }
+
+  GLuint textureObject = 0;
+  glGenTextures(1, &textureObject);
+  glBindTexture(GL_TEXTURE_2D, textureObject);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)cooked.mLevels.size() - 1);
+
+  int width = cooked.mWidth, height = cooked.mHeight;
+  for (size_t level = 0; level < cooked.mLevels.size(); level++)
+  {
+    glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, cooked.mInternalFormat, width, height, 0,
+                           (GLsizei)cooked.mLevels[level].size(), cooked.mLevels[level].data());
+    width = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+  }
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  mCookedLoads++;
+  *uploadedBytes = cookedTextureSize(cooked);
+  gMemory.mTrackTexture(textureObject, *uploadedBytes, cooked.mInternalFormat, cooked.mWidth, cooked.mHeight, MemoryTextures, path);
+  return textureObject;
+}
+
+
+// 1x1 grey, stands in for a texture the streamer is still working on
+GLuint TextureCache::mCreatePlaceholder()
+{
+  const unsigned char grey[4] = {128, 128, 128, 255};
+
+  GLuint textureObject = 0;
+  glGenTextures(1, &textureObject);
+  glBindTexture(GL_TEXTURE_2D, textureObject);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  gMemory.mTrackTexture(textureObject, GL_RGBA8, 1, 1, 1, 1, MemoryTextures, "placeholder");
+  return textureObject;
+}
+
+
+GLuint TextureCache::mAcquire(const char* path)
+{
+  mRequests++;
+
+  // 1. path seen before
+  auto knownPath = mHashOfPath.find(path);
+  if (knownPath != mHashOfPath.end())
+  {
+    Entry& entry = mEntries[knownPath->second];
+    if (entry.mTextureObject != 0)
+    {
+      entry.mRefCount++;
+      mBytesSaved += entry.mBytes;
+      return entry.mTextureObject;
+    }
+  }
+
+  // 2. new path, maybe a copy of an image we already have [cooked file wins]
+  std::string cookedPath = std::string(path) + ".ctex";
+  std::vector<unsigned char> bytes;
+  bool cooked = mReadFile(cookedPath.c_str(), bytes);
+  if (!cooked && !mReadFile(path, bytes))
+  {
+    std::cout << "Failed to read texture: " << path << std::endl;
+    return 0;
+  }
+
+  uint64_t hash = mHashBytes(bytes);
+  mHashOfPath[path] = hash;
+
+  Entry& entry = mEntries[hash];
+  if (entry.mTextureObject != 0)
+  {
+    entry.mRefCount++;
+    mBytesSaved += entry.mBytes;
+    return entry.mTextureObject;
+  }
+
+  // 3. never seen, decode + upload [the source image when this GL can't take the cooked one]
+  auto halvingsOfPath = mHalvingsOfPath.find(path);
+  int halvings = halvingsOfPath != mHalvingsOfPath.end() ? halvingsOfPath->second : 0;
+
+  if (cooked && !mCookedFormatSupported(readCookedTextureFormat(bytes.data(), bytes.size())))
+  {
+    cooked = false;
+    if (!mReadFile(path, bytes)) bytes.clear();
+  }
+
+  if (!bytes.empty() && mStreamer && mStreamer->mRunning())
+  {
+    // worker decodes + uploads, mFinishUploads swaps the placeholder out
+    entry.mTextureObject = mCreatePlaceholder();
+    entry.mBytes = 4;
+    entry.mPending = true;
+    mStreamer->mRequest(std::move(bytes), cooked, cooked ? cookedPath.c_str() : path, halvings, entry.mTextureObject);
+  }
+  else if (cooked) entry.mTextureObject = mUploadCooked(bytes, cookedPath.c_str(), halvings, &entry.mBytes);
+  else if (!bytes.empty()) entry.mTextureObject = mUpload(bytes, path, halvings, &entry.mBytes);
+
+  if (entry.mTextureObject == 0)
+  {
+    mEntries.erase(hash);
+    mHashOfPath.erase(path);
+    return 0;
+  }
+
+  entry.mHash = hash;
+  entry.mRefCount = 1;
+  mBytesUploaded += entry.mBytes;
+  mHashOfTexture[entry.mTextureObject] = hash;
+  return entry.mTextureObject;
+}
+
+
+void TextureCache::mRelease(GLuint textureObject)
+{
+  auto found = mHashOfTexture.find(textureObject);
+  if (found == mHashOfTexture.end()) return;
+
+  uint64_t hash = found->second;
+  Entry& entry = mEntries[hash];
+  if (--entry.mRefCount > 0) return;
+
+  // the worker still has it, both go once the upload comes back
+  if (entry.mPending) mOrphanedUploads.insert(entry.mTextureObject);
+  else gMemory.mDeleteTextures(1, &entry.mTextureObject);
+  mHashOfTexture.erase(found);
+  mEntries.erase(hash);
+
+  // paths pointing at it would hand out a dead texture
+  for (auto it = mHashOfPath.begin(); it != mHashOfPath.end();)
+  {
+    if (it->second == hash) it = mHashOfPath.erase(it);
+    else ++it;
+  }
+}
+
+
+void TextureCache::mFinishUploads(std::vector<TextureSwap>& swaps)
+{
+  if (!mStreamer) return;
+
+  mFinished.clear(); // keeps its capacity, this runs every frame
+  mStreamer->mCollect(mFinished);
+
+  for (const TextureStreamer::Finished& upload : mFinished)
+  {
+    if (upload.mDownscaled) mDownscaled++;
+    if (upload.mCooked) mCookedLoads++;
+    else
+    {
+      mDecodes++;
+      mDecodeMs += upload.mDecodeMs;
+    }
+
+    if (mOrphanedUploads.erase(upload.mPlaceholder))
+    {
+      gMemory.mDeleteTextures(1, &upload.mPlaceholder);
+      if (upload.mTexture != 0) gMemory.mDeleteTextures(1, &upload.mTexture);
+      continue;
+    }
+
+    auto found = mHashOfTexture.find(upload.mPlaceholder);
+    if (found == mHashOfTexture.end()) continue;
+
+    uint64_t hash = found->second;
+    Entry& entry = mEntries[hash];
+    entry.mPending = false;
+    if (upload.mTexture == 0) continue; // stays grey
+
+    mBytesUploaded += upload.mBytes - entry.mBytes;
+    entry.mBytes = upload.mBytes;
+    entry.mTextureObject = upload.mTexture;
+    mHashOfTexture.erase(found);
+    mHashOfTexture[upload.mTexture] = hash;
+    swaps.push_back({upload.mPlaceholder, upload.mTexture});
+  }
+}
+
+
+void TextureCache::mDeletePlaceholders(const std::vector<TextureSwap>& swaps)
+{
+  for (const TextureSwap& swap : swaps) gMemory.mDeleteTextures(1, &swap.mOld);
+}
+
+
+// TextureResidency copied these into its arrays, the entry keeps the copy and the
+// original goes [the report and mBytes stay per image, the VRAM is the array's now]
+void TextureCache::mAdoptMoves(const std::vector<TextureSwap>& moves)
+{
+  for (const TextureSwap& move : moves)
+  {
+    auto found = mHashOfTexture.find(move.mOld);
+    if (found == mHashOfTexture.end()) continue;
+
+    uint64_t hash = found->second;
+    mEntries[hash].mTextureObject = move.mNew;
+    mHashOfTexture.erase(found);
+    mHashOfTexture[move.mNew] = hash;
+    gMemory.mDeleteTextures(1, &move.mOld);
+  }
+}
+
+
+int TextureCache::mPendingUploads() const
+{
+  return mStreamer ? mStreamer->mPending() : 0;
+}
+
+
+void TextureCache::mPrintReport() const
+{
+  std::cout << "Textures: " << mRequests << " requests, "
+            << mEntries.size() << " unique, "
+            << mDecodes << " decoded in " << mDecodeMs << " ms, "
+            << mCookedLoads << " cooked, "
+            << mDownscaled << " downscaled, "
+            << mPendingUploads() << " uploading, "
+            << mBytesUploaded / (1024.0 * 1024.0) << " MB in VRAM, "
+            << mBytesSaved / (1024.0 * 1024.0) << " MB saved" << std::endl;
+}
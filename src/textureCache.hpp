@@ -0,0 +1,85 @@
+#ifndef TEXTURE_CACHE_HEADER
+#define TEXTURE_CACHE_HEADER
+
+#include "../glad/glad.h"
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "textureStreamer.hpp"
+
+// One GL texture per distinct image
+//
+// Paths are looked up first [no file access at all], a new path is read and hashed, and
+// only content that was never seen before gets decoded and uploaded. Every mAcquire has to
+// be paired with a mRelease, the texture is deleted when the last user lets go
+//
+// A cooked <path>.ctex next to the image [textureCooker/cook.cpp] is used instead of it:
+// compressed blocks with all the mips, no decode and no glGenerateMipmap
+//
+// With a TextureStreamer the decode + upload move to its thread: mAcquire hands out a
+// grey placeholder right away and mFinishUploads later reports [placeholder -> texture]
+// swaps, whoever kept the old name has to switch over before mDeletePlaceholders
+//
+// mSetHalvings [from TextureBudget] shrinks a path before upload: the image is resampled,
+// a cooked one just loses its top mips. Whoever asks first for a content decides its size
+
+struct TextureSwap
+{
+  GLuint mOld;
+  GLuint mNew;
+};
+
+class TextureCache
+{
+  public:
+    GLuint mAcquire(const char* path); // 0 when the file can't be read or decoded
+    void mRelease(GLuint textureObject);
+    void mPrintReport() const;
+    void mSetHalvings(const char* path, int halvings) { mHalvingsOfPath[path] = halvings; }
+
+    void mSetStreamer(TextureStreamer* streamer) { mStreamer = streamer; }
+    void mFinishUploads(std::vector<TextureSwap>& swaps); // never blocks
+    void mDeletePlaceholders(const std::vector<TextureSwap>& swaps); // once nobody uses the old names
+    void mAdoptMoves(const std::vector<TextureSwap>& moves); // copies [array layer views] replace the originals
+    int mPendingUploads() const;
+
+    // report
+    int mRequests = 0;
+    int mDecodes = 0;
+    int mCookedLoads = 0;
+    double mDecodeMs = 0.0;
+    size_t mBytesUploaded = 0;
+    size_t mBytesSaved = 0; // what the duplicates would have taken in VRAM
+    int mDownscaled = 0;
+
+  private:
+    struct Entry
+    {
+      GLuint mTextureObject = 0;
+      uint64_t mHash = 0;
+      int mRefCount = 0;
+      size_t mBytes = 0; // with the mip chain
+      bool mPending = false; // mTextureObject is still the placeholder
+    };
+
+    TextureStreamer* mStreamer = nullptr;
+    std::vector<TextureStreamer::Finished> mFinished; // mFinishUploads' scratch
+    std::set<GLuint> mOrphanedUploads; // placeholders released before their upload finished
+
+    std::map<std::string, uint64_t> mHashOfPath;
+    std::map<uint64_t, Entry> mEntries;       // by content hash
+    std::map<GLuint, uint64_t> mHashOfTexture;
+    std::map<std::string, int> mHalvingsOfPath;
+
+    static bool mReadFile(const char* path, std::vector<unsigned char>& bytes);
+    static uint64_t mHashBytes(const std::vector<unsigned char>& bytes);
+    GLuint mUpload(const std::vector<unsigned char>& bytes, const char* path, int halvings, size_t* uploadedBytes);
+    GLuint mUploadCooked(const std::vector<unsigned char>& bytes, const char* path, int halvings, size_t* uploadedBytes);
+    GLuint mCreatePlaceholder();
+    static bool mCookedFormatSupported(GLenum internalFormat);
+};
+#endif
@@ -0,0 +1,667 @@
+#include "../glad/glad.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <cfloat>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "textureCompress.hpp"
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ SHARED ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// One 4x4 block as channel planes, so 4 pixels fit in a register
+struct BlockPixels
+{
+  float mChannel[4][16];
+};
+
+
+static void loadBlock(const unsigned char* rgba, BlockPixels* block)
+{
+  for (int i = 0; i < 16; i++)
+  {
+    for (int c = 0; c < 4; c++) block->mChannel[c][i] = rgba[i * 4 + c];
+  }
+}
+
+
+// Closest palette entry for every pixel, returns the summed squared error
+static float matchPalette(const BlockPixels& block, const float (*palette)[4], int paletteSize, int channels, unsigned char* indices)
+{
+#if defined(__SSE2__)
+  __m128 total = _mm_setzero_ps();
+
+  for (int group = 0; group < 4; group++)
+  {
+    __m128 pixels[4];
+    for (int c = 0; c < channels; c++) pixels[c] = _mm_loadu_ps(&block.mChannel[c][group * 4]);
+
+    __m128 best = _mm_set1_ps(FLT_MAX);
+    __m128 bestIndex = _mm_setzero_ps();
+
+    for (int k = 0; k < paletteSize; k++)
+    {
+      __m128 distance = _mm_setzero_ps();
+      for (int c = 0; c < channels; c++)
+      {
+        __m128 difference = _mm_sub_ps(pixels[c], _mm_set1_ps(palette[k][c]));
+        distance = _mm_add_ps(distance, _mm_mul_ps(difference, difference));
+      }
+
+      __m128 better = _mm_cmplt_ps(distance, best);
+      best = _mm_min_ps(best, distance);
+      bestIndex = _mm_or_ps(_mm_and_ps(better, _mm_set1_ps((float)k)), _mm_andnot_ps(better, bestIndex));
+    }
+
+    total = _mm_add_ps(total, best);
+
+    if (indices)
+    {
+      int lanes[4];
+      _mm_storeu_si128((__m128i*)lanes, _mm_cvttps_epi32(bestIndex));
+      for (int j = 0; j < 4; j++) indices[group * 4 + j] = (unsigned char)lanes[j];
+    }
+  }
+
+  float sums[4];
+  _mm_storeu_ps(sums, total);
+  return sums[0] + sums[1] + sums[2] + sums[3];
+#else
+  float total = 0.0f;
+  for (int i = 0; i < 16; i++)
+  {
+    float best = FLT_MAX;
+    int bestIndex = 0;
+    for (int k = 0; k < paletteSize; k++)
+    {
+      float distance = 0.0f;
+      for (int c = 0; c < channels; c++)
+      {
+        float difference = block.mChannel[c][i] - palette[k][c];
+        distance += difference * difference;
+      }
+      if (distance < best)
+      {
+        best = distance;
+        bestIndex = k;
+      }
+    }
+    total += best;
+    if (indices) indices[i] = (unsigned char)bestIndex;
+  }
+  return total;
+#endif
+}
+
+
+// Principal axis of the block by power iteration, endpoints are where the pixels
+// project furthest along it
+static void principalEndpoints(const BlockPixels& block, int channels, float* low, float* high)
+{
+  float mean[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  for (int c = 0; c < channels; c++)
+  {
+    for (int i = 0; i < 16; i++) mean[c] += block.mChannel[c][i];
+    mean[c] /= 16.0f;
+  }
+
+  float covariance[4][4] = {};
+  for (int i = 0; i < 16; i++)
+  {
+    for (int a = 0; a < channels; a++)
+    {
+      for (int b = 0; b < channels; b++)
+      {
+        covariance[a][b] += (block.mChannel[a][i] - mean[a]) * (block.mChannel[b][i] - mean[b]);
+      }
+    }
+  }
+
+  float axis[4] = {1.0f, 1.0f, 1.0f, 1.0f};
+  for (int iteration = 0; iteration < 8; iteration++)
+  {
+    float next[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    float length = 0.0f;
+    for (int a = 0; a < channels; a++)
+    {
+      for (int b = 0; b < channels; b++) next[a] += covariance[a][b] * axis[b];
+      length += next[a] * next[a];
+    }
+    if (length < 1e-12f) break; // flat block
+    length = std::sqrt(length);
+    for (int a = 0; a < channels; a++) axis[a] = next[a] / length;
+  }
+
+  float minT = FLT_MAX, maxT = -FLT_MAX;
+  for (int i = 0; i < 16; i++)
+  {
+    float t = 0.0f;
+    for (int c = 0; c < channels; c++) t += (block.mChannel[c][i] - mean[c]) * axis[c];
+    minT = std::min(minT, t);
+    maxT = std::max(maxT, t);
+  }
+
+  for (int c = 0; c < channels; c++)
+  {
+    low[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * minT));
+    high[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * maxT));
+  }
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ BC1 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static const int gBC1Max[3] = {31, 63, 31};
+
+
+static uint16_t packRGB565(const int* c)
+{
+  return (uint16_t)((c[0] << 11) | (c[1] << 5) | c[2]);
+}
+
+
+static void expandRGB565(const int* c, float* out)
+{
+  out[0] = (float)((c[0] << 3) | (c[0] >> 2));
+  out[1] = (float)((c[1] << 2) | (c[1] >> 4));
+  out[2] = (float)((c[2] << 3) | (c[2] >> 2));
+  out[3] = 255.0f;
+}
+
+
+static void bc1Palette(const int* c0, const int* c1, float palette[4][4])
+{
+  expandRGB565(c0, palette[0]);
+  expandRGB565(c1, palette[1]);
+  for (int c = 0; c < 4; c++)
+  {
+    palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+    palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+  }
+}
+
+
+static float bc1Error(const BlockPixels& block, const int* c0, const int* c1)
+{
+  float palette[4][4];
+  bc1Palette(c0, c1, palette);
+  return matchPalette(block, palette, 4, 3, nullptr);
+}
+
+
+void encodeBC1Block(const unsigned char* rgba, unsigned char* out)
+{
+  BlockPixels block;
+  loadBlock(rgba, &block);
+
+  float low[4], high[4];
+  principalEndpoints(block, 3, low, high);
+
+  int endpoints[2][3];
+  for (int c = 0; c < 3; c++)
+  {
+    endpoints[0][c] = (int)std::lround(high[c] * gBC1Max[c] / 255.0f);
+    endpoints[1][c] = (int)std::lround(low[c] * gBC1Max[c] / 255.0f);
+  }
+
+  // 1. walk the endpoints one 565 step at a time while the error goes down
+  float bestError = bc1Error(block, endpoints[0], endpoints[1]);
+  for (int iteration = 0; iteration < 16 && bestError > 0.0f; iteration++)
+  {
+    bool improved = false;
+    for (int e = 0; e < 2; e++)
+    {
+      for (int c = 0; c < 3; c++)
+      {
+        for (int delta = -1; delta <= 1; delta += 2)
+        {
+          int previous = endpoints[e][c];
+          int candidate = previous + delta;
+          if (candidate < 0 || candidate > gBC1Max[c]) continue;
+
+          endpoints[e][c] = candidate;
+          float error = bc1Error(block, endpoints[0], endpoints[1]);
+          if (error < bestError)
+          {
+            bestError = error;
+            improved = true;
+          }
+          else endpoints[e][c] = previous;
+        }
+      }
+    }
+    if (!improved) break;
+  }
+
+  // 2. color0 > color1 selects the 4 color mode
+  uint16_t color0 = packRGB565(endpoints[0]);
+  uint16_t color1 = packRGB565(endpoints[1]);
+  if (color0 < color1)
+  {
+    std::swap(color0, color1);
+    std::swap(endpoints[0], endpoints[1]);
+  }
+
+  unsigned char indices[16] = {};
+  if (color0 != color1)
+  {
+    float palette[4][4];
+    bc1Palette(endpoints[0], endpoints[1], palette);
+    matchPalette(block, palette, 4, 3, indices);
+  }
+
+  uint32_t bits = 0;
+  for (int i = 0; i < 16; i++) bits |= (uint32_t)indices[i] << (i * 2);
+
+  out[0] = color0 & 0xFF;
+  out[1] = color0 >> 8;
+  out[2] = color1 & 0xFF;
+  out[3] = color1 >> 8;
+  for (int i = 0; i < 4; i++) out[4 + i] = (bits >> (i * 8)) & 0xFF;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ BC3 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// BC4 style alpha: two 8 bit endpoints, 6 levels in between, 3 bit indices
+static void encodeAlphaBlock(const unsigned char* rgba, unsigned char* out)
+{
+  BlockPixels alpha;
+  int low = 255, high = 0;
+  for (int i = 0; i < 16; i++)
+  {
+    alpha.mChannel[0][i] = rgba[i * 4 + 3];
+    low = std::min(low, (int)rgba[i * 4 + 3]);
+    high = std::max(high, (int)rgba[i * 4 + 3]);
+  }
+
+  unsigned char indices[16] = {};
+  if (high != low)
+  {
+    float palette[8][4] = {};
+    palette[0][0] = (float)high;
+    palette[1][0] = (float)low;
+    for (int i = 1; i < 7; i++) palette[i + 1][0] = ((7 - i) * high + i * low) / 7.0f;
+    matchPalette(alpha, palette, 8, 1, indices);
+  }
+
+  uint64_t bits = 0;
+  for (int i = 0; i < 16; i++) bits |= (uint64_t)indices[i] << (i * 3);
+
+  out[0] = (unsigned char)high;
+  out[1] = (unsigned char)low;
+  for (int i = 0; i < 6; i++) out[2 + i] = (bits >> (i * 8)) & 0xFF;
+}
+
+
+void encodeBC3Block(const unsigned char* rgba, unsigned char* out)
+{
+  encodeAlphaBlock(rgba, out);
+  encodeBC1Block(rgba, out + 8);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ BC7 ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Mode 6: RGBA endpoints of 7 bits + a shared low bit [p-bit] each, 4 bit indices
+
+static const int gBC7Weights[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct BC7Endpoints
+{
+  int mValue[2][4]; // 7 bits
+  int mPBit[2];
+};
+
+
+static void bc7Palette(const BC7Endpoints& endpoints, float palette[16][4])
+{
+  for (int c = 0; c < 4; c++)
+  {
+    int e0 = (endpoints.mValue[0][c] << 1) | endpoints.mPBit[0];
+    int e1 = (endpoints.mValue[1][c] << 1) | endpoints.mPBit[1];
+    for (int k = 0; k < 16; k++)
+    {
+      palette[k][c] = (float)(((64 - gBC7Weights[k]) * e0 + gBC7Weights[k] * e1 + 32) >> 6);
+    }
+  }
+}
+
+
+static float bc7Error(const BlockPixels& block, const BC7Endpoints& endpoints)
+{
+  float palette[16][4];
+  bc7Palette(endpoints, palette);
+  return matchPalette(block, palette, 16, 4, nullptr);
+}
+
+
+// picks the p-bit that lands the whole endpoint closest
+static void quantizeBC7Endpoint(const float* color, int* value, int* pBit)
+{
+  float bestError = FLT_MAX;
+  for (int p = 0; p < 2; p++)
+  {
+    int candidate[4];
+    float error = 0.0f;
+    for (int c = 0; c < 4; c++)
+    {
+      candidate[c] = std::min(127, std::max(0, (int)std::lround((color[c] - p) / 2.0f)));
+      float difference = ((candidate[c] << 1) | p) - color[c];
+      error += difference * difference;
+    }
+    if (error < bestError)
+    {
+      bestError = error;
+      *pBit = p;
+      for (int c = 0; c < 4; c++) value[c] = candidate[c];
+    }
+  }
+}
+
+
+struct BitWriter
+{
+  unsigned char* mOut;
+  int mPosition = 0;
+
+  void mWrite(uint32_t value, int count)
+  {
+    for (int i = 0; i < count; i++, mPosition++)
+    {
+      if (value & (1u << i)) mOut[mPosition >> 3] |= (unsigned char)(1u << (mPosition & 7));
+    }
+  }
+};
+
+
+void encodeBC7Block(const unsigned char* rgba, unsigned char* out)
+{
+  BlockPixels block;
+  loadBlock(rgba, &block);
+
+  float low[4], high[4];
+  principalEndpoints(block, 4, low, high);
+
+  BC7Endpoints endpoints;
+  quantizeBC7Endpoint(low, endpoints.mValue[0], &endpoints.mPBit[0]);
+  quantizeBC7Endpoint(high, endpoints.mValue[1], &endpoints.mPBit[1]);
+
+  // 1. same walk as BC1, p-bits can flip too
+  float bestError = bc7Error(block, endpoints);
+  for (int iteration = 0; iteration < 16 && bestError > 0.0f; iteration++)
+  {
+    bool improved = false;
+    for (int e = 0; e < 2; e++)
+    {
+      for (int c = 0; c <= 4; c++)
+      {
+        for (int delta = -1; delta <= 1; delta += 2)
+        {
+          if (c == 4 && delta > 0) continue; // one p-bit flip is enough
+
+          BC7Endpoints candidate = endpoints;
+          if (c == 4) candidate.mPBit[e] ^= 1;
+          else
+          {
+            candidate.mValue[e][c] += delta;
+            if (candidate.mValue[e][c] < 0 || candidate.mValue[e][c] > 127) continue;
+          }
+
+          float error = bc7Error(block, candidate);
+          if (error < bestError)
+          {
+            bestError = error;
+            endpoints = candidate;
+            improved = true;
+          }
+        }
+      }
+    }
+    if (!improved) break;
+  }
+
+  float palette[16][4];
+  unsigned char indices[16];
+  bc7Palette(endpoints, palette);
+  matchPalette(block, palette, 16, 4, indices);
+
+  // 2. first index is stored with 3 bits, its top bit has to be 0
+  if (indices[0] >= 8)
+  {
+    std::swap(endpoints.mValue[0], endpoints.mValue[1]);
+    std::swap(endpoints.mPBit[0], endpoints.mPBit[1]);
+    for (int i = 0; i < 16; i++) indices[i] = 15 - indices[i];
+  }
+
+  memset(out, 0, 16);
+  BitWriter writer;
+  writer.mOut = out;
+  writer.mWrite(1u << 6, 7); // mode 6
+  for (int c = 0; c < 4; c++)
+  {
+    writer.mWrite(endpoints.mValue[0][c], 7);
+    writer.mWrite(endpoints.mValue[1][c], 7);
+  }
+  writer.mWrite(endpoints.mPBit[0], 1);
+  writer.mWrite(endpoints.mPBit[1], 1);
+  for (int i = 0; i < 16; i++) writer.mWrite(indices[i], i == 0 ? 3 : 4);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ MIPS + LEVELS ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+// 2x2 box filter, odd edges reuse the last row/column
+static void downsample(const std::vector<unsigned char>& source, int width, int height,
+                       std::vector<unsigned char>& destination, int newWidth, int newHeight)
+{
+  destination.resize((size_t)newWidth * newHeight * 4);
+  for (int y = 0; y < newHeight; y++)
+  {
+    int y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+    for (int x = 0; x < newWidth; x++)
+    {
+      int x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+      for (int c = 0; c < 4; c++)
+      {
+        int sum = source[((size_t)y0 * width + x0) * 4 + c] + source[((size_t)y0 * width + x1) * 4 + c] +
+                  source[((size_t)y1 * width + x0) * 4 + c] + source[((size_t)y1 * width + x1) * 4 + c];
+        destination[((size_t)y * newWidth + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+      }
+    }
+  }
+}
+
+
+static void encodeLevel(const std::vector<unsigned char>& rgba, int width, int height, GLenum internalFormat, std::vector<unsigned char>& out)
+{
+  int blockBytes = internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+  int blocksX = (width + 3) / 4;
+  int blocksY = (height + 3) / 4;
+  out.resize((size_t)blocksX * blocksY * blockBytes);
+
+  unsigned char pixels[64];
+  for (int by = 0; by < blocksY; by++)
+  {
+    for (int bx = 0; bx < blocksX; bx++)
+    {
+      // blocks hanging over the edge repeat the last pixel
+      for (int y = 0; y < 4; y++)
+      {
+        int sy = std::min(by * 4 + y, height - 1);
+        for (int x = 0; x < 4; x++)
+        {
+          int sx = std::min(bx * 4 + x, width - 1);
+          memcpy(&pixels[(y * 4 + x) * 4], &rgba[((size_t)sy * width + sx) * 4], 4);
+        }
+      }
+
+      unsigned char* block = &out[((size_t)by * blocksX + bx) * blockBytes];
+      if (internalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT) encodeBC1Block(pixels, block);
+      else if (internalFormat == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT) encodeBC3Block(pixels, block);
+      else encodeBC7Block(pixels, block);
+    }
+  }
+}
+
+
+bool cookTexture(const unsigned char* rgba, int width, int height, GLenum internalFormat, CookedTexture* cooked)
+{
+  if (width <= 0 || height <= 0) return false;
+  if (internalFormat != GL_COMPRESSED_RGB_S3TC_DXT1_EXT &&
+      internalFormat != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT &&
+      internalFormat != GL_COMPRESSED_RGBA_BPTC_UNORM) return false;
+
+  cooked->mInternalFormat = internalFormat;
+  cooked->mWidth = width;
+  cooked->mHeight = height;
+  cooked->mLevels.clear();
+
+  std::vector<unsigned char> level(rgba, rgba + (size_t)width * height * 4);
+  std::vector<unsigned char> next;
+  while (true)
+  {
+    cooked->mLevels.emplace_back();
+    encodeLevel(level, width, height, internalFormat, cooked->mLevels.back());
+    if (width == 1 && height == 1) break;
+
+    int newWidth = std::max(1, width / 2);
+    int newHeight = std::max(1, height / 2);
+    downsample(level, width, height, next, newWidth, newHeight);
+    level.swap(next);
+    width = newWidth;
+    height = newHeight;
+  }
+  return true;
+}
+
+
+size_t textureBytes(GLenum internalFormat, int width, int height, int levels, int layers)
+{
+  // bytes per 4x4 block for the compressed ones, per texel for the rest
+  size_t block = 0, texel = 4;
+  switch (internalFormat)
+  {
+    case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+    case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+      block = 8;
+      break;
+    case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+    case GL_COMPRESSED_RGBA_BPTC_UNORM:
+      block = 16;
+      break;
+    case GL_R8:
+      texel = 1;
+      break;
+    default:
+      texel = 4; // RGBA8, RGB8 [padded], R32F, the depth formats
+      break;
+  }
+
+  size_t bytes = 0;
+  for (int level = 0; level < std::max(levels, 1); level++)
+  {
+    size_t w = std::max(1, width >> level), h = std::max(1, height >> level);
+    bytes += block ? ((w + 3) / 4) * ((h + 3) / 4) * block : w * h * texel;
+  }
+  return bytes * std::max(layers, 1);
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ CONTAINER ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+static const char gCookedMagic[4] = {'C', 'T', 'E', 'X'};
+static const uint32_t gCookedVersion = 1;
+
+
+size_t cookedTextureSize(const CookedTexture& cooked)
+{
+  size_t size = 0;
+  for (const std::vector<unsigned char>& level : cooked.mLevels) size += level.size();
+  return size;
+}
+
+
+void dropCookedLevels(CookedTexture* cooked, int count)
+{
+  count = std::min(count, (int)cooked->mLevels.size() - 1);
+  if (count <= 0) return;
+
+  cooked->mLevels.erase(cooked->mLevels.begin(), cooked->mLevels.begin() + count);
+  cooked->mWidth = std::max(1, cooked->mWidth >> count);
+  cooked->mHeight = std::max(1, cooked->mHeight >> count);
+}
+
+
+bool writeCookedTexture(const char* path, const CookedTexture& cooked)
+{
+  FILE* fp = fopen(path, "wb");
+  if (!fp) return false;
+
+  uint32_t header[5] = {gCookedVersion, (uint32_t)cooked.mInternalFormat, (uint32_t)cooked.mWidth,
+                        (uint32_t)cooked.mHeight, (uint32_t)cooked.mLevels.size()};
+  bool ok = fwrite(gCookedMagic, 1, 4, fp) == 4 && fwrite(header, sizeof(header), 1, fp) == 1;
+
+  for (const std::vector<unsigned char>& level : cooked.mLevels)
+  {
+    uint32_t size = (uint32_t)level.size();
+    ok = ok && fwrite(&size, sizeof(size), 1, fp) == 1 && fwrite(level.data(), 1, size, fp) == size;
+  }
+
+  fclose(fp);
+  return ok;
+}
+
+
+GLenum readCookedTextureFormat(const unsigned char* bytes, size_t size)
+{
+  uint32_t header[5];
+  if (size < 4 + sizeof(header) || memcmp(bytes, gCookedMagic, 4) != 0) return 0;
+  memcpy(header, bytes + 4, sizeof(header));
+  return header[0] == gCookedVersion ? header[1] : 0;
+}
+
+
+bool readCookedTexture(const unsigned char* bytes, size_t size, CookedTexture* cooked)
+{
+  uint32_t header[5];
+  if (readCookedTextureFormat(bytes, size) == 0) return false;
+  memcpy(header, bytes + 4, sizeof(header));
+
+  // nothing is trusted: at most the full chain, every level exactly its blocks
+  if (header[1] != GL_COMPRESSED_RGB_S3TC_DXT1_EXT && header[1] != GL_COMPRESSED_RGBA_S3TC_DXT5_EXT &&
+      header[1] != GL_COMPRESSED_RGBA_BPTC_UNORM) return false;
+  if (header[2] == 0 || header[3] == 0 || header[2] > 16384 || header[3] > 16384) return false;
+
+  int width = (int)header[2], height = (int)header[3];
+  uint32_t maxLevels = 1;
+  for (int side = std::max(width, height); side > 1; side /= 2) maxLevels++;
+  if (header[4] == 0 || header[4] > maxLevels) return false;
+
+  cooked->mInternalFormat = header[1];
+  cooked->mWidth = width;
+  cooked->mHeight = height;
+  cooked->mLevels.resize(header[4]);
+
+  size_t offset = 4 + sizeof(header);
+  for (size_t i = 0; i < cooked->mLevels.size(); i++)
+  {
+    uint32_t levelSize;
+    if (offset + sizeof(levelSize) > size) return false;
+    memcpy(&levelSize, bytes + offset, sizeof(levelSize));
+    offset += sizeof(levelSize);
+
+    size_t expected = textureBytes(cooked->mInternalFormat, std::max(1, width >> i), std::max(1, height >> i), 1);
+    if (levelSize != expected || levelSize > size - offset) return false;
+    cooked->mLevels[i].assign(bytes + offset, bytes + offset + levelSize);
+    offset += levelSize;
+  }
+  return true;
+}
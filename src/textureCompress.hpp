@@ -0,0 +1,46 @@
+#ifndef TEXTURE_COMPRESS_HEADER
+#define TEXTURE_COMPRESS_HEADER
+
+#include "../glad/glad.h"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+// Block compression for the offline texture cooker [textureCooker/cook.cpp]
+//
+//   GL_COMPRESSED_RGB_S3TC_DXT1_EXT   BC1, 4 bpp, opaque images
+//   GL_COMPRESSED_RGBA_S3TC_DXT5_EXT  BC3, 8 bpp, BC1 color + BC4 alpha
+//   GL_COMPRESSED_RGBA_BPTC_UNORM     BC7, 8 bpp, mode 6 only [one subset, 16 levels]
+//
+// Endpoints start on the principal axis of the block and are refined one step at a
+// time, every candidate is scored against all 16 pixels with SSE
+//
+// Cooked files [.ctex] are a tiny KTX-like container:
+//   "CTEX", version, GL internal format, width, height, level count
+//   then per level [largest first] a byte size and the blocks
+
+struct CookedTexture
+{
+  GLenum mInternalFormat = 0;
+  int mWidth = 0;
+  int mHeight = 0;
+  std::vector<std::vector<unsigned char>> mLevels;
+};
+
+// Bytes of a [mip chained] texture, BC formats by block [the memory registry's sizes too]
+size_t textureBytes(GLenum internalFormat, int width, int height, int levels, int layers = 1);
+
+void encodeBC1Block(const unsigned char* rgba, unsigned char* out);     // 16 pixels in, 8 bytes out
+void encodeBC3Block(const unsigned char* rgba, unsigned char* out);     // 16 bytes out
+void encodeBC7Block(const unsigned char* rgba, unsigned char* out);     // 16 bytes out
+
+// rgba is width * height * 4, the full mip chain is built and encoded
+bool cookTexture(const unsigned char* rgba, int width, int height, GLenum internalFormat, CookedTexture* cooked);
+
+size_t cookedTextureSize(const CookedTexture& cooked);
+void dropCookedLevels(CookedTexture* cooked, int count); // largest first, the smallest one always stays
+bool writeCookedTexture(const char* path, const CookedTexture& cooked);
+bool readCookedTexture(const unsigned char* bytes, size_t size, CookedTexture* cooked);
+GLenum readCookedTextureFormat(const unsigned char* bytes, size_t size); // header only, 0 if not a .ctex
+#endif
@@ -0,0 +1,165 @@
+#include "../glad/glad.h"
+
+#include <iostream>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <cmath>
+
+#include "textureResidency.hpp"
+#include "memoryRegistry.hpp"
+
+
+void TextureResidency::mInit()
+{
+  mBindless = GLAD_GL_ARB_bindless_texture != 0;
+  std::cout << "Textures: " << (mBindless ? "bindless handles" : "texture arrays") << std::endl;
+}
+
+
+TextureResidency::ArrayKey TextureResidency::mDescribe(GLuint texture)
+{
+  GLint width = 0, height = 0, format = 0, immutable = 0, levels = 1;
+
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+  glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable);
+
+  if (immutable) glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+  else
+  {
+    // mutable ones are either full chains [glGenerateMipmap] or capped by MAX_LEVEL [cooked]
+    GLint maxLevel = 1000;
+    glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, &maxLevel);
+    GLint fullChain = 1 + (GLint)std::floor(std::log2((float)std::max(1, std::max(width, height))));
+    levels = std::min(maxLevel + 1, fullChain);
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  // immutable goes in the sign of the level count, so it splits groups too
+  return ArrayKey(width, height, format, immutable ? -levels : levels);
+}
+
+
+void TextureResidency::mRelease()
+{
+  // textures that went away were mForget-ed first, every handle left is still alive
+  for (const auto& pair : mSlots)
+  {
+    if (pair.second.mHandle != 0) glMakeTextureHandleNonResidentARB(pair.second.mHandle);
+  }
+  mSlots.clear();
+
+  if (!mArrays.empty()) gMemory.mDeleteTextures((GLsizei)mArrays.size(), mArrays.data());
+  mArrays.clear();
+}
+
+
+void TextureResidency::mBuild(const std::vector<GLuint>& textures, std::vector<TextureSwap>* moves)
+{
+  mRelease();
+
+  std::vector<GLuint> unique;
+  for (GLuint texture : textures)
+  {
+    if (texture != 0 && std::find(unique.begin(), unique.end(), texture) == unique.end()) unique.push_back(texture);
+  }
+
+  if (mBindless)
+  {
+    for (GLuint texture : unique)
+    {
+      TextureSlot slot;
+      slot.mHandle = glGetTextureHandleARB(texture);
+      glMakeTextureHandleResidentARB(slot.mHandle);
+      mSlots[texture] = slot;
+    }
+    std::cout << "Textures: " << mSlots.size() << " resident handles" << std::endl;
+    return;
+  }
+
+  std::map<ArrayKey, std::vector<GLuint>> groups;
+  for (GLuint texture : unique) groups[mDescribe(texture)].push_back(texture);
+
+  for (const auto& group : groups)
+  {
+    GLint width = std::get<0>(group.first);
+    GLint height = std::get<1>(group.first);
+    GLint format = std::get<2>(group.first);
+    GLint levels = std::abs(std::get<3>(group.first));
+    bool immutable = std::get<3>(group.first) < 0;
+    const std::vector<GLuint>& members = group.second;
+
+    GLuint array = 0;
+    glGenTextures(1, &array);
+
+    if (members.size() == 1 && immutable)
+    {
+      // same storage, just seen as a one layer array
+      glTextureView(array, GL_TEXTURE_2D_ARRAY, members[0], format, 0, levels, 0, 1);
+      glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+    }
+    else
+    {
+      glBindTexture(GL_TEXTURE_2D_ARRAY, array);
+      glTexStorage3D(GL_TEXTURE_2D_ARRAY, levels, format, width, height, (GLsizei)members.size());
+      gMemory.mTrackTexture(array, format, width, height, levels, (int)members.size(), MemoryTextures, "texture array");
+
+      for (size_t layer = 0; layer < members.size(); layer++)
+      {
+        for (GLint level = 0; level < levels; level++)
+        {
+          glCopyImageSubData(members[layer], GL_TEXTURE_2D, level, 0, 0, 0,
+                             array, GL_TEXTURE_2D_ARRAY, level, 0, 0, (GLint)layer,
+                             std::max(1, width >> level), std::max(1, height >> level), 1);
+        }
+      }
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    bool copied = !(members.size() == 1 && immutable);
+    for (size_t layer = 0; layer < members.size(); layer++)
+    {
+      TextureSlot slot;
+      slot.mArray = array;
+      slot.mLayer = (GLuint)layer;
+
+      GLuint texture = members[layer];
+      if (copied && moves)
+      {
+        // the layer becomes the texture, the original is the caller's to delete
+        glGenTextures(1, &texture);
+        glTextureView(texture, GL_TEXTURE_2D, array, format, 0, levels, (GLuint)layer, 1);
+        moves->push_back({members[layer], texture});
+      }
+      mSlots[texture] = slot;
+    }
+    mArrays.push_back(array);
+  }
+
+  std::cout << "Textures: " << mSlots.size() << " textures in " << mArrays.size() << " arrays" << std::endl;
+}
+
+
+TextureSlot TextureResidency::mSlot(GLuint texture) const
+{
+  auto found = mSlots.find(texture);
+  return found != mSlots.end() ? found->second : TextureSlot();
+}
+
+
+void TextureResidency::mForget(GLuint texture)
+{
+  auto found = mSlots.find(texture);
+  if (found == mSlots.end()) return;
+
+  if (found->second.mHandle != 0) glMakeTextureHandleNonResidentARB(found->second.mHandle);
+  mSlots.erase(found);
+}
@@ -0,0 +1,51 @@
+#ifndef TEXTURE_RESIDENCY_HEADER
+#define TEXTURE_RESIDENCY_HEADER
+
+#include "../glad/glad.h"
+
+#include <vector>
+#include <map>
+#include <tuple>
+
+#include "textureCache.hpp"
+
+// Where an instance finds its texture, so draws don't have to be split per texture
+//
+// Bindless [ARB_bindless_texture]: every texture gets a resident handle, the handle goes
+// into the instance SSBO and one bucket per pipeline is enough
+// Otherwise: textures with the same size, format and mip count become layers of one
+// GL_TEXTURE_2D_ARRAY, the instance keeps its layer and buckets split per array
+// [a lonely immutable texture is just viewed as an array of one, no copy]
+//
+// With moves, every copied texture is also handed back as a 2D view of its layer
+// [old -> view]: whoever owns the old one deletes it, so each image is in VRAM once. Views
+// are immutable, a later mBuild copies from them like from anything else
+struct TextureSlot
+{
+  GLuint mArray = 0;        // bound to unit 9 for the bucket, 0 with bindless
+  GLuint mLayer = 0;
+  GLuint64 mHandle = 0;     // 0 without bindless or for untextured instances
+};
+
+class TextureResidency
+{
+  public:
+    bool mBindless = false;
+
+    void mInit(); // picks the mode, needs the GL context
+    void mBuild(const std::vector<GLuint>& textures, std::vector<TextureSwap>* moves = nullptr); // 0s are skipped, can be called again
+    TextureSlot mSlot(GLuint texture) const;
+    void mForget(GLuint texture); // before the texture is deleted, its handle goes with it
+    int mArrayCount() const { return (int)mArrays.size(); }
+
+  private:
+    // width, height, internal format, levels
+    typedef std::tuple<GLint, GLint, GLint, GLint> ArrayKey;
+
+    std::map<GLuint, TextureSlot> mSlots;
+    std::vector<GLuint> mArrays;
+
+    static ArrayKey mDescribe(GLuint texture);
+    void mRelease();
+};
+#endif
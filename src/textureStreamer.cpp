@@ -0,0 +1,309 @@
+#include "../glad/glad.h"
+#include <GLFW/glfw3.h>
+
+#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+#include <cstdlib>
+
+#include "textureStreamer.hpp"
+#include "textureCompress.hpp"
+#include "imageResample.hpp"
+#include "memoryRegistry.hpp"
+#include "allocTracker.hpp"
+#include "stb_image.h"
+
+
+bool TextureStreamer::mStart(GLFWwindow* shareWith)
+{
+  // windows have to be made on the main thread, only the context moves to the worker
+  glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+  mContextWindow = glfwCreateWindow(1, 1, "uploads", NULL, shareWith);
+  glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+  if (!mContextWindow)
+  {
+    std::cout << "No shared context for texture uploads, loading them on the main thread" << std::endl;
+    return false;
+  }
+
+  mQuit = false;
+  mWorker = std::thread(&TextureStreamer::mRun, this);
+  return true;
+}
+
+
+void TextureStreamer::mStop()
+{
+  if (!mWorker.joinable()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mQuit = true;
+  }
+  mWake.notify_one();
+  mWorker.join();
+
+  for (Done& done : mDone) glDeleteSync(done.mFence);
+  mDone.clear();
+
+  glfwDestroyWindow(mContextWindow);
+  mContextWindow = nullptr;
+}
+
+
+void TextureStreamer::mRequest(std::vector<unsigned char>&& bytes, bool cooked, const char* path, int halvings, GLuint placeholder)
+{
+  Job job;
+  job.mBytes = std::move(bytes);
+  job.mCooked = cooked;
+  job.mPath = path;
+  job.mHalvings = halvings;
+  job.mPlaceholder = placeholder;
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mJobs.push_back(std::move(job));
+    mInFlight++;
+  }
+  mWake.notify_one();
+}
+
+
+void TextureStreamer::mCollect(std::vector<Finished>& finished)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+
+  for (size_t i = 0; i < mDone.size();)
+  {
+    // timeout 0: just asks, never blocks
+    GLenum status = mDone[i].mFence ? glClientWaitSync(mDone[i].mFence, 0, 0) : GL_ALREADY_SIGNALED;
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+    {
+      i++;
+      continue;
+    }
+
+    if (mDone[i].mFence) glDeleteSync(mDone[i].mFence);
+    finished.push_back(mDone[i].mResult);
+    mDone.erase(mDone.begin() + i);
+    mInFlight--;
+  }
+}
+
+
+int TextureStreamer::mPending()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mInFlight;
+}
+
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~ WORKER ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+
+void TextureStreamer::mRun()
+{
+  AllocScope scope("texture streamer");
+  glfwMakeContextCurrent(mContextWindow);
+
+  // coherent: memcpy into it is all it takes, no flushes
+  GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glGenBuffers(1, &mRingBuffer);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mRingBuffer);
+  glBufferStorage(GL_PIXEL_UNPACK_BUFFER, mSegmentBytes * mSegmentCount, nullptr, flags);
+  gMemory.mTrackBuffer(mRingBuffer, mSegmentBytes * mSegmentCount, MemoryStreaming, "texture upload ring");
+  mRing = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, mSegmentBytes * mSegmentCount, flags);
+  if (!mRing) std::cout << "Failed to map the texture upload ring" << std::endl;
+
+  stbi_set_flip_vertically_on_load_thread(true); // same as the synchronous path
+
+  while (true)
+  {
+    Job job;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWake.wait(lock, [this]() { return mQuit || !mJobs.empty(); });
+      if (mQuit) break;
+      job = std::move(mJobs.front());
+      mJobs.pop_front();
+    }
+
+    Done done;
+    done.mResult = mUpload(job);
+
+    // the render thread may only touch the texture once the GPU has it
+    if (done.mResult.mTexture != 0)
+    {
+      done.mFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+      glFlush(); // a fence nobody flushed never signals for the other context
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    mDone.push_back(done);
+  }
+
+  for (GLsync& fence : mSegmentFences)
+  {
+    if (fence) glDeleteSync(fence);
+    fence = 0;
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mRingBuffer);
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  gMemory.mDeleteBuffers(1, &mRingBuffer);
+  mRing = nullptr;
+
+  glFinish();
+  glfwMakeContextCurrent(NULL);
+}
+
+
+TextureStreamer::Finished TextureStreamer::mUpload(const Job& job)
+{
+  Finished result;
+  result.mPlaceholder = job.mPlaceholder;
+  result.mCooked = job.mCooked;
+  result.mDownscaled = job.mHalvings > 0;
+  if (!mRing) return result;
+
+  auto start = std::chrono::steady_clock::now();
+  result.mTexture = job.mCooked ? mUploadCooked(job, &result.mBytes) : mUploadImage(job, &result.mBytes);
+  result.mDecodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+  if (result.mTexture == 0) std::cout << "Failed to upload texture: " << job.mPath << std::endl;
+  else gMemory.mTrackTexture(result.mTexture, result.mBytes, 0, 0, 0, MemoryTextures, job.mPath.c_str());
+  return result;
+}
+
+
+bool TextureStreamer::mStreamRows(const unsigned char* rows, size_t rowBytes, int rowCount,
+                                  const std::function<void(size_t, int, int)>& upload)
+{
+  int rowsPerSegment = (int)(mSegmentBytes / rowBytes);
+  if (rowsPerSegment == 0) return false; // one row bigger than a segment
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, mRingBuffer);
+  for (int row = 0; row < rowCount; row += rowsPerSegment)
+  {
+    int count = std::min(rowsPerSegment, rowCount - row);
+    int segment = mNextSegment;
+    mNextSegment = (mNextSegment + 1) % mSegmentCount;
+
+    // last copy out of this segment still running, only this thread waits
+    if (mSegmentFences[segment])
+    {
+      while (glClientWaitSync(mSegmentFences[segment], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+      glDeleteSync(mSegmentFences[segment]);
+      mSegmentFences[segment] = 0;
+    }
+
+    size_t offset = segment * mSegmentBytes;
+    memcpy(mRing + offset, rows + row * rowBytes, count * rowBytes);
+    upload(offset, row, count);
+    mSegmentFences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  }
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  return true;
+}
+
+
+GLuint TextureStreamer::mUploadImage(const Job& job, size_t* bytes)
+{
+  // 4 channels here, rows stay 4 byte aligned in the ring
+  int width, height, nChannels;
+  unsigned char* data = stbi_load_from_memory(job.mBytes.data(), (int)job.mBytes.size(), &width, &height, &nChannels, 4);
+  if (!data) return 0;
+
+  if (job.mHalvings > 0)
+  {
+    int newWidth = std::max(1, width >> job.mHalvings), newHeight = std::max(1, height >> job.mHalvings);
+    unsigned char* resampled = (unsigned char*)malloc((size_t)newWidth * newHeight * 4); // stbi_image_free is free()
+    resampleImage(data, width, height, 4, resampled, newWidth, newHeight);
+    stbi_image_free(data);
+    data = resampled;
+    width = newWidth;
+    height = newHeight;
+  }
+
+  int levels = 1 + (int)std::floor(std::log2((float)std::max(width, height)));
+
+  GLuint textureObject = 0;
+  glGenTextures(1, &textureObject);
+  glBindTexture(GL_TEXTURE_2D, textureObject);
+  glTexStorage2D(GL_TEXTURE_2D, levels, GL_RGBA8, width, height);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  bool ok = mStreamRows(data, (size_t)width * 4, height, [&](size_t offset, int row, int count)
+  {
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, row, width, count, GL_RGBA, GL_UNSIGNED_BYTE, (const void*)offset);
+  });
+  stbi_image_free(data);
+
+  if (ok) glGenerateMipmap(GL_TEXTURE_2D);
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  if (!ok)
+  {
+    glDeleteTextures(1, &textureObject);
+    return 0;
+  }
+
+  *bytes = (size_t)width * height * 4 * 4 / 3;
+  return textureObject;
+}
+
+
+GLuint TextureStreamer::mUploadCooked(const Job& job, size_t* bytes)
+{
+  CookedTexture cooked;
+  if (!readCookedTexture(job.mBytes.data(), job.mBytes.size(), &cooked)) return 0;
+  dropCookedLevels(&cooked, job.mHalvings);
+
+  int blockBytes = cooked.mInternalFormat == GL_COMPRESSED_RGB_S3TC_DXT1_EXT ? 8 : 16;
+
+  GLuint textureObject = 0;
+  glGenTextures(1, &textureObject);
+  glBindTexture(GL_TEXTURE_2D, textureObject);
+  glTexStorage2D(GL_TEXTURE_2D, (GLsizei)cooked.mLevels.size(), cooked.mInternalFormat, cooked.mWidth, cooked.mHeight);
+
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  // one "row" is a row of 4x4 blocks
+  bool ok = true;
+  int width = cooked.mWidth, height = cooked.mHeight;
+  for (size_t level = 0; level < cooked.mLevels.size() && ok; level++)
+  {
+    size_t rowBytes = (size_t)((width + 3) / 4) * blockBytes;
+    int blockRows = (height + 3) / 4;
+
+    ok = mStreamRows(cooked.mLevels[level].data(), rowBytes, blockRows, [&](size_t offset, int row, int count)
+    {
+      int y = row * 4;
+      int rows = std::min(count * 4, height - y);
+      glCompressedTexSubImage2D(GL_TEXTURE_2D, (GLint)level, 0, y, width, rows, cooked.mInternalFormat,
+                                (GLsizei)(count * rowBytes), (const void*)offset);
+    });
+
+    width = width > 1 ? width / 2 : 1;
+    height = height > 1 ? height / 2 : 1;
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  if (!ok)
+  {
+    glDeleteTextures(1, &textureObject);
+    return 0;
+  }
+
+  *bytes = cookedTextureSize(cooked);
+  return textureObject;
+}
@@ -0,0 +1,88 @@
+#ifndef TEXTURE_STREAMER_HEADER
+#define TEXTURE_STREAMER_HEADER
+
+#include "../glad/glad.h"
+#include <GLFW/glfw3.h>
+
+#include <vector>
+#include <deque>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Texture uploads off the render thread
+//
+// A hidden window shares its context with the main one, a worker thread makes it current
+// and does decode -> persistently mapped PBO ring -> glTex[Compressed]SubImage2D
+// The finished texture is a brand new object, handed back with a fence; mCollect only
+// returns the ones whose fence already signaled, so the render thread never waits
+class TextureStreamer
+{
+  public:
+    struct Finished
+    {
+      GLuint mPlaceholder = 0; // what the request was tagged with
+      GLuint mTexture = 0;     // 0 when decode/upload failed
+      size_t mBytes = 0;       // in VRAM, with the mips
+      bool mCooked = false;
+      bool mDownscaled = false;
+      double mDecodeMs = 0.0;
+    };
+
+    bool mStart(GLFWwindow* shareWith); // false: no second context, stay synchronous
+    void mStop();
+    bool mRunning() const { return mWorker.joinable(); }
+
+    // bytes are the file contents [image or .ctex], moved to the worker
+    // halvings: resample the image / skip that many cooked mips first
+    void mRequest(std::vector<unsigned char>&& bytes, bool cooked, const char* path, int halvings, GLuint placeholder);
+    void mCollect(std::vector<Finished>& finished);
+    int mPending();
+
+  private:
+    struct Job
+    {
+      std::vector<unsigned char> mBytes;
+      bool mCooked = false;
+      std::string mPath;
+      int mHalvings = 0;
+      GLuint mPlaceholder = 0;
+    };
+
+    struct Done
+    {
+      Finished mResult;
+      GLsync mFence = 0;
+    };
+
+    // ring split in segments, a segment is reused once the copies out of it are done
+    static const int mSegmentCount = 4;
+    static const size_t mSegmentBytes = 8 * 1024 * 1024;
+
+    GLFWwindow* mContextWindow = nullptr;
+    std::thread mWorker;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    bool mQuit = false;
+    std::deque<Job> mJobs;
+    std::vector<Done> mDone;
+    int mInFlight = 0; // queued + being uploaded + waiting on their fence
+
+    // worker side only
+    GLuint mRingBuffer = 0;
+    unsigned char* mRing = nullptr;
+    GLsync mSegmentFences[mSegmentCount] = {};
+    int mNextSegment = 0;
+
+    void mRun();
+    Finished mUpload(const Job& job);
+    GLuint mUploadImage(const Job& job, size_t* bytes);
+    GLuint mUploadCooked(const Job& job, size_t* bytes);
+
+    // copies rows into ring segments, upload(offset into the PBO, first row, row count)
+    bool mStreamRows(const unsigned char* rows, size_t rowBytes, int rowCount,
+                     const std::function<void(size_t, int, int)>& upload);
+};
+#endif
@@ -0,0 +1,176 @@
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "transformArray.hpp"
+
+
+void TransformArray::mResize(size_t count)
+{
+  Floats* inputs[] = {&mOffsetX, &mOffsetY, &mOffsetZ, &mRotate, &mScaleX, &mScaleY, &mScaleZ};
+  for (Floats* input : inputs) input->resize(count, 0.0f);
+
+  mModels.resize(count, glm::mat4(1.0f));
+  mNormals.resize(count, glm::mat3(1.0f));
+  mDirty.resize(count, 0);
+}
+
+
+void TransformArray::mSet(size_t i, glm::vec3 offset, float rotate, glm::vec3 scale)
+{
+  mOffsetX[i] = offset.x;
+  mOffsetY[i] = offset.y;
+  mOffsetZ[i] = offset.z;
+  mRotate[i] = rotate;
+  mScaleX[i] = scale.x;
+  mScaleY[i] = scale.y;
+  mScaleZ[i] = scale.z;
+
+  if (mDirty[i]) return;
+  mDirty[i] = 1;
+  mDirtyList.push_back((uint32_t)i);
+}
+
+
+// the 10 entries that aren't 0 or 1, see the header
+enum { ModelXX, ModelXZ, ModelYY, ModelZX, ModelZZ, NormalXX, NormalXZ, NormalYY, NormalZX, NormalZZ, EntryCount };
+
+void TransformArray::mWrite(uint32_t i, const float* entries)
+{
+  glm::mat4& model = mModels[i];
+  model[0] = glm::vec4(entries[ModelXX], 0.0f, entries[ModelXZ], 0.0f);
+  model[1] = glm::vec4(0.0f, entries[ModelYY], 0.0f, 0.0f);
+  model[2] = glm::vec4(entries[ModelZX], 0.0f, entries[ModelZZ], 0.0f);
+  model[3] = glm::vec4(mOffsetX[i], mOffsetY[i], mOffsetZ[i], 1.0f);
+
+  glm::mat3& normal = mNormals[i];
+  normal[0] = glm::vec3(entries[NormalXX], 0.0f, entries[NormalXZ]);
+  normal[1] = glm::vec3(0.0f, entries[NormalYY], 0.0f);
+  normal[2] = glm::vec3(entries[NormalZX], 0.0f, entries[NormalZZ]);
+}
+
+
+#if defined(__AVX2__)
+// sin and cos of 8 angles [radians]: quarter turns taken out [Cody-Waite], then the
+// cephes polynomials on [-pi/4, pi/4], ~1e-7 off std::sin / std::cos
+static void sinCos8(__m256 x, __m256* sinOut, __m256* cosOut)
+{
+  const __m256 twoOverPi = _mm256_set1_ps(0.636619772f);
+  __m256 k = _mm256_round_ps(_mm256_mul_ps(x, twoOverPi), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m256 r = _mm256_sub_ps(x, _mm256_mul_ps(k, _mm256_set1_ps(1.5703125f)));
+  r = _mm256_sub_ps(r, _mm256_mul_ps(k, _mm256_set1_ps(4.83751297e-4f)));
+  r = _mm256_sub_ps(r, _mm256_mul_ps(k, _mm256_set1_ps(7.54978995e-8f)));
+  __m256 r2 = _mm256_mul_ps(r, r);
+
+  __m256 sinR = _mm256_add_ps(_mm256_mul_ps(r2, _mm256_set1_ps(-1.9515295891e-4f)), _mm256_set1_ps(8.3321608736e-3f));
+  sinR = _mm256_add_ps(_mm256_mul_ps(r2, sinR), _mm256_set1_ps(-1.6666654611e-1f));
+  sinR = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(r2, r), sinR), r);
+
+  __m256 cosR = _mm256_add_ps(_mm256_mul_ps(r2, _mm256_set1_ps(2.443315711809948e-5f)), _mm256_set1_ps(-1.388731625493765e-3f));
+  cosR = _mm256_add_ps(_mm256_mul_ps(r2, cosR), _mm256_set1_ps(4.166664568298827e-2f));
+  cosR = _mm256_add_ps(_mm256_mul_ps(_mm256_mul_ps(r2, r2), cosR), _mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_set1_ps(0.5f), r2)));
+
+  // quadrant q: 1 swaps sin / cos, 2 negates both
+  __m256i q = _mm256_cvtps_epi32(k);
+  __m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(1)));
+  __m256 sinV = _mm256_blendv_ps(sinR, cosR, swap);
+  __m256 cosV = _mm256_blendv_ps(cosR, sinR, swap);
+
+  const __m256 signBit = _mm256_set1_ps(-0.0f);
+  __m256i sinFlip = _mm256_slli_epi32(_mm256_and_si256(q, _mm256_set1_epi32(2)), 30);                             // q = 2, 3
+  __m256i cosFlip = _mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, _mm256_set1_epi32(1)), _mm256_set1_epi32(2)), 30); // q = 1, 2
+  *sinOut = _mm256_xor_ps(sinV, _mm256_and_ps(_mm256_castsi256_ps(sinFlip), signBit));
+  *cosOut = _mm256_xor_ps(cosV, _mm256_and_ps(_mm256_castsi256_ps(cosFlip), signBit));
+}
+#endif
+
+
+void TransformArray::mUpdate(std::vector<uint32_t>* changed, JobSystem* jobs)
+{
+  if (mDirtyList.empty()) return;
+  if (!std::is_sorted(mDirtyList.begin(), mDirtyList.end())) std::sort(mDirtyList.begin(), mDirtyList.end());
+
+  // every instance writes only its own matrices, ranges of 8 keep the AVX2 loop whole
+  size_t count = mDirtyList.size();
+  if (jobs) jobs->mParallelFor((count + 7) / 8, 256, [this, count](uint32_t first, uint32_t last)
+  {
+    mUpdateRange(first * (size_t)8, std::min(last * (size_t)8, count));
+  });
+  else mUpdateRange(0, count);
+
+  for (uint32_t i : mDirtyList) mDirty[i] = 0;
+  if (changed) changed->assign(mDirtyList.begin(), mDirtyList.end());
+  mDirtyList.clear();
+}
+
+
+void TransformArray::mUpdateRange(size_t first, size_t last)
+{
+  size_t done = first;
+
+#if defined(__AVX2__)
+  // everything but the writes is 8 wide, the matrices are still one per instance
+  const __m256 toRadians = _mm256_set1_ps(0.0174532925f);
+  const __m256 one = _mm256_set1_ps(1.0f);
+  const __m256 signBit = _mm256_set1_ps(-0.0f);
+  for (; done + 8 <= last; done += 8)
+  {
+    __m256i index = _mm256_loadu_si256((const __m256i*)&mDirtyList[done]);
+    __m256 angle = _mm256_mul_ps(_mm256_i32gather_ps(mRotate.data(), index, 4), toRadians);
+    __m256 sx = _mm256_i32gather_ps(mScaleX.data(), index, 4);
+    __m256 sy = _mm256_i32gather_ps(mScaleY.data(), index, 4);
+    __m256 sz = _mm256_i32gather_ps(mScaleZ.data(), index, 4);
+
+    __m256 s, c;
+    sinCos8(angle, &s, &c);
+    __m256 minusS = _mm256_xor_ps(s, signBit);
+    __m256 inverseX = _mm256_div_ps(one, sx);
+    __m256 inverseZ = _mm256_div_ps(one, sz);
+
+    alignas(32) float entries[EntryCount][8];
+    _mm256_store_ps(entries[ModelXX], _mm256_mul_ps(c, sx));
+    _mm256_store_ps(entries[ModelXZ], _mm256_mul_ps(minusS, sx));
+    _mm256_store_ps(entries[ModelYY], sy);
+    _mm256_store_ps(entries[ModelZX], _mm256_mul_ps(s, sz));
+    _mm256_store_ps(entries[ModelZZ], _mm256_mul_ps(c, sz));
+    _mm256_store_ps(entries[NormalXX], _mm256_mul_ps(c, inverseX));
+    _mm256_store_ps(entries[NormalXZ], _mm256_mul_ps(minusS, inverseX));
+    _mm256_store_ps(entries[NormalYY], _mm256_div_ps(one, sy));
+    _mm256_store_ps(entries[NormalZX], _mm256_mul_ps(s, inverseZ));
+    _mm256_store_ps(entries[NormalZZ], _mm256_mul_ps(c, inverseZ));
+
+    for (int lane = 0; lane < 8; lane++)
+    {
+      float lanes[EntryCount];
+      for (int e = 0; e < EntryCount; e++) lanes[e] = entries[e][lane];
+      mWrite(mDirtyList[done + lane], lanes);
+    }
+  }
+#endif
+
+  for (; done < last; done++)
+  {
+    uint32_t i = mDirtyList[done];
+    float radians = glm::radians(mRotate[i]);
+    float c = std::cos(radians), s = std::sin(radians);
+
+    float entries[EntryCount];
+    entries[ModelXX] = c * mScaleX[i];
+    entries[ModelXZ] = -s * mScaleX[i];
+    entries[ModelYY] = mScaleY[i];
+    entries[ModelZX] = s * mScaleZ[i];
+    entries[ModelZZ] = c * mScaleZ[i];
+    entries[NormalXX] = c / mScaleX[i];
+    entries[NormalXZ] = -s / mScaleX[i];
+    entries[NormalYY] = 1.0f / mScaleY[i];
+    entries[NormalZX] = s / mScaleZ[i];
+    entries[NormalZZ] = c / mScaleZ[i];
+    mWrite(i, entries);
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef TRANSFORM_ARRAY_HEADER
+#define TRANSFORM_ARRAY_HEADER
+
+#include "../glm/ext/matrix_transform.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "jobSystem.hpp"
+#include "cpuMemory.hpp"
+
+// Placement of every instance [offset, rotation around y, scale] in SoA, and what the
+// shaders want from it, the model matrix and the normal matrix, in two flat arrays
+//
+// Only instances marked dirty by mSet are redone in mUpdate, 8 at a time with AVX2
+// [gathered by index, sin / cos from a polynomial], scalar without it. The rotation is
+// only around y, so the normal matrix is R * S^-1 and nothing has to be inverted:
+//
+//   model  columns  sx * ( c, 0, -s)   sy * (0, 1, 0)   sz * (s, 0, c)   offset
+//   normal columns  ( c, 0, -s) / sx   (0, 1, 0) / sy   (s, 0, c) / sz
+class TransformArray
+{
+  public:
+    void mResize(size_t count);
+    size_t mCount() const { return mModels.size(); }
+
+    void mSet(size_t i, glm::vec3 offset, float rotate, glm::vec3 scale); // degrees, marks it dirty
+    bool mIsDirty() const { return !mDirtyList.empty(); }
+
+    // redoes the dirty ones, their indices [sorted] go to changed. Split over the job
+    // system's threads when there is one and enough of them moved
+    void mUpdate(std::vector<uint32_t>* changed = nullptr, JobSystem* jobs = nullptr);
+
+    const glm::mat4& mModel(size_t i) const { return mModels[i]; }
+    const glm::mat3& mNormal(size_t i) const { return mNormals[i]; }
+
+  private:
+    typedef TrackedVector<float, MemoryTransforms> Floats;
+
+    Floats mOffsetX, mOffsetY, mOffsetZ;
+    Floats mRotate;
+    Floats mScaleX, mScaleY, mScaleZ;
+
+    TrackedVector<unsigned char, MemoryTransforms> mDirty;
+    TrackedVector<uint32_t, MemoryTransforms> mDirtyList;
+
+    TrackedVector<glm::mat4, MemoryTransforms> mModels;
+    TrackedVector<glm::mat3, MemoryTransforms> mNormals;
+
+    void mWrite(uint32_t i, const float* entries);
+    void mUpdateRange(size_t first, size_t last); // of mDirtyList
+};
+#endif
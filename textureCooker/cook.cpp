@@ -0,0 +1,186 @@
+// Offline texture cooker: image -> <image>.ctex [block compressed, full mip chain]
+//
+// g++ -O2 textureCooker/cook.cpp src/textureCompress.cpp src/assetArchive.cpp src/sceneFile.cpp -I./glad/ -o cook
+// ./cook [-bc7] Models/textures ...
+// ./cook -scene scenes/classroom.scene
+// ./cook -pack assets.pak Models shaders scenes data.txt
+//
+// Opaque images become BC1, the ones with alpha BC3, -bc7 uses BC7 for everything.
+// TextureCache picks the .ctex up on its own when it sits next to the source image
+//
+// -scene compiles scene files to their .bin snapshot [src/sceneFile.hpp], the program
+// does that too, this is for packing without running it first
+//
+// -pack puts every file under the given paths into one archive [src/assetArchive.hpp],
+// named by their path relative to where the program runs. Cook first, pack after
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "../src/stb_image.h"
+
+#include <iostream>
+#include <filesystem>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "../src/textureCompress.hpp"
+#include "../src/assetArchive.hpp"
+#include "../src/sceneFile.hpp"
+
+
+static bool isImage(const std::filesystem::path& path)
+{
+  std::string extension = path.extension().string();
+  return extension == ".png" || extension == ".jpg" || extension == ".jpeg";
+}
+
+
+static bool cook(const std::string& path, bool useBC7, size_t* sourceBytes, size_t* cookedBytes)
+{
+  // runtime flips on load, the blocks have to be in the same order
+  stbi_set_flip_vertically_on_load(true);
+
+  int width, height, nChannels;
+  unsigned char* data = stbi_load(path.c_str(), &width, &height, &nChannels, 4);
+  if (!data)
+  {
+    std::cout << "Failed to load: " << path << std::endl;
+    return false;
+  }
+
+  bool opaque = true;
+  for (size_t i = 0; i < (size_t)width * height && opaque; i++) opaque = data[i * 4 + 3] == 255;
+
+  GLenum format = useBC7 ? GL_COMPRESSED_RGBA_BPTC_UNORM :
+                  opaque ? GL_COMPRESSED_RGB_S3TC_DXT1_EXT : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+
+  auto start = std::chrono::steady_clock::now();
+  CookedTexture cooked;
+  bool ok = cookTexture(data, width, height, format, &cooked);
+  stbi_image_free(data);
+
+  std::string outPath = path + ".ctex";
+  if (!ok || !writeCookedTexture(outPath.c_str(), cooked))
+  {
+    std::cout << "Failed to cook: " << path << std::endl;
+    return false;
+  }
+
+  double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+  size_t size = cookedTextureSize(cooked);
+  size_t uncompressed = (size_t)width * height * 4 * 4 / 3; // RGBA8 + mips
+  *sourceBytes += uncompressed;
+  *cookedBytes += size;
+
+  const char* name = useBC7 ? "BC7" : opaque ? "BC1" : "BC3";
+  std::cout << outPath << "  " << width << "x" << height << " " << name << ", "
+            << cooked.mLevels.size() << " levels, " << size / 1024 << " KB [was "
+            << uncompressed / 1024 << " KB], " << ms << " ms" << std::endl;
+  return true;
+}
+
+
+static bool pack(const std::string& archivePath, const std::vector<std::string>& paths)
+{
+  std::vector<std::string> files;
+  for (const std::string& path : paths)
+  {
+    if (std::filesystem::is_directory(path))
+    {
+      for (const auto& file : std::filesystem::recursive_directory_iterator(path))
+      {
+        if (file.is_regular_file()) files.push_back(file.path().lexically_normal().generic_string());
+      }
+    }
+    else files.push_back(std::filesystem::path(path).lexically_normal().generic_string());
+  }
+
+  AssetArchiveWriter writer;
+  if (!writer.mBegin(archivePath.c_str()))
+  {
+    std::cout << "Failed to create: " << archivePath << std::endl;
+    return false;
+  }
+
+  for (const std::string& file : files)
+  {
+    std::ifstream in(file, std::ios::binary);
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    if (!in.good() && !in.eof())
+    {
+      std::cout << "Failed to read: " << file << std::endl;
+      return false;
+    }
+    if (!writer.mAdd(file, bytes))
+    {
+      std::cout << "Failed to pack: " << file << std::endl;
+      return false;
+    }
+  }
+
+  if (!writer.mFinish())
+  {
+    std::cout << "Failed to write: " << archivePath << std::endl;
+    return false;
+  }
+
+  std::cout << archivePath << "  " << files.size() << " files [" << writer.mCompressedCount << " compressed], "
+            << writer.mRawBytes / (1024.0 * 1024.0) << " MB -> " << writer.mStoredBytes / (1024.0 * 1024.0) << " MB" << std::endl;
+  return true;
+}
+
+
+int main(int argc, char** argv)
+{
+  bool useBC7 = false;
+  bool scenes = false;
+  std::string archivePath;
+  std::vector<std::string> paths;
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "-bc7") == 0) useBC7 = true;
+    else if (strcmp(argv[i], "-scene") == 0) scenes = true;
+    else if (strcmp(argv[i], "-pack") == 0 && i + 1 < argc) archivePath = argv[++i];
+    else paths.push_back(argv[i]);
+  }
+
+  if (paths.empty())
+  {
+    std::cout << "Usage: " << argv[0] << " [-bc7] <image or directory> ..." << std::endl;
+    std::cout << "       " << argv[0] << " -scene <scene file> ..." << std::endl;
+    std::cout << "       " << argv[0] << " -pack <archive> <file or directory> ..." << std::endl;
+    return 1;
+  }
+
+  if (scenes)
+  {
+    int failed = 0;
+    for (const std::string& path : paths) failed += !compileScene(path.c_str(), (path + ".bin").c_str());
+    return failed == 0 ? 0 : 1;
+  }
+
+  if (!archivePath.empty()) return pack(archivePath, paths) ? 0 : 1;
+
+  size_t sourceBytes = 0, cookedBytes = 0;
+  int failed = 0;
+
+  for (const std::string& path : paths)
+  {
+    if (std::filesystem::is_directory(path))
+    {
+      for (const auto& file : std::filesystem::recursive_directory_iterator(path))
+      {
+        if (file.is_regular_file() && isImage(file.path()))
+          failed += !cook(file.path().string(), useBC7, &sourceBytes, &cookedBytes);
+      }
+    }
+    else failed += !cook(path, useBC7, &sourceBytes, &cookedBytes);
+  }
+
+  std::cout << "Total: " << cookedBytes / (1024.0 * 1024.0) << " MB cooked, "
+            << sourceBytes / (1024.0 * 1024.0) << " MB as RGBA8" << std::endl;
+  return failed == 0 ? 0 : 1;
+}